@@ -0,0 +1,86 @@
+#include "AABB.h"
+#include <cfloat>
+
+//default box is empty (inverted) so merging into it yields the other box
+AABB::AABB() {
+	lowest = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+	highest = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+AABB::AABB(glm::vec3 box_lowest, glm::vec3 box_highest) {
+	lowest = box_lowest;
+	highest = box_highest;
+}
+AABB AABB::fromPoints(const std::vector<glm::vec3>& points) {
+
+	AABB box;
+	for (unsigned int i = 0; i < points.size(); ++i) {
+		box.expand(points[i]);
+	}
+	return box;
+}
+
+bool AABB::isEmpty() const {
+	return lowest.x > highest.x || lowest.y > highest.y || lowest.z > highest.z;
+}
+void AABB::expand(glm::vec3 point) {
+	lowest = glm::min(lowest, point);
+	highest = glm::max(highest, point);
+}
+void AABB::merge(const AABB& other) {
+	lowest = glm::min(lowest, other.lowest);
+	highest = glm::max(highest, other.highest);
+}
+
+/*Arvo's method: each output axis is the translation plus, for every matrix
+entry, the smaller/larger of the entry times the input min and max*/
+AABB AABB::transformed(const glm::mat4& matrix) const {
+
+	if (isEmpty()) {
+		return *this;
+	}
+
+	glm::vec3 translation = glm::vec3(matrix[3]);
+	AABB result(translation, translation);
+
+	for (int col = 0; col < 3; ++col) {
+		for (int row = 0; row < 3; ++row) {
+			float a = matrix[col][row] * lowest[col];
+			float b = matrix[col][row] * highest[col];
+			result.lowest[row] += a < b ? a : b;
+			result.highest[row] += a < b ? b : a;
+		}
+	}
+	return result;
+}
+
+bool AABB::overlaps(const AABB& other) const {
+
+	if (highest.x < other.lowest.x || lowest.x > other.highest.x)
+		return false;
+	if (highest.y < other.lowest.y || lowest.y > other.highest.y)
+		return false;
+	if (highest.z < other.lowest.z || lowest.z > other.highest.z)
+		return false;
+
+	return true;
+}
+bool AABB::contains(const AABB& other) const {
+
+	return lowest.x <= other.lowest.x && lowest.y <= other.lowest.y && lowest.z <= other.lowest.z &&
+		highest.x >= other.highest.x && highest.y >= other.highest.y && highest.z >= other.highest.z;
+}
+
+glm::vec3 AABB::getCenter() const {
+	return (lowest + highest) * 0.5f;
+}
+glm::vec3 AABB::getExtents() const {
+	return (highest - lowest) * 0.5f;
+}
+float AABB::getSurfaceArea() const {
+
+	if (isEmpty()) {
+		return 0;
+	}
+	glm::vec3 size = highest - lowest;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+//axis aligned box as plain data, shared by culling and collision code
+class AABB {
+
+public:
+	glm::vec3 lowest;
+	glm::vec3 highest;
+
+	AABB();
+	AABB(glm::vec3 box_lowest, glm::vec3 box_highest);
+	static AABB fromPoints(const std::vector<glm::vec3>& points);
+
+	bool isEmpty() const;
+	void expand(glm::vec3 point);
+	void merge(const AABB& other);
+
+	AABB transformed(const glm::mat4& matrix) const;
+
+	bool overlaps(const AABB& other) const;
+	bool contains(const AABB& other) const;
+
+	glm::vec3 getCenter() const;
+	glm::vec3 getExtents() const;
+	float getSurfaceArea() const;
+};
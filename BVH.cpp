@@ -0,0 +1,600 @@
+#include "BVH.h"
+#include "SceneObject.h"
+#include <algorithm>
+#include <cfloat>
+
+BVH::BVH(float fat_margin) {
+	margin = fat_margin;
+	clear();
+}
+
+void BVH::clear() {
+	nodes.clear();
+	root = NULL_NODE;
+	freeList = NULL_NODE;
+	numObjects = 0;
+}
+
+void BVH::build(const std::vector<SceneObject*>& objects, std::vector<int>* proxies) {
+
+	clear();
+	if (proxies != NULL) {
+		proxies->assign(objects.size(), NULL_NODE);
+	}
+
+	//one leaf per object that has bounds, centroids drive the split choice
+	std::vector<int> leaves;
+	std::vector<glm::vec3> centroids;
+	for (unsigned int i = 0; i < objects.size(); ++i) {
+
+		AABB bounds;
+		if (!objects[i]->getWorldBounds(bounds)) {
+			continue;
+		}
+
+		int leaf = allocateNode();
+		nodes[leaf].object = objects[i];
+		nodes[leaf].tightBox = bounds;
+		nodes[leaf].box = fatten(bounds);
+		nodes[leaf].height = 0;
+
+		leaves.push_back(leaf);
+		centroids.push_back(bounds.getCenter());
+		if (proxies != NULL) {
+			(*proxies)[i] = leaf;
+		}
+	}
+
+	numObjects = leaves.size();
+	if (!leaves.empty()) {
+		root = buildRange(leaves, centroids, 0, leaves.size());
+		nodes[root].parent = NULL_NODE;
+	}
+}
+
+int BVH::insert(SceneObject* object, const AABB& bounds) {
+
+	int leaf = allocateNode();
+	nodes[leaf].object = object;
+	nodes[leaf].tightBox = bounds;
+	nodes[leaf].box = fatten(bounds);
+	nodes[leaf].height = 0;
+
+	insertLeaf(leaf);
+	++numObjects;
+	return leaf;
+}
+void BVH::remove(int proxy) {
+
+	removeLeaf(proxy);
+	freeNode(proxy);
+	--numObjects;
+}
+
+//returns true if the tree had to change
+bool BVH::update(int proxy, const AABB& bounds) {
+
+	nodes[proxy].tightBox = bounds;
+	if (nodes[proxy].box.contains(bounds)) {
+		return false;
+	}
+
+	//teleports would leave huge ancestors behind, move the leaf instead
+	AABB fatBounds = fatten(bounds);
+	if (!nodes[proxy].box.overlaps(fatBounds)) {
+		removeLeaf(proxy);
+		nodes[proxy].box = fatBounds;
+		insertLeaf(proxy);
+		return true;
+	}
+
+	nodes[proxy].box = fatBounds;
+	refitAncestors(nodes[proxy].parent);
+	return true;
+}
+
+void BVH::refit() {
+
+	for (unsigned int i = 0; i < nodes.size(); ++i) {
+
+		if (nodes[i].height != 0 || nodes[i].object == NULL) {
+			continue;
+		}
+
+		AABB bounds;
+		if (nodes[i].object->getWorldBounds(bounds)) {
+			update(i, bounds);
+		}
+	}
+}
+
+//QUERIES
+void BVH::queryFrustum(const Frustum& frustum, std::vector<SceneObject*>& results) const {
+
+	if (root == NULL_NODE) {
+		return;
+	}
+
+	std::vector<int> stack;
+	stack.push_back(root);
+	while (!stack.empty()) {
+
+		int index = stack.back();
+		stack.pop_back();
+		const Node& node = nodes[index];
+
+		int result = frustum.classify(node.box);
+		if (result == Frustum::OUTSIDE) {
+			continue;
+		}
+
+		//everything below is visible, no more plane tests needed
+		if (result == Frustum::INSIDE) {
+			collectLeaves(index, results);
+			continue;
+		}
+
+		if (node.height == 0) {
+			if (frustum.intersects(node.tightBox)) {
+				results.push_back(node.object);
+			}
+		}
+		else {
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+}
+void BVH::queryOverlap(const AABB& bounds, std::vector<SceneObject*>& results) const {
+
+	if (root == NULL_NODE) {
+		return;
+	}
+
+	std::vector<int> stack;
+	stack.push_back(root);
+	while (!stack.empty()) {
+
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!node.box.overlaps(bounds)) {
+			continue;
+		}
+
+		if (node.height == 0) {
+			if (node.tightBox.overlaps(bounds)) {
+				results.push_back(node.object);
+			}
+		}
+		else {
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+}
+
+//direction is expected to be normalized so distances are in world units
+void BVH::queryRay(glm::vec3 origin, glm::vec3 direction, float max_distance, std::vector<SceneObject*>& results) const {
+
+	if (root == NULL_NODE) {
+		return;
+	}
+
+	glm::vec3 inverseDirection = glm::vec3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float entry;
+
+	std::vector<int> stack;
+	stack.push_back(root);
+	while (!stack.empty()) {
+
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!rayHitsBox(origin, inverseDirection, node.box, max_distance, entry)) {
+			continue;
+		}
+
+		if (node.height == 0) {
+			if (rayHitsBox(origin, inverseDirection, node.tightBox, max_distance, entry)) {
+				results.push_back(node.object);
+			}
+		}
+		else {
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+}
+
+//nearest object whose bounds the ray enters, NULL if none
+SceneObject* BVH::raycast(glm::vec3 origin, glm::vec3 direction, float max_distance, float& hit_distance) const {
+
+	SceneObject* closest = NULL;
+	hit_distance = max_distance;
+
+	if (root == NULL_NODE) {
+		return NULL;
+	}
+
+	glm::vec3 inverseDirection = glm::vec3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float entry;
+
+	std::vector<int> stack;
+	stack.push_back(root);
+	while (!stack.empty()) {
+
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		//anything entered beyond the current best can be skipped
+		if (!rayHitsBox(origin, inverseDirection, node.box, hit_distance, entry)) {
+			continue;
+		}
+
+		if (node.height == 0) {
+			if (rayHitsBox(origin, inverseDirection, node.tightBox, hit_distance, entry)) {
+				closest = node.object;
+				hit_distance = entry;
+			}
+		}
+		else {
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+	return closest;
+}
+
+unsigned int BVH::getNumObjects() const {
+	return numObjects;
+}
+int BVH::getHeight() const {
+	return root == NULL_NODE ? 0 : nodes[root].height;
+}
+
+
+//PRIVATE HELPERS
+int BVH::allocateNode() {
+
+	int index;
+	if (freeList != NULL_NODE) {
+		index = freeList;
+		freeList = nodes[index].parent;
+	}
+	else {
+		index = nodes.size();
+		nodes.push_back(Node());
+	}
+
+	nodes[index].object = NULL;
+	nodes[index].parent = NULL_NODE;
+	nodes[index].left = NULL_NODE;
+	nodes[index].right = NULL_NODE;
+	nodes[index].height = 0;
+	return index;
+}
+void BVH::freeNode(int index) {
+
+	nodes[index].object = NULL;
+	nodes[index].height = -1;
+	nodes[index].parent = freeList;
+	freeList = index;
+}
+AABB BVH::fatten(const AABB& bounds) const {
+	glm::vec3 offset(margin, margin, margin);
+	return AABB(bounds.lowest - offset, bounds.highest + offset);
+}
+
+/*binned SAH: centroids along the widest axis are dropped into bins and the split
+between bins with the lowest count weighted surface area is taken*/
+int BVH::buildRange(std::vector<int>& leaves, std::vector<glm::vec3>& centroids, int begin, int end) {
+
+	if (end - begin == 1) {
+		return leaves[begin];
+	}
+
+	const int NUM_BINS = 12;
+
+	AABB centroidBounds;
+	for (int i = begin; i < end; ++i) {
+		centroidBounds.expand(centroids[i]);
+	}
+
+	glm::vec3 size = centroidBounds.highest - centroidBounds.lowest;
+	int axis = 0;
+	if (size.y > size[axis])
+		axis = 1;
+	if (size.z > size[axis])
+		axis = 2;
+
+	int mid = begin + (end - begin) / 2;
+
+	if (size[axis] > 0) {
+
+		AABB binBoxes[NUM_BINS];
+		int binCounts[NUM_BINS] = { 0 };
+		float binScale = NUM_BINS / size[axis];
+
+		for (int i = begin; i < end; ++i) {
+			int bin = (int)((centroids[i][axis] - centroidBounds.lowest[axis]) * binScale);
+			bin = bin < NUM_BINS ? bin : NUM_BINS - 1;
+			binCounts[bin]++;
+			binBoxes[bin].merge(nodes[leaves[i]].box);
+		}
+
+		//sweep from the right to get the cost of everything above each split
+		float rightCosts[NUM_BINS];
+		AABB sweep;
+		int sweepCount = 0;
+		for (int bin = NUM_BINS - 1; bin > 0; --bin) {
+			sweep.merge(binBoxes[bin]);
+			sweepCount += binCounts[bin];
+			rightCosts[bin] = sweep.getSurfaceArea() * sweepCount;
+		}
+
+		float bestCost = FLT_MAX;
+		int bestSplit = -1;
+		sweep = AABB();
+		sweepCount = 0;
+		for (int bin = 0; bin < NUM_BINS - 1; ++bin) {
+			sweep.merge(binBoxes[bin]);
+			sweepCount += binCounts[bin];
+			float cost = sweep.getSurfaceArea() * sweepCount + rightCosts[bin + 1];
+			if (sweepCount > 0 && sweepCount < end - begin && cost < bestCost) {
+				bestCost = cost;
+				bestSplit = bin;
+			}
+		}
+
+		//partition leaves (and their centroids) around the chosen split
+		if (bestSplit >= 0) {
+			int left = begin;
+			for (int i = begin; i < end; ++i) {
+				int bin = (int)((centroids[i][axis] - centroidBounds.lowest[axis]) * binScale);
+				bin = bin < NUM_BINS ? bin : NUM_BINS - 1;
+				if (bin <= bestSplit) {
+					std::swap(leaves[i], leaves[left]);
+					std::swap(centroids[i], centroids[left]);
+					++left;
+				}
+			}
+			mid = left;
+		}
+	}
+
+	int index = allocateNode();
+	int leftChild = buildRange(leaves, centroids, begin, mid);
+	int rightChild = buildRange(leaves, centroids, mid, end);
+
+	nodes[index].left = leftChild;
+	nodes[index].right = rightChild;
+	nodes[leftChild].parent = index;
+	nodes[rightChild].parent = index;
+	nodes[index].box = nodes[leftChild].box;
+	nodes[index].box.merge(nodes[rightChild].box);
+	nodes[index].height = 1 + std::max(nodes[leftChild].height, nodes[rightChild].height);
+	return index;
+}
+
+/*branch and bound search for the sibling that adds the least total surface area.
+Every ancestor of a candidate grows too, that growth is the inherited cost*/
+int BVH::findBestSibling(const AABB& bounds) const {
+
+	float boundsArea = bounds.getSurfaceArea();
+
+	int bestSibling = root;
+	AABB merged = nodes[root].box;
+	merged.merge(bounds);
+	float bestCost = merged.getSurfaceArea();
+
+	std::vector<std::pair<int, float> > stack;
+	stack.push_back(std::make_pair(root, 0.0f));
+	while (!stack.empty()) {
+
+		int index = stack.back().first;
+		float inheritedCost = stack.back().second;
+		stack.pop_back();
+
+		const Node& node = nodes[index];
+		merged = node.box;
+		merged.merge(bounds);
+		float mergedArea = merged.getSurfaceArea();
+
+		float cost = mergedArea + inheritedCost;
+		if (cost < bestCost) {
+			bestCost = cost;
+			bestSibling = index;
+		}
+
+		//children can't do better than the new leaf's own area plus what is inherited
+		float childInheritedCost = inheritedCost + mergedArea - node.box.getSurfaceArea();
+		if (node.height > 0 && boundsArea + childInheritedCost < bestCost) {
+			stack.push_back(std::make_pair(node.left, childInheritedCost));
+			stack.push_back(std::make_pair(node.right, childInheritedCost));
+		}
+	}
+	return bestSibling;
+}
+
+void BVH::insertLeaf(int leaf) {
+
+	if (root == NULL_NODE) {
+		root = leaf;
+		nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	int sibling = findBestSibling(nodes[leaf].box);
+	int oldParent = nodes[sibling].parent;
+
+	int newParent = allocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].left = sibling;
+	nodes[newParent].right = leaf;
+	nodes[newParent].box = nodes[sibling].box;
+	nodes[newParent].box.merge(nodes[leaf].box);
+	nodes[newParent].height = nodes[sibling].height + 1;
+
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if (oldParent == NULL_NODE) {
+		root = newParent;
+	}
+	else if (nodes[oldParent].left == sibling) {
+		nodes[oldParent].left = newParent;
+	}
+	else {
+		nodes[oldParent].right = newParent;
+	}
+
+	refitAncestors(newParent);
+}
+void BVH::removeLeaf(int leaf) {
+
+	if (leaf == root) {
+		root = NULL_NODE;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+	//sibling takes the parent's place
+	nodes[sibling].parent = grandParent;
+	freeNode(parent);
+
+	if (grandParent == NULL_NODE) {
+		root = sibling;
+		return;
+	}
+
+	if (nodes[grandParent].left == parent) {
+		nodes[grandParent].left = sibling;
+	}
+	else {
+		nodes[grandParent].right = sibling;
+	}
+	refitAncestors(grandParent);
+}
+
+void BVH::refitAncestors(int index) {
+
+	while (index != NULL_NODE) {
+
+		int left = nodes[index].left;
+		int right = nodes[index].right;
+
+		nodes[index].box = nodes[left].box;
+		nodes[index].box.merge(nodes[right].box);
+		nodes[index].height = 1 + std::max(nodes[left].height, nodes[right].height);
+
+		rotate(index);
+		index = nodes[index].parent;
+	}
+}
+
+/*Tree rotation: swap one child of this node with a grandchild under the other
+child if that shrinks the surface area of the node being rebuilt. This node's box
+is unaffected, so rotations can be applied on the way up after any refit*/
+void BVH::rotate(int index) {
+
+	int b = nodes[index].left;
+	int c = nodes[index].right;
+
+	int bestChild = NULL_NODE;
+	int bestNephew = NULL_NODE;
+	float bestDelta = 0;
+
+	//swap b with a child of c: c gets rebuilt around b and the other grandchild
+	if (nodes[c].height > 0) {
+		float areaC = nodes[c].box.getSurfaceArea();
+		int grandChildren[2] = { nodes[c].left, nodes[c].right };
+		for (int i = 0; i < 2; ++i) {
+			AABB rebuilt = nodes[b].box;
+			rebuilt.merge(nodes[grandChildren[1 - i]].box);
+			float delta = rebuilt.getSurfaceArea() - areaC;
+			if (delta < bestDelta) {
+				bestDelta = delta;
+				bestChild = b;
+				bestNephew = grandChildren[i];
+			}
+		}
+	}
+
+	//and the mirror case, swap c with a child of b
+	if (nodes[b].height > 0) {
+		float areaB = nodes[b].box.getSurfaceArea();
+		int grandChildren[2] = { nodes[b].left, nodes[b].right };
+		for (int i = 0; i < 2; ++i) {
+			AABB rebuilt = nodes[c].box;
+			rebuilt.merge(nodes[grandChildren[1 - i]].box);
+			float delta = rebuilt.getSurfaceArea() - areaB;
+			if (delta < bestDelta) {
+				bestDelta = delta;
+				bestChild = c;
+				bestNephew = grandChildren[i];
+			}
+		}
+	}
+
+	if (bestChild == NULL_NODE) {
+		return;
+	}
+
+	int uncle = nodes[bestNephew].parent;
+
+	if (nodes[index].left == bestChild)
+		nodes[index].left = bestNephew;
+	else
+		nodes[index].right = bestNephew;
+	nodes[bestNephew].parent = index;
+
+	if (nodes[uncle].left == bestNephew)
+		nodes[uncle].left = bestChild;
+	else
+		nodes[uncle].right = bestChild;
+	nodes[bestChild].parent = uncle;
+
+	nodes[uncle].box = nodes[nodes[uncle].left].box;
+	nodes[uncle].box.merge(nodes[nodes[uncle].right].box);
+	nodes[uncle].height = 1 + std::max(nodes[nodes[uncle].left].height, nodes[nodes[uncle].right].height);
+	nodes[index].height = 1 + std::max(nodes[nodes[index].left].height, nodes[nodes[index].right].height);
+}
+
+void BVH::collectLeaves(int index, std::vector<SceneObject*>& results) const {
+
+	std::vector<int> stack;
+	stack.push_back(index);
+	while (!stack.empty()) {
+
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.height == 0) {
+			results.push_back(node.object);
+		}
+		else {
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+}
+
+//slab test, entry_distance is where the ray enters (0 if it starts inside)
+bool BVH::rayHitsBox(glm::vec3 origin, glm::vec3 inverse_direction, const AABB& box, float max_distance, float& entry_distance) {
+
+	float tMin = 0;
+	float tMax = max_distance;
+	for (int axis = 0; axis < 3; ++axis) {
+		float t1 = (box.lowest[axis] - origin[axis]) * inverse_direction[axis];
+		float t2 = (box.highest[axis] - origin[axis]) * inverse_direction[axis];
+		tMin = glm::max(tMin, glm::min(t1, t2));
+		tMax = glm::min(tMax, glm::max(t1, t2));
+	}
+
+	entry_distance = tMin;
+	return tMin <= tMax;
+}
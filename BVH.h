@@ -0,0 +1,78 @@
+#pragma once
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "AABB.h"
+#include "Frustum.h"
+
+class SceneObject;
+
+/*Dynamic bounding volume hierarchy over scene object world bounds. Leaves hold
+slightly enlarged ("fat") boxes so small movements do not touch the tree; when an
+object leaves its fat box the leaf is refit in place and tree rotations along the
+path back to the root keep the hierarchy tight without a rebuild*/
+class BVH {
+
+public:
+	const static int NULL_NODE = -1;
+
+private:
+
+	struct Node {
+		AABB box;			//fat box for leaves, union of children for inner nodes
+		AABB tightBox;		//exact object bounds, leaves only
+		SceneObject* object;
+		int parent;			//doubles as the next link while on the free list
+		int left;
+		int right;
+		int height;			//leaves are 0, free nodes -1
+	};
+
+	std::vector<Node> nodes;
+	int root;
+	int freeList;
+	unsigned int numObjects;
+	float margin;
+
+public:
+
+	BVH(float fat_margin = 1.0f);
+
+	void clear();
+
+	//top down binned SAH build, replaces anything already in the tree. Proxies
+	//gets each object's leaf, NULL_NODE for objects without bounds
+	void build(const std::vector<SceneObject*>& objects, std::vector<int>* proxies = NULL);
+
+	//incremental interface, the returned proxy identifies the leaf
+	int insert(SceneObject* object, const AABB& bounds);
+	void remove(int proxy);
+	bool update(int proxy, const AABB& bounds);
+
+	//pull current world bounds from every object and refit the ones that moved
+	void refit();
+
+	//queries append to results
+	void queryFrustum(const Frustum& frustum, std::vector<SceneObject*>& results) const;
+	void queryOverlap(const AABB& bounds, std::vector<SceneObject*>& results) const;
+	void queryRay(glm::vec3 origin, glm::vec3 direction, float max_distance, std::vector<SceneObject*>& results) const;
+	SceneObject* raycast(glm::vec3 origin, glm::vec3 direction, float max_distance, float& hit_distance) const;
+
+	unsigned int getNumObjects() const;
+	int getHeight() const;
+
+private:
+	int allocateNode();
+	void freeNode(int index);
+	AABB fatten(const AABB& bounds) const;
+
+	int buildRange(std::vector<int>& leaves, std::vector<glm::vec3>& centroids, int begin, int end);
+	int findBestSibling(const AABB& bounds) const;
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	void refitAncestors(int index);
+	void rotate(int index);
+	void collectLeaves(int index, std::vector<SceneObject*>& results) const;
+
+	static bool rayHitsBox(glm::vec3 origin, glm::vec3 inverse_direction, const AABB& box, float max_distance, float& entry_distance);
+};
@@ -0,0 +1,201 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "SceneObject.h"
+#include "BVH.h"
+#include "BenchmarkTimer.h"
+
+/*Times BVH build, refit and queries at 10K, 100K and 1M objects scattered
+at the same density. Every kind of query is also answered by brute force over
+all objects for the first few queries, and the results must match exactly*/
+
+//a box of fixed size, its world bounds come from the regular scene object update
+class BenchmarkBox : public SceneObject {
+	glm::vec3 halfSize;
+	void sendThisGeometryToShadowMap() {}
+	void drawThisSceneObject(Scene*) {}
+	bool getLocalBounds(AABB& bounds) const {
+		bounds = AABB(-halfSize, halfSize);
+		return true;
+	}
+public:
+	BenchmarkBox(glm::vec3 half_size) {
+		halfSize = half_size;
+	}
+};
+
+static const int REFIT_FRAMES = 10;
+static const int NUM_QUERIES = 1000;
+static const int NUM_FRUSTUM_QUERIES = 100;
+static const int NUM_CHECKED = 20;		//queries also answered by brute force
+
+//same slab test as the tree, so brute force and tree agree to the last bit
+static bool rayEntry(glm::vec3 origin, glm::vec3 direction, const AABB& box, float max_distance, float& entry) {
+	float tMin = 0;
+	float tMax = max_distance;
+	for (int axis = 0; axis < 3; ++axis) {
+		float t1 = (box.lowest[axis] - origin[axis]) * (1.0f / direction[axis]);
+		float t2 = (box.highest[axis] - origin[axis]) * (1.0f / direction[axis]);
+		tMin = glm::max(tMin, glm::min(t1, t2));
+		tMax = glm::min(tMax, glm::max(t1, t2));
+	}
+	entry = tMin;
+	return tMin <= tMax;
+}
+
+static bool sameObjects(std::vector<SceneObject*> a, std::vector<SceneObject*> b) {
+	std::sort(a.begin(), a.end());
+	std::sort(b.begin(), b.end());
+	return a == b;
+}
+
+static bool run(unsigned int num_objects) {
+
+	std::mt19937 random(num_objects);
+	float side = 10.0f * std::cbrt((float)num_objects);
+	std::uniform_real_distribution<float> position(0, side);
+	std::uniform_real_distribution<float> size(0.25f, 1.5f);
+	std::uniform_real_distribution<float> jitter(-0.4f, 0.4f);
+	std::uniform_real_distribution<float> unit(-1, 1);
+
+	std::vector<BenchmarkBox*> boxes;
+	std::vector<SceneObject*> objects;
+	for (unsigned int i = 0; i < num_objects; ++i) {
+		BenchmarkBox* box = new BenchmarkBox(glm::vec3(size(random), size(random), size(random)));
+		box->setLocalPosition(glm::vec3(position(random), position(random), position(random)));
+		box->updateWorldTransforms(false);
+		boxes.push_back(box);
+		objects.push_back(box);
+	}
+
+	BVH bvh;
+	Clock::time_point start = Clock::now();
+	bvh.build(objects);
+	double buildTime = millisecondsSince(start);
+
+	//a tenth of the objects drift inside their fat boxes, one in a hundred jump away
+	double refitTime = 0;
+	for (int frame = 0; frame < REFIT_FRAMES; ++frame) {
+		for (unsigned int i = frame % 10; i < num_objects; i += 10) {
+			glm::vec3 moved = boxes[i]->getPosition(SceneObject::OBJECT) + glm::vec3(jitter(random), jitter(random), jitter(random));
+			if (i % 100 == (unsigned int)frame) {
+				moved = glm::vec3(position(random), position(random), position(random));
+			}
+			boxes[i]->setLocalPosition(moved);
+			boxes[i]->updateWorldTransforms(false);
+		}
+		start = Clock::now();
+		bvh.refit();
+		refitTime += millisecondsSince(start);
+	}
+	refitTime /= REFIT_FRAMES;
+
+	bool matched = true;
+	std::vector<SceneObject*> results;
+	std::vector<SceneObject*> expected;
+	AABB bounds;
+
+	//boxes about 40 units across
+	double overlapTime = 0, overlapBruteTime = 0;
+	for (int q = 0; q < NUM_QUERIES; ++q) {
+		glm::vec3 center(position(random), position(random), position(random));
+		AABB query(center - glm::vec3(20), center + glm::vec3(20));
+
+		results.clear();
+		start = Clock::now();
+		bvh.queryOverlap(query, results);
+		overlapTime += millisecondsSince(start);
+
+		if (q < NUM_CHECKED) {
+			expected.clear();
+			start = Clock::now();
+			for (unsigned int i = 0; i < num_objects; ++i) {
+				if (objects[i]->getWorldBounds(bounds) && bounds.overlaps(query)) {
+					expected.push_back(objects[i]);
+				}
+			}
+			overlapBruteTime += millisecondsSince(start);
+			matched = matched && sameObjects(results, expected);
+		}
+	}
+
+	//narrow perspective views from inside the volume toward its center
+	double frustumTime = 0, frustumBruteTime = 0;
+	for (int q = 0; q < NUM_FRUSTUM_QUERIES; ++q) {
+		glm::vec3 eye(position(random), position(random), position(random));
+		glm::mat4 view = glm::lookAt(eye, glm::vec3(side / 2) + glm::vec3(1, 2, 3), glm::vec3(0, 1, 0));
+		Frustum frustum;
+		frustum.update(glm::perspective(glm::radians(30.0f), 1.0f, 0.1f, side / 4) * view);
+
+		results.clear();
+		start = Clock::now();
+		bvh.queryFrustum(frustum, results);
+		frustumTime += millisecondsSince(start);
+
+		if (q < NUM_CHECKED) {
+			expected.clear();
+			start = Clock::now();
+			for (unsigned int i = 0; i < num_objects; ++i) {
+				if (objects[i]->getWorldBounds(bounds) && frustum.intersects(bounds)) {
+					expected.push_back(objects[i]);
+				}
+			}
+			frustumBruteTime += millisecondsSince(start);
+			matched = matched && sameObjects(results, expected);
+		}
+	}
+
+	//rays across the whole volume, nearest hit
+	double rayTime = 0, rayBruteTime = 0;
+	for (int q = 0; q < NUM_QUERIES; ++q) {
+		glm::vec3 origin(position(random), position(random), position(random));
+		glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.01f));
+
+		float hitDistance;
+		start = Clock::now();
+		SceneObject* hit = bvh.raycast(origin, direction, side, hitDistance);
+		rayTime += millisecondsSince(start);
+
+		if (q < NUM_CHECKED) {
+			float bruteDistance = side;
+			float entry;
+			start = Clock::now();
+			for (unsigned int i = 0; i < num_objects; ++i) {
+				if (objects[i]->getWorldBounds(bounds) && rayEntry(origin, direction, bounds, bruteDistance, entry)) {
+					bruteDistance = entry;
+				}
+			}
+			rayBruteTime += millisecondsSince(start);
+			matched = matched && (hit == NULL ? bruteDistance == side : bruteDistance == hitDistance);
+		}
+	}
+
+	std::cout << num_objects << "\t" << buildTime << "\t\t" << refitTime << "\t\t"
+		<< 1000 * overlapTime / NUM_QUERIES << " / " << 1000 * overlapBruteTime / NUM_CHECKED << "\t"
+		<< 1000 * frustumTime / NUM_FRUSTUM_QUERIES << " / " << 1000 * frustumBruteTime / NUM_CHECKED << "\t"
+		<< 1000 * rayTime / NUM_QUERIES << " / " << 1000 * rayBruteTime / NUM_CHECKED << "\t"
+		<< bvh.getHeight() << "\t" << (matched ? "ok" : "MISMATCH") << std::endl;
+
+	for (unsigned int i = 0; i < boxes.size(); ++i) {
+		delete boxes[i];
+	}
+	return matched;
+}
+
+int main() {
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "query times are tree / brute force, in microseconds per query" << std::endl;
+	std::cout << "objects\tbuild ms\trefit ms\toverlap us\t\tfrustum us\t\tray us\t\t\theight\tchecked" << std::endl;
+
+	bool matched = true;
+	unsigned int sizes[] = { 10000, 100000, 1000000 };
+	for (unsigned int i = 0; i < sizeof(sizes) / sizeof(unsigned int); ++i) {
+		matched = run(sizes[i]) && matched;
+	}
+	return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <chrono>
+
+//wall clock timing shared by the benchmarks
+typedef std::chrono::high_resolution_clock Clock;
+
+inline double millisecondsSince(Clock::time_point start) {
+	std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+	return elapsed.count();
+}
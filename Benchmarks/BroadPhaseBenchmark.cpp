@@ -0,0 +1,129 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+#include "BoundingBox.h"
+#include "BroadPhase.h"
+#include "BenchmarkTimer.h"
+
+/*Times the incremental sweep and prune against the uniform grid over the same
+boxes, for motion that is coherent between frames and for boxes that land
+somewhere new every frame. After the last frame the two pair lists must be
+identical, and for the smaller counts also equal to a brute force pass*/
+
+static const int FRAMES = 20;
+static const unsigned int BRUTE_FORCE_LIMIT = 10000;
+
+typedef std::pair<BoundingBox*, BoundingBox*> BoxPair;
+
+//smaller pointer first, so pairs from either method compare equal
+static std::vector<BoxPair> sortedPairs(const std::vector<BroadPhase::Pair>& pairs) {
+	std::vector<BoxPair> sorted;
+	for (unsigned int i = 0; i < pairs.size(); ++i) {
+		sorted.push_back(pairs[i].a < pairs[i].b ? BoxPair(pairs[i].a, pairs[i].b) : BoxPair(pairs[i].b, pairs[i].a));
+	}
+	std::sort(sorted.begin(), sorted.end());
+	return sorted;
+}
+
+static bool run(unsigned int num_boxes, bool coherent) {
+
+	std::mt19937 random(num_boxes);
+
+	//about one neighbor per box at this density
+	float side = 3.0f * std::cbrt((float)num_boxes);
+	std::uniform_real_distribution<float> position(0, side);
+	std::uniform_real_distribution<float> size(0.5f, 1.5f);
+	std::uniform_real_distribution<float> velocity(-0.05f, 0.05f);
+
+	std::vector<glm::vec3> unitCube;
+	for (int i = 0; i < 8; ++i) {
+		unitCube.push_back(glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f));
+	}
+
+	std::vector<BoundingBox*> boxes;
+	std::vector<glm::vec3> positions, sizes, velocities;
+	for (unsigned int i = 0; i < num_boxes; ++i) {
+		boxes.push_back(new BoundingBox(unitCube));
+		positions.push_back(glm::vec3(position(random), position(random), position(random)));
+		sizes.push_back(glm::vec3(size(random), size(random), size(random)));
+		velocities.push_back(glm::vec3(velocity(random), velocity(random), velocity(random)));
+	}
+
+	BroadPhase sweepAndPrune;
+	BroadPhase grid;
+	grid.setMethod(BroadPhase::UNIFORM_GRID);
+	grid.setCellSize(2.0f);
+	for (unsigned int i = 0; i < num_boxes; ++i) {
+		sweepAndPrune.add(boxes[i]);
+		grid.add(boxes[i]);
+	}
+
+	double firstSort = 0, sweepTime = 0, gridTime = 0;
+	for (int frame = 0; frame <= FRAMES; ++frame) {
+
+		for (unsigned int i = 0; i < num_boxes; ++i) {
+			if (frame > 0) {
+				positions[i] = coherent ? positions[i] + velocities[i] : glm::vec3(position(random), position(random), position(random));
+			}
+			boxes[i]->updateToWorld(glm::scale(glm::translate(glm::mat4(1.0f), positions[i]), sizes[i]));
+		}
+
+		//the first sweep and prune update sorts everything from scratch
+		Clock::time_point start = Clock::now();
+		sweepAndPrune.update();
+		double elapsed = millisecondsSince(start);
+		if (frame == 0)
+			firstSort = elapsed;
+		else
+			sweepTime += elapsed;
+
+		start = Clock::now();
+		grid.update();
+		if (frame > 0)
+			gridTime += millisecondsSince(start);
+	}
+
+	std::vector<BoxPair> sweepPairs = sortedPairs(sweepAndPrune.getPairs());
+	bool matched = sweepPairs == sortedPairs(grid.getPairs());
+
+	if (num_boxes <= BRUTE_FORCE_LIMIT) {
+		std::vector<BoxPair> expected;
+		for (unsigned int i = 0; i < num_boxes; ++i) {
+			for (unsigned int j = i + 1; j < num_boxes; ++j) {
+				if (boxes[i]->getBounds().overlaps(boxes[j]->getBounds())) {
+					expected.push_back(boxes[i] < boxes[j] ? BoxPair(boxes[i], boxes[j]) : BoxPair(boxes[j], boxes[i]));
+				}
+			}
+		}
+		std::sort(expected.begin(), expected.end());
+		matched = matched && sweepPairs == expected;
+	}
+
+	std::cout << num_boxes << "\t" << (coherent ? "coherent" : "scattered") << "\t" << firstSort << "\t\t"
+		<< sweepTime / FRAMES << "\t\t" << gridTime / FRAMES << "\t\t" << sweepPairs.size() << "\t"
+		<< (matched ? "ok" : "MISMATCH") << std::endl;
+
+	for (unsigned int i = 0; i < boxes.size(); ++i) {
+		delete boxes[i];
+	}
+	return matched;
+}
+
+int main() {
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "boxes\tmotion\t\tfirst sort ms\tSAP ms/frame\tgrid ms/frame\tpairs\tchecked" << std::endl;
+
+	bool matched = true;
+	unsigned int counts[] = { 1000, 10000, 100000 };
+	for (unsigned int i = 0; i < sizeof(counts) / sizeof(unsigned int); ++i) {
+		matched = run(counts[i], true) && matched;
+		matched = run(counts[i], false) && matched;
+	}
+	return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,285 @@
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "RenderQueue.h"
+#include "Camera.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "MeshPool.h"
+#include "FrameRing.h"
+#include "IndirectDrawer.h"
+#include "GLState.h"
+#include "BenchmarkTimer.h"
+
+/*Draws 1 to 1M copies of one mesh and material through the render queue in a
+hidden window, once as a draw call per object, once as a single instanced draw
+and once as a multi draw indirect where supported. Times the CPU side of queueing
+and submitting, and the whole frame until the GPU is done with it. A smaller grid
+is drawn all three ways into an offscreen frame buffer and the pictures must match*/
+
+static const int WIDTH = 512;
+static const int HEIGHT = 512;
+static const int FRAMES = 10;
+static const unsigned int PER_DRAW_LIMIT = 100000;		//a million single draws take too long to be worth timing
+static const unsigned int CHECKED_INSTANCES = 1000;
+static const char* CUBE_FILE = "InstancingBenchmarkCube.obj";
+
+enum Method { PER_DRAW, INSTANCED, INDIRECT, NUM_METHODS };
+
+struct Result {
+	double cpuTime;			//queueing and submitting, ms per frame
+	double frameTime;		//until glFinish returns, ms per frame
+	RenderQueue::Stats stats;
+};
+
+//every triangle with its own three vertices, as the obj parser wants them
+static void writeCube(const char* path) {
+
+	FILE* fp = fopen(path, "w");
+	if (fp == NULL) {
+		std::cerr << "could not write " << path << std::endl;
+		exit(1);
+	}
+	int corners[6][4] = { { 1, 3, 7, 5 }, { 0, 4, 6, 2 }, { 2, 6, 7, 3 }, { 0, 1, 5, 4 }, { 4, 5, 7, 6 }, { 0, 2, 3, 1 } };
+	float normals[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	float uvs[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+	int triangleCorners[6] = { 0, 1, 2, 0, 2, 3 };
+
+	for (int face = 0; face < 6; ++face) {
+		for (int v = 0; v < 6; ++v) {
+			int corner = corners[face][triangleCorners[v]];
+			fprintf(fp, "v %f %f %f\n", corner & 1 ? 0.5f : -0.5f, corner & 2 ? 0.5f : -0.5f, corner & 4 ? 0.5f : -0.5f);
+			fprintf(fp, "vn %f %f %f\n", normals[face][0], normals[face][1], normals[face][2]);
+			fprintf(fp, "vt %f %f\n", uvs[triangleCorners[v]][0], uvs[triangleCorners[v]][1]);
+		}
+	}
+	for (int i = 1; i <= 36; i += 3) {
+		fprintf(fp, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", i, i, i, i + 1, i + 1, i + 1, i + 2, i + 2, i + 2);
+	}
+	fclose(fp);
+}
+
+//a cube shaped lattice in front of the camera, shrinking to keep it all in view
+static std::vector<glm::mat4> makeLattice(unsigned int num_instances) {
+
+	int side = (int)std::ceil(std::cbrt((double)num_instances));
+	float spacing = 2.0f / side;
+	glm::vec3 center(0, 0, -4);
+
+	std::vector<glm::mat4> toWorlds;
+	for (unsigned int i = 0; i < num_instances; ++i) {
+		glm::vec3 cell((float)(i % side), (float)((i / side) % side), (float)(i / (side * side)));
+		glm::vec3 position = center + (cell - glm::vec3((side - 1) / 2.0f)) * spacing;
+		glm::mat4 toWorld = glm::translate(glm::mat4(1.0f), position);
+		toWorld = glm::rotate(toWorld, 0.1f * i, glm::vec3(0, 1, 0));
+		toWorlds.push_back(glm::scale(toWorld, glm::vec3(0.5f * spacing)));
+	}
+	return toWorlds;
+}
+
+static void setMethod(RenderQueue& queue, int method) {
+	queue.setInstancing(method != PER_DRAW);
+	queue.setIndirect(method == INDIRECT);
+}
+
+static void drawFrame(RenderQueue& queue, Camera* camera, Mesh* mesh, Material* material, const std::vector<glm::mat4>& to_worlds, Result* result) {
+
+	GLState::beginFrame();
+	FrameRing::beginFrame();
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	Clock::time_point start = Clock::now();
+	queue.beginFrame(camera);
+	for (unsigned int i = 0; i < to_worlds.size(); ++i) {
+		queue.add(RenderQueue::OPAQUE_PASS, mesh, material, to_worlds[i]);
+	}
+	queue.submit(camera, false);
+	if (result != NULL) {
+		result->cpuTime += millisecondsSince(start);
+	}
+
+	glFinish();
+	if (result != NULL) {
+		result->frameTime += millisecondsSince(start);
+		result->stats = queue.getStats();
+	}
+	FrameRing::endFrame();
+}
+
+static Result timeMethod(RenderQueue& queue, int method, Camera* camera, Mesh* mesh, Material* material, const std::vector<glm::mat4>& to_worlds) {
+
+	setMethod(queue, method);
+
+	//first frame grows the buffers, it isn't counted
+	drawFrame(queue, camera, mesh, material, to_worlds, NULL);
+
+	Result result;
+	result.cpuTime = result.frameTime = 0;
+	for (int frame = 0; frame < FRAMES; ++frame) {
+		drawFrame(queue, camera, mesh, material, to_worlds, &result);
+	}
+	result.cpuTime /= FRAMES;
+	result.frameTime /= FRAMES;
+	return result;
+}
+
+//the draw calls each method must have been submitted with
+static bool checkStats(int method, unsigned int num_instances, const RenderQueue::Stats& stats) {
+	if (stats.packets != num_instances)
+		return false;
+	if (method == PER_DRAW)
+		return stats.draws == num_instances && stats.instancedDraws == 0;
+	if (method == INSTANCED)
+		return stats.draws == 1 && stats.instancedDraws == 1;
+	return stats.draws == 1 && stats.indirectDraws == 1 && stats.indirectCommands == 1;
+}
+
+//the same lattice drawn every way must give the same picture, up to rounding on a few pixels
+static bool checkPictures(RenderQueue& queue, int num_methods, Camera* camera, Mesh* mesh, Material* material) {
+
+	GLuint frameBuffer, renderBuffers[2];
+	glGenFramebuffers(1, &frameBuffer);
+	glGenRenderbuffers(2, renderBuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderBuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIDTH, HEIGHT);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderBuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, WIDTH, HEIGHT);
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderBuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderBuffers[1]);
+
+	//Validate FBO
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Benchmark frame buffer's status reported incomplete" << std::endl;
+		exit(1);
+	}
+
+	std::vector<glm::mat4> toWorlds = makeLattice(CHECKED_INSTANCES);
+	std::vector<unsigned char> pictures[NUM_METHODS];
+	for (int method = 0; method < num_methods; ++method) {
+		setMethod(queue, method);
+		drawFrame(queue, camera, mesh, material, toWorlds, NULL);
+		pictures[method].resize(WIDTH * HEIGHT * 4);
+		glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pictures[method].data());
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteRenderbuffers(2, renderBuffers);
+	glDeleteFramebuffers(1, &frameBuffer);
+
+	bool matched = true;
+	for (int method = 1; method < num_methods; ++method) {
+		unsigned int differing = 0;
+		for (int pixel = 0; pixel < WIDTH * HEIGHT; ++pixel) {
+			for (int channel = 0; channel < 3; ++channel) {
+				if (std::abs(pictures[method][pixel * 4 + channel] - pictures[PER_DRAW][pixel * 4 + channel]) > 1) {
+					++differing;
+					break;
+				}
+			}
+		}
+		if (differing > WIDTH * HEIGHT / 1000) {
+			std::cout << differing << " pixels differ from the per draw picture with method " << method << std::endl;
+			matched = false;
+		}
+	}
+	return matched;
+}
+
+int main() {
+
+	if (!glfwInit()) {
+		std::cerr << "Failed to initialize GLFW" << std::endl;
+		return EXIT_FAILURE;
+	}
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Instancing Benchmark", NULL, NULL);
+	if (!window) {
+		std::cerr << "Failed to open GLFW window" << std::endl;
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+	if (glewInit() != GLEW_OK) {
+		std::cerr << "glewInit failed" << std::endl;
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	//same state main sets up for the engine
+	GLState::reset();
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::depthFunc(GL_LEQUAL);
+	GLState::disable(GL_CULL_FACE);
+	glViewport(0, 0, WIDTH, HEIGHT);
+
+	Material::initStatics();
+	FrameRing::initStatics();
+	MeshPool::initStatics();
+	IndirectDrawer::initStatics();
+
+	writeCube(CUBE_FILE);
+	Mesh* mesh = Mesh::load(CUBE_FILE);
+
+	Material material;
+	material.setUseDiffuse(true);
+	material.setDiffuseColor(glm::vec3(1, 1, 1));
+	material.setUseAmbient(true);
+	material.setAmbientColor(glm::vec3(0.1, 0.1, 0.1));
+
+	//at the origin looking down -z, the lattice fits in view
+	Camera* camera = new Camera(glm::vec3(0, 0, 0), glm::radians(60.0f));
+	camera->resize((float)WIDTH, (float)HEIGHT);
+	camera->updateWorldTransforms(false);
+	camera->updateViewMatrix();
+
+	RenderQueue queue;
+	queue.init();
+	int numMethods = IndirectDrawer::isSupported() ? NUM_METHODS : INDIRECT;
+
+	bool matched = checkPictures(queue, numMethods, camera, mesh, &material);
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "ms per frame, queue and submit on the CPU / until the GPU is done" << std::endl;
+	std::cout << "instances\tper draw\t\tinstanced\t\t" << (numMethods == NUM_METHODS ? "indirect\t\t" : "") << "checked" << std::endl;
+
+	unsigned int counts[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+	for (unsigned int c = 0; c < sizeof(counts) / sizeof(unsigned int); ++c) {
+
+		std::vector<glm::mat4> toWorlds = makeLattice(counts[c]);
+		std::cout << counts[c] << "\t";
+
+		bool statsMatched = true;
+		for (int method = 0; method < numMethods; ++method) {
+			if (method == PER_DRAW && counts[c] > PER_DRAW_LIMIT) {
+				std::cout << "\t-\t";
+				continue;
+			}
+			Result result = timeMethod(queue, method, camera, mesh, &material, toWorlds);
+			statsMatched = statsMatched && checkStats(method, counts[c], result.stats);
+			std::cout << "\t" << result.cpuTime << " / " << result.frameTime;
+		}
+		matched = matched && statsMatched;
+		std::cout << "\t" << (statsMatched ? "ok" : "MISMATCH") << std::endl;
+	}
+
+	queue.dispose();
+	delete camera;
+	Mesh::release(mesh);
+	remove(CUBE_FILE);
+
+	IndirectDrawer::cleanUpStatics();
+	MeshPool::cleanUpStatics();
+	FrameRing::cleanUpStatics();
+	Material::cleanUpStatics();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+
+	return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
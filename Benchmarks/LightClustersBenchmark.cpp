@@ -0,0 +1,132 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include "LightClusters.h"
+#include "JobSystem.h"
+#include "BenchmarkTimer.h"
+
+/*Times CPU froxel binning of more and more point lights, serially and on the job
+system. For the smaller counts every froxel is also filled by testing it against
+every light, with froxel bounds built the same way, and the lists must match:
+the per light tile and slice ranges may only skip froxels the sphere misses*/
+
+static const int FRAMES = 20;
+static const unsigned int BRUTE_FORCE_LIMIT = 4096;
+static const float CAMERA_NEAR = 0.1f;
+static const float CAMERA_FAR = 1000.0f;
+
+//same corners as LightClusters::updateClusterBounds
+static AABB froxelBounds(const glm::mat4& projection, int x, int y, int z) {
+
+	float sliceNear = CAMERA_NEAR * std::pow(CAMERA_FAR / CAMERA_NEAR, (float)z / LightClusters::GRID_Z);
+	float sliceFar = CAMERA_NEAR * std::pow(CAMERA_FAR / CAMERA_NEAR, (float)(z + 1) / LightClusters::GRID_Z);
+
+	AABB bounds;
+	for (int corner = 0; corner < 8; ++corner) {
+		float ndcX = -1.0f + 2.0f * (x + (corner & 1)) / LightClusters::GRID_X;
+		float ndcY = -1.0f + 2.0f * (y + ((corner >> 1) & 1)) / LightClusters::GRID_Y;
+		float depth = (corner & 4) ? sliceFar : sliceNear;
+		bounds.expand(glm::vec3(ndcX * depth / projection[0][0], ndcY * depth / projection[1][1], -depth));
+	}
+	return bounds;
+}
+
+static bool checkClusters(const LightClusters& clusters, const glm::mat4& view, const glm::mat4& projection,
+	const std::vector<LightClusters::PointLightData>& lights) {
+
+	std::vector<glm::vec3> centers;
+	for (unsigned int i = 0; i < lights.size(); ++i) {
+		centers.push_back(glm::vec3(view * glm::vec4(glm::vec3(lights[i].positionRange), 1.0f)));
+	}
+
+	for (int z = 0; z < LightClusters::GRID_Z; ++z) {
+		for (int y = 0; y < LightClusters::GRID_Y; ++y) {
+			for (int x = 0; x < LightClusters::GRID_X; ++x) {
+
+				AABB bounds = froxelBounds(projection, x, y, z);
+				std::vector<unsigned int> expected;
+				for (unsigned int i = 0; i < lights.size(); ++i) {
+					float radius = lights[i].positionRange.w;
+					glm::vec3 offset = glm::clamp(centers[i], bounds.lowest, bounds.highest) - centers[i];
+					if (glm::dot(offset, offset) <= radius * radius) {
+						expected.push_back(i);
+					}
+				}
+
+				std::vector<unsigned int> binned = clusters.getClusterLights(x, y, z);
+				std::sort(binned.begin(), binned.end());
+				if (binned != expected) {
+					std::cout << "froxel " << x << ", " << y << ", " << z << " has " << binned.size()
+						<< " lights, expected " << expected.size() << std::endl;
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+static double buildFrames(LightClusters& clusters, const glm::mat4& view, const glm::mat4& projection,
+	const std::vector<LightClusters::PointLightData>& lights) {
+
+	double total = 0;
+	for (int frame = 0; frame < FRAMES; ++frame) {
+		Clock::time_point start = Clock::now();
+		clusters.build(view, projection, CAMERA_NEAR, CAMERA_FAR, lights);
+		total += millisecondsSince(start);
+	}
+	return total / FRAMES;
+}
+
+int main() {
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0, 20, 0), glm::vec3(0, 20, -1), glm::vec3(0, 1, 0));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, CAMERA_NEAR, CAMERA_FAR);
+
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	unsigned int workers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << LightClusters::NUM_CLUSTERS << " froxels, " << workers + 1 << " threads with the job system" << std::endl;
+	std::cout << "lights\tserial ms\tjobs ms\t\tindices\tlights/froxel\tchecked" << std::endl;
+
+	bool matched = true;
+	unsigned int counts[] = { 64, 256, 1024, 4096, 16384, 65536 };
+	for (unsigned int c = 0; c < sizeof(counts) / sizeof(unsigned int); ++c) {
+
+		//lights scattered through the view volume, ranges as Light gives brightnesses of 0.01 to 0.1
+		std::mt19937 random(counts[c]);
+		std::uniform_real_distribution<float> depth(1.0f, 600.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> brightness(0.01f, 0.1f);
+
+		std::vector<LightClusters::PointLightData> lights(counts[c]);
+		for (unsigned int i = 0; i < counts[c]; ++i) {
+			float z = depth(random);
+			glm::vec3 position(unit(random) * z, 20 + unit(random) * 0.5f * z, -z);
+			lights[i].positionRange = glm::vec4(position, brightness(random) * 255.0f);
+			lights[i].color = glm::vec4(1, 1, 1, -1);
+		}
+
+		//job system not initialized, slices are binned one after another
+		LightClusters clusters;
+		double serialTime = buildFrames(clusters, view, projection, lights);
+		bool clustersMatched = counts[c] > BRUTE_FORCE_LIMIT || checkClusters(clusters, view, projection, lights);
+
+		JobSystem::init(workers);
+		double jobsTime = buildFrames(clusters, view, projection, lights);
+		JobSystem::dispose();
+		clustersMatched = clustersMatched && (counts[c] > BRUTE_FORCE_LIMIT || checkClusters(clusters, view, projection, lights));
+
+		matched = matched && clustersMatched;
+		std::cout << counts[c] << "\t" << serialTime << "\t\t" << jobsTime << "\t\t" << clusters.getNumLightIndices() << "\t"
+			<< (float)clusters.getNumLightIndices() / LightClusters::NUM_CLUSTERS << "\t\t"
+			<< (counts[c] > BRUTE_FORCE_LIMIT ? "skipped" : (clustersMatched ? "ok" : "MISMATCH")) << std::endl;
+	}
+	return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "BoundingBox.h"
+#include "NarrowPhase.h"
+#include "BenchmarkTimer.h"
+
+/*Throughput of every stage a pair can go through: the world space box test the
+broad phase already did, the oriented box test, and GJK and EPA on the hulls, the
+way NarrowPhase::collide runs them. Each stage must be conservative for the next,
+and pushing b out along a reported contact normal by its depth must separate the pair*/
+
+static const unsigned int NUM_PAIRS = 100000;
+static const unsigned int NUM_CHECKED = 1000;		//contacts pushed apart and tested again
+
+struct Shape {
+	const char* name;
+	std::vector<glm::vec3> points;
+};
+
+//about a unit across each, so random offsets give a mix of hits and misses
+static std::vector<Shape> makeShapes(std::mt19937& random) {
+
+	std::vector<Shape> shapes(3);
+
+	shapes[0].name = "box";
+	for (int i = 0; i < 8; ++i) {
+		shapes[0].points.push_back(glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.25f : -0.25f, i & 4 ? 0.75f : -0.75f));
+	}
+
+	shapes[1].name = "octahedron";
+	for (int i = 0; i < 3; ++i) {
+		glm::vec3 axis(i == 0, i == 1, i == 2);
+		shapes[1].points.push_back(axis);
+		shapes[1].points.push_back(-axis);
+	}
+
+	//points on a sphere, most of them end up on the hull
+	shapes[2].name = "sphere";
+	std::normal_distribution<float> normal(0, 1);
+	for (int i = 0; i < 64; ++i) {
+		shapes[2].points.push_back(0.75f * glm::normalize(glm::vec3(normal(random), normal(random), normal(random)) + glm::vec3(1e-4f)));
+	}
+	return shapes;
+}
+
+static glm::mat4 randomTransform(std::mt19937& random, glm::vec3 position) {
+	std::uniform_real_distribution<float> unit(-1, 1);
+	std::uniform_real_distribution<float> angle(0, 6.2831853f);
+	glm::vec3 axis = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(1e-4f));
+	return glm::rotate(glm::translate(glm::mat4(1.0f), position), angle(random), axis);
+}
+
+int main() {
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+
+	std::vector<Shape> shapes = makeShapes(random);
+	std::vector<ConvexHull> hulls;
+	std::vector<AABB> localBounds;
+	for (unsigned int i = 0; i < shapes.size(); ++i) {
+		hulls.push_back(ConvexHull(shapes[i].points));
+		localBounds.push_back(AABB::fromPoints(shapes[i].points));
+	}
+
+	//b sits within a few units of a, in any orientation
+	std::vector<unsigned int> shapeA(NUM_PAIRS), shapeB(NUM_PAIRS);
+	std::vector<glm::mat4> toWorldA(NUM_PAIRS), toWorldB(NUM_PAIRS);
+	std::vector<BoundingBox*> boxesA(NUM_PAIRS), boxesB(NUM_PAIRS);
+	for (unsigned int i = 0; i < NUM_PAIRS; ++i) {
+		shapeA[i] = random() % shapes.size();
+		shapeB[i] = random() % shapes.size();
+		toWorldA[i] = randomTransform(random, glm::vec3(0));
+		toWorldB[i] = randomTransform(random, glm::vec3(offset(random), offset(random), offset(random)));
+
+		boxesA[i] = new BoundingBox(shapes[shapeA[i]].points);
+		boxesB[i] = new BoundingBox(shapes[shapeB[i]].points);
+		boxesA[i]->updateToWorld(toWorldA[i]);
+		boxesB[i]->updateToWorld(toWorldB[i]);
+	}
+
+	std::vector<char> boxHits(NUM_PAIRS, 0), obbHits(NUM_PAIRS, 0), hullHits(NUM_PAIRS, 0);
+	std::vector<glm::vec3> normals(NUM_PAIRS);
+	std::vector<float> depths(NUM_PAIRS);
+
+	Clock::time_point start = Clock::now();
+	for (unsigned int i = 0; i < NUM_PAIRS; ++i) {
+		boxHits[i] = boxesA[i]->isCollidingWith(boxesB[i]);
+	}
+	double boxTime = millisecondsSince(start);
+
+	start = Clock::now();
+	for (unsigned int i = 0; i < NUM_PAIRS; ++i) {
+		OBB a(localBounds[shapeA[i]], toWorldA[i]);
+		OBB b(localBounds[shapeB[i]], toWorldB[i]);
+		obbHits[i] = NarrowPhase::testOBBs(a, b, normals[i], depths[i]);
+	}
+	double obbTime = millisecondsSince(start);
+
+	//only what the oriented boxes let through reaches the hulls, as in collide
+	unsigned int numHullTests = 0;
+	start = Clock::now();
+	for (unsigned int i = 0; i < NUM_PAIRS; ++i) {
+		if (obbHits[i]) {
+			++numHullTests;
+			hullHits[i] = NarrowPhase::testHulls(hulls[shapeA[i]], toWorldA[i], hulls[shapeB[i]], toWorldB[i], normals[i], depths[i]);
+		}
+	}
+	double hullTime = millisecondsSince(start);
+
+	unsigned int numBoxHits = 0, numOBBHits = 0, numHullHits = 0, numChecked = 0;
+	bool matched = true;
+	for (unsigned int i = 0; i < NUM_PAIRS; ++i) {
+		numBoxHits += boxHits[i];
+		numOBBHits += obbHits[i];
+		numHullHits += hullHits[i];
+
+		//a hit a looser test missed is a bug in the looser one
+		if ((obbHits[i] && !boxHits[i]) || (hullHits[i] && !obbHits[i])) {
+			std::cout << "pair " << i << " hit by a tighter test but missed by a looser one" << std::endl;
+			matched = false;
+		}
+
+		if (hullHits[i] && numChecked < NUM_CHECKED) {
+			++numChecked;
+			glm::mat4 separated = glm::translate(glm::mat4(1.0f), normals[i] * (depths[i] * 1.01f + 1e-3f)) * toWorldB[i];
+			glm::vec3 normal;
+			float depth;
+			if (depths[i] < 0 || NarrowPhase::testHulls(hulls[shapeA[i]], toWorldA[i], hulls[shapeB[i]], separated, normal, depth)) {
+				std::cout << "pair " << i << " still overlaps after moving out by its contact depth" << std::endl;
+				matched = false;
+			}
+		}
+	}
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << NUM_PAIRS << " pairs of ";
+	for (unsigned int i = 0; i < shapes.size(); ++i) {
+		std::cout << shapes[i].name << " (" << hulls[i].getVertices().size() << " hull vertices) ";
+	}
+	std::cout << std::endl << "test\t\tns/pair\thits" << std::endl;
+	std::cout << "world box\t" << 1e6 * boxTime / NUM_PAIRS << "\t" << numBoxHits << std::endl;
+	std::cout << "oriented box\t" << 1e6 * obbTime / NUM_PAIRS << "\t" << numOBBHits << std::endl;
+	std::cout << "GJK + EPA\t" << (numHullTests > 0 ? 1e6 * hullTime / numHullTests : 0.0) << "\t" << numHullHits << std::endl;
+	std::cout << numChecked << " contacts pushed apart, " << (matched ? "ok" : "MISMATCH") << std::endl;
+
+	for (unsigned int i = 0; i < NUM_PAIRS; ++i) {
+		delete boxesA[i];
+		delete boxesB[i];
+	}
+	return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,229 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include "OcclusionBuffer.h"
+#include "JobSystem.h"
+#include "BenchmarkTimer.h"
+
+/*Times rasterizing more and more occluders into the CPU depth buffer, serially and
+on the job system, and times box queries against the hierarchical depth. The
+occluders are quads facing the camera, so every pixel's depth is known exactly:
+pixels well inside a quad must hold its depth, pixels well away from all of them
+must stay empty. Every query is also answered by scanning all covered pixels, and
+the hierarchical answer must match*/
+
+static const int WIDTH = 256;
+static const int HEIGHT = 128;
+static const int FRAMES = 20;
+static const int NUM_QUERIES = 10000;
+static const float DEPTH_TOLERANCE = 1e-4f;
+
+//a quad at a single view depth, as its pixel rectangle and buffer depth
+struct Quad {
+	std::vector<glm::vec3> triangles;
+	float minX, minY, maxX, maxY;
+	float depth;
+};
+
+static glm::vec3 toScreen(const glm::mat4& view_projection, glm::vec3 point) {
+	glm::vec4 clip = view_projection * glm::vec4(point, 1.0f);
+	float inverseW = 1.0f / clip.w;
+	return glm::vec3((clip.x * inverseW * 0.5f + 0.5f) * WIDTH,
+		(clip.y * inverseW * 0.5f + 0.5f) * HEIGHT,
+		clip.z * inverseW * 0.5f + 0.5f);
+}
+
+//the camera sits at the origin looking down -z
+static std::vector<Quad> makeQuads(std::mt19937& random, unsigned int num_quads, const glm::mat4& view_projection) {
+
+	std::uniform_real_distribution<float> distance(2.0f, 50.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> size(0.02f, 0.3f);
+
+	std::vector<Quad> quads(num_quads);
+	for (unsigned int i = 0; i < num_quads; ++i) {
+
+		float z = distance(random);
+		glm::vec3 center(unit(random) * z, unit(random) * 0.5f * z, -z);
+		glm::vec2 halfSize(size(random) * z, size(random) * z);
+		glm::vec3 corners[4] = {
+			center + glm::vec3(-halfSize.x, -halfSize.y, 0), center + glm::vec3(halfSize.x, -halfSize.y, 0),
+			center + glm::vec3(halfSize.x, halfSize.y, 0), center + glm::vec3(-halfSize.x, halfSize.y, 0)
+		};
+		int order[6] = { 0, 1, 2, 0, 2, 3 };
+		for (int v = 0; v < 6; ++v) {
+			quads[i].triangles.push_back(corners[order[v]]);
+		}
+
+		glm::vec3 low = toScreen(view_projection, corners[0]);
+		glm::vec3 high = toScreen(view_projection, corners[2]);
+		quads[i].minX = low.x;
+		quads[i].minY = low.y;
+		quads[i].maxX = high.x;
+		quads[i].maxY = high.y;
+		quads[i].depth = low.z;
+	}
+	return quads;
+}
+
+/*a pixel within one pixel of a quad's edge may go either way, so each pixel gets
+the range between the nearest quad surely covering it and the nearest one possibly covering it*/
+static bool checkDepths(const OcclusionBuffer& buffer, const std::vector<Quad>& quads) {
+
+	std::vector<float> nearestSure(WIDTH * HEIGHT, 1.0f);
+	std::vector<float> nearestPossible(WIDTH * HEIGHT, 1.0f);
+	for (unsigned int i = 0; i < quads.size(); ++i) {
+		const Quad& quad = quads[i];
+		int firstX = std::max(0, (int)std::floor(quad.minX) - 1), lastX = std::min(WIDTH - 1, (int)std::floor(quad.maxX) + 1);
+		int firstY = std::max(0, (int)std::floor(quad.minY) - 1), lastY = std::min(HEIGHT - 1, (int)std::floor(quad.maxY) + 1);
+		for (int y = firstY; y <= lastY; ++y) {
+			for (int x = firstX; x <= lastX; ++x) {
+				float centerX = x + 0.5f, centerY = y + 0.5f;
+				if (centerX > quad.minX + 1 && centerX < quad.maxX - 1 && centerY > quad.minY + 1 && centerY < quad.maxY - 1) {
+					nearestSure[y * WIDTH + x] = std::min(nearestSure[y * WIDTH + x], quad.depth);
+				}
+				nearestPossible[y * WIDTH + x] = std::min(nearestPossible[y * WIDTH + x], quad.depth);
+			}
+		}
+	}
+
+	for (int y = 0; y < HEIGHT; ++y) {
+		for (int x = 0; x < WIDTH; ++x) {
+			float depth = buffer.getDepth(x, y);
+			if (depth < nearestPossible[y * WIDTH + x] - DEPTH_TOLERANCE || depth > nearestSure[y * WIDTH + x] + DEPTH_TOLERANCE) {
+				std::cout << "pixel " << x << ", " << y << " holds " << depth << ", expected between "
+					<< nearestPossible[y * WIDTH + x] << " and " << nearestSure[y * WIDTH + x] << std::endl;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//the same projection as the buffer, then every covered pixel without the hierarchy
+static bool referenceVisible(const OcclusionBuffer& buffer, const glm::mat4& view_projection, const AABB& bounds) {
+
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float nearestDepth = FLT_MAX;
+	for (int corner = 0; corner < 8; ++corner) {
+
+		glm::vec3 point((corner & 1) ? bounds.highest.x : bounds.lowest.x,
+			(corner & 2) ? bounds.highest.y : bounds.lowest.y,
+			(corner & 4) ? bounds.highest.z : bounds.lowest.z);
+		glm::vec4 clip = view_projection * glm::vec4(point, 1.0f);
+		if (clip.z < -clip.w || clip.w <= 0.0f) {
+			return true;
+		}
+
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW * 0.5f + 0.5f) * buffer.getWidth();
+		float y = (clip.y * inverseW * 0.5f + 0.5f) * buffer.getHeight();
+		minX = glm::min(minX, x);
+		maxX = glm::max(maxX, x);
+		minY = glm::min(minY, y);
+		maxY = glm::max(maxY, y);
+		nearestDepth = glm::min(nearestDepth, clip.z * inverseW * 0.5f + 0.5f);
+	}
+
+	int firstX = glm::max(0, (int)std::floor(minX));
+	int lastX = glm::min(buffer.getWidth() - 1, (int)std::floor(maxX));
+	int firstY = glm::max(0, (int)std::floor(minY));
+	int lastY = glm::min(buffer.getHeight() - 1, (int)std::floor(maxY));
+	if (firstX > lastX || firstY > lastY) {
+		return true;
+	}
+	for (int y = firstY; y <= lastY; ++y) {
+		for (int x = firstX; x <= lastX; ++x) {
+			if (buffer.getDepth(x, y) >= nearestDepth) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+//returns the average milliseconds per frame, leaves the last frame in the buffer
+static double rasterizeFrames(OcclusionBuffer& buffer, const glm::mat4& view_projection, const std::vector<Quad>& quads) {
+
+	double total = 0;
+	for (int frame = 0; frame < FRAMES; ++frame) {
+		Clock::time_point start = Clock::now();
+		buffer.beginFrame(view_projection);
+		for (unsigned int i = 0; i < quads.size(); ++i) {
+			buffer.addOccluder(quads[i].triangles, glm::mat4(1.0f));
+		}
+		buffer.rasterize();
+		total += millisecondsSince(start);
+	}
+	return total / FRAMES;
+}
+
+int main() {
+
+	glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), (float)WIDTH / HEIGHT, 0.1f, 100.0f);
+
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	unsigned int workers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << WIDTH << "x" << HEIGHT << " buffer, " << workers + 1 << " threads with the job system" << std::endl;
+	std::cout << "quads\tserial ms\tjobs ms\t\tquery us\tscan us\t\thidden\tchecked" << std::endl;
+
+	bool matched = true;
+	unsigned int counts[] = { 16, 256, 4096, 65536 };
+	for (unsigned int c = 0; c < sizeof(counts) / sizeof(unsigned int); ++c) {
+
+		std::mt19937 random(counts[c]);
+		std::vector<Quad> quads = makeQuads(random, counts[c], viewProjection);
+		OcclusionBuffer buffer(WIDTH, HEIGHT);
+
+		//job system not initialized, tiles are rasterized one after another
+		double serialTime = rasterizeFrames(buffer, viewProjection, quads);
+		bool depthsMatched = checkDepths(buffer, quads);
+
+		JobSystem::init(workers);
+		double jobsTime = rasterizeFrames(buffer, viewProjection, quads);
+		JobSystem::dispose();
+		depthsMatched = depthsMatched && checkDepths(buffer, quads);
+
+		//boxes of all sizes at all depths in front of the camera
+		std::uniform_real_distribution<float> distance(1.0f, 60.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> size(0.01f, 0.2f);
+		std::vector<AABB> boxes;
+		for (int q = 0; q < NUM_QUERIES; ++q) {
+			float z = distance(random);
+			glm::vec3 center(unit(random) * z, unit(random) * 0.5f * z, -z);
+			glm::vec3 halfSize = glm::vec3(size(random), size(random), size(random)) * z;
+			boxes.push_back(AABB(center - halfSize, center + halfSize));
+		}
+
+		std::vector<char> visible(NUM_QUERIES);
+		Clock::time_point start = Clock::now();
+		for (int q = 0; q < NUM_QUERIES; ++q) {
+			visible[q] = buffer.isVisible(boxes[q]);
+		}
+		double queryTime = millisecondsSince(start);
+
+		unsigned int numHidden = 0;
+		bool queriesMatched = true;
+		start = Clock::now();
+		for (int q = 0; q < NUM_QUERIES; ++q) {
+			numHidden += !visible[q];
+			queriesMatched = queriesMatched && referenceVisible(buffer, viewProjection, boxes[q]) == (visible[q] != 0);
+		}
+		double scanTime = millisecondsSince(start);
+
+		matched = matched && depthsMatched && queriesMatched;
+		std::cout << counts[c] << "\t" << serialTime << "\t\t" << jobsTime << "\t\t"
+			<< 1000 * queryTime / NUM_QUERIES << "\t\t" << 1000 * scanTime / NUM_QUERIES << "\t\t"
+			<< numHidden << "\t" << (depthsMatched && queriesMatched ? "ok" : "MISMATCH") << std::endl;
+	}
+	return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
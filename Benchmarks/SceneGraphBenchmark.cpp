@@ -0,0 +1,147 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "SceneObject.h"
+#include "JobSystem.h"
+#include "BenchmarkTimer.h"
+
+/*Times world transform propagation over a 100K node scene graph, the way
+Scene::updateSceneGraph runs it: one job per root, large subtrees split further.
+Runs once without the job system as the serial reference, then with more and more
+workers, and checks every node ends up with the serial result*/
+
+//a scene object with no geometry, only its transform matters here
+class BenchmarkNode : public SceneObject {
+	void sendThisGeometryToShadowMap() {}
+	void drawThisSceneObject(Scene*) {}
+};
+
+static const unsigned int NUM_NODES = 100000;
+static const int ITERATIONS = 50;
+
+struct Shape {
+	const char* name;
+	unsigned int numRoots;
+	unsigned int fanout;
+};
+
+//breadth first, node i of a subtree hangs off node (i - 1) / fanout of the same subtree
+static void buildGraph(const Shape& shape, std::vector<BenchmarkNode*>& nodes, std::vector<SceneObject*>& roots) {
+
+	unsigned int perRoot = NUM_NODES / shape.numRoots;
+	for (unsigned int r = 0; r < shape.numRoots; ++r) {
+
+		unsigned int first = nodes.size();
+		for (unsigned int i = 0; i < perRoot; ++i) {
+			BenchmarkNode* node = new BenchmarkNode();
+			node->setLocalPosition(glm::vec3((float)(i % 7), (float)(i % 5), (float)(i % 3)));
+			node->setLocalRotation(glm::rotate(glm::mat4(1.0f), 0.01f * (i % 11), glm::vec3(0, 1, 0)));
+			if (i > 0) {
+				nodes[first + (i - 1) / shape.fanout]->addChild(node);
+			}
+			nodes.push_back(node);
+		}
+		roots.push_back(nodes[first]);
+	}
+}
+
+//moves the first num_moved roots, then propagates every root as its own job
+static double update(std::vector<SceneObject*>& roots, unsigned int num_moved, int iteration) {
+
+	for (unsigned int i = 0; i < num_moved; ++i) {
+		roots[i]->setLocalRotation(glm::rotate(glm::mat4(1.0f), 0.001f * iteration, glm::vec3(0, 0, 1)));
+	}
+
+	Clock::time_point start = Clock::now();
+	JobSystem::Counter transformsDone;
+	for (unsigned int i = 0; i < roots.size(); ++i) {
+		SceneObject* root = roots[i];
+		JobSystem::run([root]() { root->updateWorldTransforms(false); }, &transformsDone);
+	}
+	JobSystem::wait(&transformsDone);
+	return millisecondsSince(start);
+}
+
+static double averageUpdate(std::vector<SceneObject*>& roots, unsigned int num_moved) {
+
+	//first update brings everything current, it isn't counted
+	update(roots, roots.size(), 0);
+	double total = 0;
+	for (int i = 1; i <= ITERATIONS; ++i) {
+		total += update(roots, num_moved, i);
+	}
+	return total / ITERATIONS;
+}
+
+static std::vector<glm::vec3> worldPositions(const std::vector<BenchmarkNode*>& nodes) {
+	std::vector<glm::vec3> positions;
+	for (unsigned int i = 0; i < nodes.size(); ++i) {
+		positions.push_back(glm::vec3(nodes[i]->getToWorld()[3]));
+	}
+	return positions;
+}
+
+int main() {
+
+	Shape shapes[] = {
+		{ "16 roots, fanout 8", 16, 8 },
+		{ "1 root, fanout 4", 1, 4 },
+		{ "1000 roots, fanout 2", 1000, 2 },
+	};
+
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	std::vector<unsigned int> workerCounts;
+	for (unsigned int workers = 1; workers < hardwareThreads; workers *= 2) {
+		workerCounts.push_back(workers);
+	}
+	if (hardwareThreads > 1 && workerCounts.back() != hardwareThreads - 1) {
+		workerCounts.push_back(hardwareThreads - 1);
+	}
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << NUM_NODES << " nodes, " << ITERATIONS << " updates per run, " << hardwareThreads << " hardware threads" << std::endl;
+
+	bool allMatched = true;
+	for (unsigned int s = 0; s < sizeof(shapes) / sizeof(Shape); ++s) {
+
+		std::vector<BenchmarkNode*> nodes;
+		std::vector<SceneObject*> roots;
+		buildGraph(shapes[s], nodes, roots);
+
+		std::cout << std::endl << shapes[s].name << std::endl;
+		std::cout << "threads\tall moved ms\tone moved ms\tspeedup" << std::endl;
+
+		//job system not initialized, run behaves like a plain call
+		double serialAll = averageUpdate(roots, roots.size());
+		double serialOne = averageUpdate(roots, 1);
+		std::vector<glm::vec3> reference = worldPositions(nodes);
+		std::cout << "serial\t" << serialAll << "\t\t" << serialOne << "\t\t1.000" << std::endl;
+
+		for (unsigned int w = 0; w < workerCounts.size(); ++w) {
+
+			JobSystem::init(workerCounts[w]);
+			double all = averageUpdate(roots, roots.size());
+			double one = averageUpdate(roots, 1);
+			std::vector<glm::vec3> positions = worldPositions(nodes);
+			JobSystem::dispose();
+
+			for (unsigned int i = 0; i < positions.size(); ++i) {
+				if (glm::length(positions[i] - reference[i]) > 1e-3f) {
+					std::cout << "node " << i << " differs from the serial update" << std::endl;
+					allMatched = false;
+					break;
+				}
+			}
+			std::cout << workerCounts[w] + 1 << "\t" << all << "\t\t" << one << "\t\t" << serialAll / all << std::endl;
+		}
+
+		for (unsigned int i = 0; i < nodes.size(); ++i) {
+			delete nodes[i];
+		}
+	}
+
+	return allMatched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
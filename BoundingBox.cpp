@@ -1,114 +1,105 @@
 #include "BoundingBox.h"
-#include "Scene.h"
+#include "Model.h"
+#include "ConvexHull.h"
+#include "DebugDraw.h"
+#include <cfloat>
+#include <xmmintrin.h>
 BoundingBox::BoundingBox(std::vector<glm::vec3> verts) {
 	meshVertices = verts;
-
-	//init box vertices
-	for (int i = 0; i < 24; ++i) {
-		boxVertices.push_back(glm::vec3(0, 0, 0));
-	}
-
-	//init material
-	material.setSurfaceColor(glm::vec3(0, 0, 1));
-	material.setUseSurfaceColor(true);
-	
-
-	//prepare buffers
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glBufferData(GL_ARRAY_BUFFER, boxVertices.size() * sizeof(glm::vec3), boxVertices.data(), GL_STATIC_DRAW);
+	localBounds = AABB::fromPoints(meshVertices);
+	tightFit = false;
+	owner = NULL;
+}
+//the mesh is shared with every model of the same file, so its vertices aren't copied
+BoundingBox::BoundingBox(Model* owner_model) {
+	localBounds = owner_model->getMeshBounds();
+	tightFit = false;
+	owner = owner_model;
+	update();
 }
 BoundingBox::~BoundingBox() {
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);	
 }
 
-void BoundingBox::updateToWorld(glm::mat4 toWorld) {
-
-
-	lowest = toWorld * glm::vec4(meshVertices.at(0).x, meshVertices.at(0).y, meshVertices.at(0).z, 1);
-	highest = toWorld * glm::vec4(meshVertices.at(0).x, meshVertices.at(0).y, meshVertices.at(0).z, 1);
-	for (unsigned int i = 0; i < meshVertices.size(); ++i) {
-		
-		//find current vertex coords in world coordinates
-		glm::vec4 currVertex = toWorld * glm::vec4(meshVertices.at(i).x, meshVertices.at(i).y, meshVertices.at(i).z, 1);
-
-		if (currVertex.x < lowest.x)
-			lowest.x = currVertex.x;
-		if (currVertex.y < lowest.y)
-			lowest.y = currVertex.y;
-		if (currVertex.z < lowest.z)
-			lowest.z = currVertex.z;
-
-		if (currVertex.x > highest.x)
-			highest.x = currVertex.x;
-		if (currVertex.y > highest.y)
-			highest.y = currVertex.y;
-		if (currVertex.z > highest.z)
-			highest.z = currVertex.z;
-
-	}//END FOR
-	
-	//X
-	boxVertices.at(0) = glm::vec3(lowest.x, lowest.y, lowest.z);
-	boxVertices.at(1) = glm::vec3(highest.x, lowest.y, lowest.z);
-	boxVertices.at(2) = glm::vec3(lowest.x, lowest.y, highest.z);
-	boxVertices.at(3) = glm::vec3(highest.x, lowest.y, highest.z);
-	boxVertices.at(4) = glm::vec3(lowest.x, highest.y, lowest.z);
-	boxVertices.at(5) = glm::vec3(highest.x, highest.y, lowest.z);
-	boxVertices.at(6) = glm::vec3(lowest.x, highest.y, highest.z);
-	boxVertices.at(7) = glm::vec3(highest.x, highest.y, highest.z);
-	
-	//Y
-	boxVertices.at(8) = glm::vec3(lowest.x, lowest.y, lowest.z);
-	boxVertices.at(9) = glm::vec3(lowest.x, highest.y, lowest.z);
-	boxVertices.at(10) = glm::vec3(lowest.x, lowest.y, highest.z);
-	boxVertices.at(11) = glm::vec3(lowest.x, highest.y, highest.z);
-	boxVertices.at(12) = glm::vec3(highest.x, lowest.y, lowest.z);
-	boxVertices.at(13) = glm::vec3(highest.x, highest.y, lowest.z);
-	boxVertices.at(14) = glm::vec3(highest.x, lowest.y, highest.z);
-	boxVertices.at(15) = glm::vec3(highest.x, highest.y, highest.z);
-
-	//Y
-	boxVertices.at(16) = glm::vec3(lowest.x, lowest.y, lowest.z);
-	boxVertices.at(17) = glm::vec3(lowest.x, lowest.y, highest.z);
-	boxVertices.at(18) = glm::vec3(lowest.x, highest.y, lowest.z);
-	boxVertices.at(19) = glm::vec3(lowest.x, highest.y, highest.z);
-	boxVertices.at(20) = glm::vec3(highest.x, lowest.y, lowest.z);
-	boxVertices.at(21) = glm::vec3(highest.x, lowest.y, highest.z);
-	boxVertices.at(22) = glm::vec3(highest.x, highest.y, lowest.z);
-	boxVertices.at(23) = glm::vec3(highest.x, highest.y, highest.z);
-
-	//update VBO for new box vertices positions
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, boxVertices.size() * sizeof(glm::vec3), boxVertices.data(), GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+//follow the owning model, safe to call from job threads
+void BoundingBox::update() {
+	if (owner != NULL) {
+		updateToWorld(owner->getToWorldWithCenteredMesh());
+	}
 }
-void BoundingBox::draw(Scene* currScene) {
-
-	glUseProgram(Material::getShaderProgram());
 
-	Camera* activeCamera = currScene->getActiveCamera();
-
-	//apply object boundingbox properties	
-	glUniformMatrix4fv(glGetUniformLocation(material.getShaderProgram(), "toWorld"), 1, GL_FALSE, &glm::mat4(1.0f)[0][0]);
+/*only touches CPU side data so the scene can run it off the main thread.
+The default fit transforms the local box (Arvo), so the cost does not depend on
+the mesh; tight mode reduces over the transformed convex hull instead*/
+void BoundingBox::updateToWorld(glm::mat4 toWorld) {
 
-	//apply camera properties
-	activeCamera->applySettings(Material::getShaderProgram());
-	
-	//apply material properties
-	material.applySettings();
+	if (!tightFit) {
+		AABB worldBounds = localBounds.transformed(toWorld);
+		lowest = worldBounds.lowest;
+		highest = worldBounds.highest;
+	}
+	else {
+		__m128 lowX = _mm_set1_ps(FLT_MAX), lowY = lowX, lowZ = lowX;
+		__m128 highX = _mm_set1_ps(-FLT_MAX), highY = highX, highZ = highX;
+
+		for (unsigned int i = 0; i < hullX.size(); i += 4) {
+
+			__m128 x = _mm_loadu_ps(&hullX[i]);
+			__m128 y = _mm_loadu_ps(&hullY[i]);
+			__m128 z = _mm_loadu_ps(&hullZ[i]);
+
+			__m128 worldX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(toWorld[0][0])), _mm_mul_ps(y, _mm_set1_ps(toWorld[1][0]))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(toWorld[2][0])), _mm_set1_ps(toWorld[3][0])));
+			__m128 worldY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(toWorld[0][1])), _mm_mul_ps(y, _mm_set1_ps(toWorld[1][1]))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(toWorld[2][1])), _mm_set1_ps(toWorld[3][1])));
+			__m128 worldZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(toWorld[0][2])), _mm_mul_ps(y, _mm_set1_ps(toWorld[1][2]))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(toWorld[2][2])), _mm_set1_ps(toWorld[3][2])));
+
+			lowX = _mm_min_ps(lowX, worldX);
+			lowY = _mm_min_ps(lowY, worldY);
+			lowZ = _mm_min_ps(lowZ, worldZ);
+			highX = _mm_max_ps(highX, worldX);
+			highY = _mm_max_ps(highY, worldY);
+			highZ = _mm_max_ps(highZ, worldZ);
+		}
+
+		//reduce the four lanes
+		float lanes[4];
+		__m128* reduce[6] = { &lowX, &lowY, &lowZ, &highX, &highY, &highZ };
+		float results[6];
+		for (int r = 0; r < 6; ++r) {
+			_mm_storeu_ps(lanes, *reduce[r]);
+			results[r] = lanes[0];
+			for (int lane = 1; lane < 4; ++lane) {
+				results[r] = r < 3 ? glm::min(results[r], lanes[lane]) : glm::max(results[r], lanes[lane]);
+			}
+		}
+		lowest = glm::vec3(results[0], results[1], results[2]);
+		highest = glm::vec3(results[3], results[4], results[5]);
+	}
+}
+//batched with every other debug line, drawn when the scene flushes them
+void BoundingBox::draw(glm::vec3 color) {
+	DebugDraw::box(getBounds(), color);
+}
 
-	//Bind VAO for box and draw 
-	glBindVertexArray(VAO);
-	glLineWidth(3);
-	glDrawArrays(GL_LINES, 0, boxVertices.size());
-	glBindVertexArray(0);
+/*tight mode follows rotations exactly at the cost of one transform per hull
+vertex, the hull is computed the first time it is turned on*/
+void BoundingBox::setTightFit(bool opt) {
+	if (opt && hullX.empty()) {
+		buildHull();
+	}
+	tightFit = opt && !hullX.empty();
+	update();
+}
+bool BoundingBox::getTightFit() {
+	return tightFit;
+}
 
+AABB BoundingBox::getBounds() const {
+	return AABB(lowest, highest);
+}
+Model* BoundingBox::getOwner() {
+	return owner;
 }
 
 bool BoundingBox::isCollidingWith(const BoundingBox* other) {
@@ -127,4 +118,36 @@ bool BoundingBox::isCollidingWith(const BoundingBox* other) {
 		return false;
 
 	return true;
-}
\ No newline at end of file
+}
+
+//Private Helpers
+void BoundingBox::buildHull() {
+
+	//models already carry a hull for collision, reuse it
+	ConvexHull hull;
+	if (owner == NULL) {
+		hull.build(meshVertices);
+	}
+	const ConvexHull& meshHull = owner != NULL ? owner->getCollisionHull() : hull;
+
+	//flat or degenerate meshes have no hull, fall back to every vertex
+	if (owner != NULL && meshHull.getVertices().empty()) {
+		meshVertices = owner->getVertices();
+	}
+	const std::vector<glm::vec3>& hullVertices = meshHull.getVertices().empty() ? meshVertices : meshHull.getVertices();
+	if (hullVertices.empty()) {
+		return;
+	}
+
+	//pad to a multiple of four by repeating the first vertex, which can't change the result
+	unsigned int paddedSize = (hullVertices.size() + 3) & ~3u;
+	hullX.resize(paddedSize);
+	hullY.resize(paddedSize);
+	hullZ.resize(paddedSize);
+	for (unsigned int i = 0; i < paddedSize; ++i) {
+		glm::vec3 vertex = hullVertices[i < hullVertices.size() ? i : 0];
+		hullX[i] = vertex.x;
+		hullY[i] = vertex.y;
+		hullZ[i] = vertex.z;
+	}
+}
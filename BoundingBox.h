@@ -5,27 +5,41 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
 #include "Material.h"
+#include "AABB.h"
 
-class Scene;
+class Model;
 class BoundingBox {
 	
 	//fields
 	glm::vec3 lowest;
 	glm::vec3 highest;
 	std::vector<glm::vec3> meshVertices;
-	std::vector<glm::vec3> boxVertices;
 
+	//mesh extents in object space, found once and transformed per update
+	AABB localBounds;
 
-	//drawing
-	Material material;
-	GLuint VAO, VBO;
+	//tight mode: hull vertices as padded x/y/z arrays for 4-wide transforms
+	bool tightFit;
+	std::vector<float> hullX, hullY, hullZ;
+
+	//model this box follows when updated by the scene, may be NULL
+	Model* owner;
 
 
 public:
 	BoundingBox(std::vector<glm::vec3> verts);
+	BoundingBox(Model* owner_model);
 	~BoundingBox();
 
 	bool isCollidingWith(const BoundingBox* other);
+	AABB getBounds() const;
+	Model* getOwner();
+	void setTightFit(bool opt);
+	bool getTightFit();
+	void update();
 	void updateToWorld(glm::mat4 toWorld);
-	void draw(Scene* currScene);
+	void draw(glm::vec3 color);
+
+private:
+	void buildHull();
 };
\ No newline at end of file
@@ -0,0 +1,475 @@
+#include "BroadPhase.h"
+#include "BoundingBox.h"
+#include <algorithm>
+#include <cmath>
+
+BroadPhase::BroadPhase() {
+	method = SWEEP_AND_PRUNE;
+	cellSize = 4.0f;
+	numProxies = 0;
+}
+
+void BroadPhase::setMethod(Method new_method) {
+
+	if (new_method == method) {
+		return;
+	}
+	method = new_method;
+
+	//sorted lists go stale while the grid is in use, so they are rebuilt on the way back
+	if (method == SWEEP_AND_PRUNE) {
+		rebuildEndpoints();
+	}
+	else {
+		for (int axis = 0; axis < 3; ++axis) {
+			endpoints[axis].clear();
+		}
+		for (unsigned int i = 0; i < proxies.size(); ++i) {
+			proxies[i].sorted = false;
+		}
+		pendingProxies.clear();
+	}
+}
+BroadPhase::Method BroadPhase::getMethod() {
+	return method;
+}
+void BroadPhase::setCellSize(float size) {
+	cellSize = size;
+}
+
+int BroadPhase::add(BoundingBox* box) {
+
+	unsigned int proxy;
+	if (!freeProxies.empty()) {
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else {
+		proxy = proxies.size();
+		proxies.push_back(Proxy());
+	}
+	proxies[proxy].box = box;
+	proxies[proxy].sorted = false;
+	++numProxies;
+
+	//endpoints are placed on the next update, when many boxes arrive at once a full sort is cheaper
+	if (method == SWEEP_AND_PRUNE) {
+		pendingProxies.push_back(proxy);
+	}
+	return proxy;
+}
+
+void BroadPhase::remove(int proxy) {
+
+	removeAllPairs(proxy);
+
+	if (proxies[proxy].sorted) {
+		for (int axis = 0; axis < 3; ++axis) {
+
+			std::vector<Endpoint>& list = endpoints[axis];
+			unsigned int minIndex = proxies[proxy].minIndex[axis];
+			unsigned int maxIndex = proxies[proxy].maxIndex[axis];
+			list.erase(list.begin() + maxIndex);
+			list.erase(list.begin() + minIndex);
+
+			//everything after the removed min shifted down
+			for (unsigned int i = minIndex; i < list.size(); ++i) {
+				if (list[i].isMax)
+					proxies[list[i].proxy].maxIndex[axis] = i;
+				else
+					proxies[list[i].proxy].minIndex[axis] = i;
+			}
+		}
+	}
+	else {
+		pendingProxies.erase(std::remove(pendingProxies.begin(), pendingProxies.end(), (unsigned int)proxy), pendingProxies.end());
+	}
+
+	proxies[proxy].box = NULL;
+	proxies[proxy].sorted = false;
+	freeProxies.push_back(proxy);
+	--numProxies;
+}
+
+void BroadPhase::clear() {
+	proxies.clear();
+	freeProxies.clear();
+	pendingProxies.clear();
+	numProxies = 0;
+	for (int axis = 0; axis < 3; ++axis) {
+		endpoints[axis].clear();
+	}
+	pairs.clear();
+	pairKeys.clear();
+	pairIndices.clear();
+	cells.clear();
+}
+
+void BroadPhase::update() {
+
+	if (method == UNIFORM_GRID) {
+		updateGrid();
+		return;
+	}
+
+	//a large batch of new boxes is sorted from scratch instead of one insertion sort each
+	if (pendingProxies.size() * 8 > numProxies) {
+		rebuildEndpoints();
+		return;
+	}
+
+	//boxes usually move a little between frames, so only a few endpoints swap
+	for (unsigned int i = 0; i < proxies.size(); ++i) {
+		if (proxies[i].sorted) {
+			updateEndpoints(i, proxies[i].box->getBounds());
+		}
+	}
+
+	for (unsigned int i = 0; i < pendingProxies.size(); ++i) {
+		insertEndpoints(pendingProxies[i], proxies[pendingProxies[i]].box->getBounds());
+	}
+	pendingProxies.clear();
+}
+
+const std::vector<BroadPhase::Pair>& BroadPhase::getPairs() const {
+	return pairs;
+}
+unsigned int BroadPhase::getNumProxies() const {
+	return numProxies;
+}
+
+
+//PRIVATE HELPERS
+
+/*new endpoints start at the end of each list and sort down. Pairs are only
+reported on the last axis, once the other two already hold the box in place*/
+void BroadPhase::insertEndpoints(unsigned int proxy, const AABB& bounds) {
+
+	for (int axis = 0; axis < 3; ++axis) {
+
+		std::vector<Endpoint>& list = endpoints[axis];
+
+		Endpoint minPoint = { bounds.lowest[axis], proxy, false };
+		Endpoint maxPoint = { bounds.highest[axis], proxy, true };
+		proxies[proxy].minIndex[axis] = list.size();
+		list.push_back(minPoint);
+		proxies[proxy].maxIndex[axis] = list.size();
+		list.push_back(maxPoint);
+	}
+	proxies[proxy].sorted = true;
+
+	for (int axis = 0; axis < 3; ++axis) {
+		sortMinDown(axis, proxies[proxy].minIndex[axis], axis == 2);
+		sortMaxDown(axis, proxies[proxy].maxIndex[axis]);
+	}
+}
+
+/*growing moves come before shrinking ones so a box's min never passes its own max*/
+void BroadPhase::updateEndpoints(unsigned int proxy, const AABB& bounds) {
+
+	for (int axis = 0; axis < 3; ++axis) {
+
+		Endpoint& minPoint = endpoints[axis][proxies[proxy].minIndex[axis]];
+		Endpoint& maxPoint = endpoints[axis][proxies[proxy].maxIndex[axis]];
+
+		float minDelta = bounds.lowest[axis] - minPoint.value;
+		float maxDelta = bounds.highest[axis] - maxPoint.value;
+		if (minDelta == 0.0f && maxDelta == 0.0f) {
+			continue;
+		}
+		minPoint.value = bounds.lowest[axis];
+		maxPoint.value = bounds.highest[axis];
+
+		if (minDelta < 0.0f)
+			sortMinDown(axis, proxies[proxy].minIndex[axis], true);
+		if (maxDelta > 0.0f)
+			sortMaxUp(axis, proxies[proxy].maxIndex[axis], true);
+		if (minDelta > 0.0f)
+			sortMinUp(axis, proxies[proxy].minIndex[axis]);
+		if (maxDelta < 0.0f)
+			sortMaxDown(axis, proxies[proxy].maxIndex[axis]);
+	}
+}
+
+//full sort of every axis and one sweep along x to find the starting pairs
+void BroadPhase::rebuildEndpoints() {
+
+	pairs.clear();
+	pairKeys.clear();
+	pairIndices.clear();
+	pendingProxies.clear();
+
+	for (int axis = 0; axis < 3; ++axis) {
+
+		std::vector<Endpoint>& list = endpoints[axis];
+		list.clear();
+		for (unsigned int i = 0; i < proxies.size(); ++i) {
+			if (proxies[i].box == NULL)
+				continue;
+
+			AABB bounds = proxies[i].box->getBounds();
+			Endpoint minPoint = { bounds.lowest[axis], i, false };
+			Endpoint maxPoint = { bounds.highest[axis], i, true };
+			list.push_back(minPoint);
+			list.push_back(maxPoint);
+		}
+
+		//mins first on ties, matching what the insertion sorts would produce
+		std::sort(list.begin(), list.end(), [](const Endpoint& a, const Endpoint& b) {
+			return a.value < b.value || (a.value == b.value && !a.isMax && b.isMax);
+		});
+
+		for (unsigned int i = 0; i < list.size(); ++i) {
+			if (list[i].isMax)
+				proxies[list[i].proxy].maxIndex[axis] = i;
+			else
+				proxies[list[i].proxy].minIndex[axis] = i;
+		}
+	}
+
+	std::vector<unsigned int> active;
+	for (unsigned int i = 0; i < endpoints[0].size(); ++i) {
+
+		const Endpoint& point = endpoints[0][i];
+		if (point.isMax) {
+			active.erase(std::find(active.begin(), active.end(), point.proxy));
+			continue;
+		}
+
+		for (unsigned int j = 0; j < active.size(); ++j) {
+			if (overlapsOnOtherAxes(point.proxy, active[j], 0)) {
+				addPair(point.proxy, active[j]);
+			}
+		}
+		active.push_back(point.proxy);
+		proxies[point.proxy].sorted = true;
+	}
+}
+
+//min moving left past a max: the two boxes start overlapping on this axis
+void BroadPhase::sortMinDown(int axis, unsigned int index, bool update_pairs) {
+
+	std::vector<Endpoint>& list = endpoints[axis];
+	Endpoint moving = list[index];
+
+	while (index > 0 && list[index - 1].value > moving.value) {
+
+		const Endpoint& previous = list[index - 1];
+		if (previous.isMax) {
+			if (update_pairs && overlapsOnOtherAxes(moving.proxy, previous.proxy, axis)) {
+				addPair(moving.proxy, previous.proxy);
+			}
+			proxies[previous.proxy].maxIndex[axis] = index;
+		}
+		else {
+			proxies[previous.proxy].minIndex[axis] = index;
+		}
+		list[index] = previous;
+		--index;
+	}
+	list[index] = moving;
+	proxies[moving.proxy].minIndex[axis] = index;
+}
+
+//min moving right past a max: the two boxes separate on this axis
+void BroadPhase::sortMinUp(int axis, unsigned int index) {
+
+	std::vector<Endpoint>& list = endpoints[axis];
+	Endpoint moving = list[index];
+
+	while (index + 1 < list.size() && list[index + 1].value < moving.value) {
+
+		const Endpoint& next = list[index + 1];
+		if (next.isMax) {
+			if (overlapsOnOtherAxes(moving.proxy, next.proxy, axis)) {
+				removePair(moving.proxy, next.proxy);
+			}
+			proxies[next.proxy].maxIndex[axis] = index;
+		}
+		else {
+			proxies[next.proxy].minIndex[axis] = index;
+		}
+		list[index] = next;
+		++index;
+	}
+	list[index] = moving;
+	proxies[moving.proxy].minIndex[axis] = index;
+}
+
+//max moving left past a min: the two boxes separate on this axis
+void BroadPhase::sortMaxDown(int axis, unsigned int index) {
+
+	std::vector<Endpoint>& list = endpoints[axis];
+	Endpoint moving = list[index];
+
+	while (index > 0 && list[index - 1].value > moving.value) {
+
+		const Endpoint& previous = list[index - 1];
+		if (!previous.isMax) {
+			if (overlapsOnOtherAxes(moving.proxy, previous.proxy, axis)) {
+				removePair(moving.proxy, previous.proxy);
+			}
+			proxies[previous.proxy].minIndex[axis] = index;
+		}
+		else {
+			proxies[previous.proxy].maxIndex[axis] = index;
+		}
+		list[index] = previous;
+		--index;
+	}
+	list[index] = moving;
+	proxies[moving.proxy].maxIndex[axis] = index;
+}
+
+//max moving right past a min: the two boxes start overlapping on this axis
+void BroadPhase::sortMaxUp(int axis, unsigned int index, bool update_pairs) {
+
+	std::vector<Endpoint>& list = endpoints[axis];
+	Endpoint moving = list[index];
+
+	while (index + 1 < list.size() && list[index + 1].value < moving.value) {
+
+		const Endpoint& next = list[index + 1];
+		if (!next.isMax) {
+			if (update_pairs && overlapsOnOtherAxes(moving.proxy, next.proxy, axis)) {
+				addPair(moving.proxy, next.proxy);
+			}
+			proxies[next.proxy].minIndex[axis] = index;
+		}
+		else {
+			proxies[next.proxy].maxIndex[axis] = index;
+		}
+		list[index] = next;
+		++index;
+	}
+	list[index] = moving;
+	proxies[moving.proxy].maxIndex[axis] = index;
+}
+
+/*compares list positions rather than values so the answer agrees with the sort order.
+A pair can only exist while its boxes overlap on the other two axes, so separating
+swaps check this first and skip the pair lookup for the common case*/
+bool BroadPhase::overlapsOnOtherAxes(unsigned int a, unsigned int b, int axis) const {
+
+	for (int other = 0; other < 3; ++other) {
+		if (other == axis)
+			continue;
+		if (proxies[a].maxIndex[other] < proxies[b].minIndex[other] || proxies[b].maxIndex[other] < proxies[a].minIndex[other])
+			return false;
+	}
+	return true;
+}
+
+/*Every box is dropped into the cells it covers, then each box is tested against
+lower numbered boxes sharing a cell. A pair is only kept in the cell holding the
+low corner of the two boxes' intersection, so it is reported once even when the
+boxes share several cells*/
+void BroadPhase::updateGrid() {
+
+	pairs.clear();
+	pairKeys.clear();
+	pairIndices.clear();
+
+	//keep cell storage around, unless the scene moved on and left too many stale cells
+	if (cells.size() > 4 * numProxies + 64) {
+		cells.clear();
+	}
+	for (std::unordered_map<unsigned long long, std::vector<unsigned int> >::iterator it = cells.begin(); it != cells.end(); ++it) {
+		it->second.clear();
+	}
+
+	float inverseCellSize = 1.0f / cellSize;
+	auto cellKey = [](int x, int y, int z) {
+		return ((unsigned long long)(x & 0x1FFFFF) << 42) | ((unsigned long long)(y & 0x1FFFFF) << 21) | (unsigned long long)(z & 0x1FFFFF);
+	};
+
+	std::vector<AABB> bounds(proxies.size());
+	for (unsigned int i = 0; i < proxies.size(); ++i) {
+		if (proxies[i].box == NULL)
+			continue;
+
+		bounds[i] = proxies[i].box->getBounds();
+		glm::ivec3 low = glm::ivec3(glm::floor(bounds[i].lowest * inverseCellSize));
+		glm::ivec3 high = glm::ivec3(glm::floor(bounds[i].highest * inverseCellSize));
+		for (int x = low.x; x <= high.x; ++x)
+			for (int y = low.y; y <= high.y; ++y)
+				for (int z = low.z; z <= high.z; ++z)
+					cells[cellKey(x, y, z)].push_back(i);
+	}
+
+	for (unsigned int i = 0; i < proxies.size(); ++i) {
+		if (proxies[i].box == NULL)
+			continue;
+
+		glm::ivec3 low = glm::ivec3(glm::floor(bounds[i].lowest * inverseCellSize));
+		glm::ivec3 high = glm::ivec3(glm::floor(bounds[i].highest * inverseCellSize));
+		for (int x = low.x; x <= high.x; ++x)
+			for (int y = low.y; y <= high.y; ++y)
+				for (int z = low.z; z <= high.z; ++z) {
+
+					const std::vector<unsigned int>& cell = cells[cellKey(x, y, z)];
+					for (unsigned int j = 0; j < cell.size() && cell[j] < i; ++j) {
+
+						unsigned int other = cell[j];
+						if (!bounds[i].overlaps(bounds[other]))
+							continue;
+
+						//cells wrap at 2^21, so compare real coordinates rather than keys
+						glm::ivec3 owner = glm::ivec3(glm::floor(glm::max(bounds[i].lowest, bounds[other].lowest) * inverseCellSize));
+						if (owner == glm::ivec3(x, y, z)) {
+							addPair(i, other);
+						}
+					}
+				}
+	}
+}
+
+void BroadPhase::addPair(unsigned int a, unsigned int b) {
+
+	unsigned long long key = pairKey(a, b);
+	if (pairIndices.count(key)) {
+		return;
+	}
+
+	Pair pair = { proxies[a].box, proxies[b].box };
+	pairIndices[key] = pairs.size();
+	pairs.push_back(pair);
+	pairKeys.push_back(key);
+}
+
+//swap with the last pair so removal stays constant time
+void BroadPhase::removePair(unsigned int a, unsigned int b) {
+
+	std::unordered_map<unsigned long long, unsigned int>::iterator found = pairIndices.find(pairKey(a, b));
+	if (found == pairIndices.end()) {
+		return;
+	}
+
+	unsigned int index = found->second;
+	pairIndices.erase(found);
+
+	if (index != pairs.size() - 1) {
+		pairs[index] = pairs.back();
+		pairKeys[index] = pairKeys.back();
+		pairIndices[pairKeys[index]] = index;
+	}
+	pairs.pop_back();
+	pairKeys.pop_back();
+}
+
+void BroadPhase::removeAllPairs(unsigned int proxy) {
+
+	for (int i = pairs.size() - 1; i >= 0; --i) {
+		unsigned int a = (unsigned int)(pairKeys[i] >> 32);
+		unsigned int b = (unsigned int)(pairKeys[i] & 0xFFFFFFFF);
+		if (a == proxy || b == proxy) {
+			removePair(a, b);
+		}
+	}
+}
+
+unsigned long long BroadPhase::pairKey(unsigned int a, unsigned int b) {
+	if (a > b)
+		std::swap(a, b);
+	return ((unsigned long long)a << 32) | b;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <unordered_map>
+#include <vector>
+#include "AABB.h"
+
+class BoundingBox;
+
+/*Finds every pair of overlapping bounding boxes once per frame. The default
+method is incremental sweep and prune: box endpoints stay sorted on all three
+axes between frames, so coherent motion only needs a few swaps and pairs are
+added or removed exactly when endpoints cross. A uniform grid rebuilt every
+frame is available for scenes where most objects move far each frame*/
+class BroadPhase {
+
+public:
+	enum Method { SWEEP_AND_PRUNE, UNIFORM_GRID };
+
+	struct Pair {
+		BoundingBox* a;
+		BoundingBox* b;
+	};
+
+private:
+
+	struct Endpoint {
+		float value;
+		unsigned int proxy;
+		bool isMax;
+	};
+
+	struct Proxy {
+		BoundingBox* box;				//NULL while on the free list
+		bool sorted;					//endpoints are in the axis lists
+		unsigned int minIndex[3];		//positions of this box's endpoints in each axis list
+		unsigned int maxIndex[3];
+	};
+
+	Method method;
+	float cellSize;
+
+	std::vector<Proxy> proxies;
+	std::vector<unsigned int> freeProxies;
+	std::vector<unsigned int> pendingProxies;	//added since the last update
+	unsigned int numProxies;
+	std::vector<Endpoint> endpoints[3];
+
+	//current overlaps, the map locates a pair in the list for constant time removal
+	std::vector<Pair> pairs;
+	std::vector<unsigned long long> pairKeys;
+	std::unordered_map<unsigned long long, unsigned int> pairIndices;
+
+	//uniform grid scratch, kept between frames to avoid reallocating
+	std::unordered_map<unsigned long long, std::vector<unsigned int> > cells;
+
+public:
+	BroadPhase();
+
+	void setMethod(Method new_method);
+	Method getMethod();
+	void setCellSize(float size);
+
+	//the returned proxy identifies the box until it is removed
+	int add(BoundingBox* box);
+	void remove(int proxy);
+	void clear();
+
+	//read current bounds of every box and bring the pair list up to date
+	void update();
+
+	const std::vector<Pair>& getPairs() const;
+	unsigned int getNumProxies() const;
+
+private:
+	void insertEndpoints(unsigned int proxy, const AABB& bounds);
+	void updateEndpoints(unsigned int proxy, const AABB& bounds);
+	void rebuildEndpoints();
+
+	void sortMinDown(int axis, unsigned int index, bool update_pairs);
+	void sortMinUp(int axis, unsigned int index);
+	void sortMaxDown(int axis, unsigned int index);
+	void sortMaxUp(int axis, unsigned int index, bool update_pairs);
+	bool overlapsOnOtherAxes(unsigned int a, unsigned int b, int axis) const;
+
+	void updateGrid();
+
+	void addPair(unsigned int a, unsigned int b);
+	void removePair(unsigned int a, unsigned int b);
+	void removeAllPairs(unsigned int proxy);
+	static unsigned long long pairKey(unsigned int a, unsigned int b);
+};
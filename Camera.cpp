@@ -1,10 +1,15 @@
 #include "Camera.h"
 #include "Scene.h"
+#include "GLState.h"
+#include "DebugDraw.h"
 Camera::Camera(glm::vec3 camera_position, float camera_field_of_view_Y) {
 
 	//SceneObject Position
 	setLocalPosition(camera_position);
 
+	//gizmos only, nothing to draw into shadow maps
+	setCastsShadows(false);
+
 	//Camera Mode
 	targetMode = false;
 
@@ -23,6 +28,7 @@ Camera::Camera(glm::vec3 camera_position, float camera_field_of_view_Y) {
 	blurValue = 0;
 
 	//update view and projection matrices to reflect camera properties
+	settingsVersion = 0;
 	updateViewMatrix();
 	updateProjectionMatrix();
 
@@ -30,22 +36,9 @@ Camera::Camera(glm::vec3 camera_position, float camera_field_of_view_Y) {
 	for (unsigned int i = 0; i < 16; ++i) {
 		gizmosPoints.push_back(glm::vec3(0, 0, 0));
 	}
-
-	//prepare buffers
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, gizmosPoints.size() * sizeof(glm::vec3), gizmosPoints.data(), GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
 }
 
 Camera::~Camera() {
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
 }
 	
 
@@ -56,15 +49,19 @@ void Camera::resize(float camera_width, float camera_height) {
 
 	updateProjectionMatrix();
 	updateGizmos();
+
+	//gizmo shape changed, bounds need refreshing
+	transformDirty = true;
 }
 
 void Camera::applySettings(GLuint currShaderProgram) {
 
+	//send camera properties to current shader program, unless it still has them from an earlier object
+	GLState::useProgram(currShaderProgram);
+	if (!GLState::needsUniforms(currShaderProgram, this, settingsVersion, 3))
+		return;
 
 	glm::vec3 worldPosition = getPosition(SceneObject::WORLD);
-
-	//send camera properties to current shader program
-	glUseProgram(currShaderProgram);
 	glUniformMatrix4fv(glGetUniformLocation(currShaderProgram, "projection"), 1, GL_FALSE, &ProjectionMatrix[0][0]);
 	glUniformMatrix4fv(glGetUniformLocation(currShaderProgram, "view"), 1, GL_FALSE, &ViewMatrix[0][0]);
 	glUniform3f(glGetUniformLocation(currShaderProgram, "camPosition"), worldPosition.x, worldPosition.y, worldPosition.z);
@@ -72,6 +69,13 @@ void Camera::applySettings(GLuint currShaderProgram) {
 
 }
 
+glm::mat4 Camera::getViewMatrix() {
+	return ViewMatrix;
+}
+glm::mat4 Camera::getProjectionMatrix() {
+	return ProjectionMatrix;
+}
+
 void Camera::setTargetMode(bool target_mode) {
 	if (target_mode == true && targetObject == NULL) {
 		std::cerr << "No target Scene Object set" << std::endl;
@@ -123,6 +127,10 @@ void Camera::drawThisSceneObject(Scene* currScene) {
 
 	drawGizmos(currScene);
 }
+bool Camera::getLocalBounds(AABB& bounds) const {
+	bounds = AABB::fromPoints(gizmosPoints);
+	return true;
+}
 
 //Private Helpers
 void Camera::updateViewMatrix() {
@@ -139,8 +147,9 @@ void Camera::updateViewMatrix() {
 
 	//non target mode
 	if (!targetMode) {
-		ViewMatrix = glm::inverse(toWorld);
+		ViewMatrix = glm::inverse(getToWorld());
 	}
+	++settingsVersion;
 }
 
 void Camera::updateProjectionMatrix() {
@@ -149,6 +158,7 @@ void Camera::updateProjectionMatrix() {
 	{
 		ProjectionMatrix = glm::perspective(fieldOfViewY, (float)width / (float)height, near, far);
 	}
+	++settingsVersion;
 }
 
 void Camera::updateGizmos() {
@@ -185,15 +195,6 @@ void Camera::updateGizmos() {
 	gizmosPoints[13] = lowerRight;
 	gizmosPoints[14] = lowerRight;
 	gizmosPoints[15] = upperRight;
-
-	//update VBO for new gizmos vertices positions
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, gizmosPoints.size() * sizeof(glm::vec3), gizmosPoints.data(), GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
 }
 void Camera::drawGizmos(Scene* currScene) {
 
@@ -204,23 +205,6 @@ void Camera::drawGizmos(Scene* currScene) {
 		return;
 	}
 
-	glUseProgram(Material::getShaderProgram());
-
-	//apply object properties	
-	glUniformMatrix4fv(glGetUniformLocation(Material::getShaderProgram(), "toWorld"), 1, GL_FALSE, &toWorld[0][0]);
-
-	//apply camera properties
-	activeCamera->applySettings(Material::getShaderProgram());
-
-	//apply material properties
-	Material m;
-	m.setSurfaceColor(glm::vec3(0.5, 1, 0.5));
-	m.setUseSurfaceColor(true);
-	m.applySettings();
-
-	//Bind VAO for gizmos and draw 
-	glBindVertexArray(VAO);
-	glLineWidth(2);
-	glDrawArrays(GL_LINES, 0, gizmosPoints.size());
-	glBindVertexArray(0);
+	//batched with every other debug line, drawn when the scene flushes them
+	DebugDraw::lines(gizmosPoints, toWorld, glm::vec3(0.5, 1, 0.5));
 }
\ No newline at end of file
@@ -26,9 +26,11 @@ class Camera : public SceneObject {
 	glm::mat4 ViewMatrix;
 	glm::mat4 ProjectionMatrix;
 
+	//bumped whenever the matrices are, programs already holding this version aren't sent them again
+	unsigned int settingsVersion;
+
 	//Camera gizmos
 	std::vector<glm::vec3> gizmosPoints;
-	GLuint VAO, VBO;
 
 public:
 
@@ -38,6 +40,8 @@ public:
 	void updateViewMatrix();
 	void resize(float camera_width, float camera_height);
 	void applySettings(GLuint currShaderProgram);
+	glm::mat4 getViewMatrix();
+	glm::mat4 getProjectionMatrix();
 
 
 	void setTargetMode(bool targetMode);
@@ -61,6 +65,7 @@ public:
 	//override
 	void sendThisGeometryToShadowMap();
 	void drawThisSceneObject(Scene* currScene);
+	bool getLocalBounds(AABB& bounds) const;
 
 private:
 
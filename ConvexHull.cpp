@@ -0,0 +1,261 @@
+#include "ConvexHull.h"
+#include <algorithm>
+#include <cfloat>
+#include <iostream>
+#include <map>
+#include <utility>
+
+//orders points so exact duplicates can be removed
+static bool lessThanPoint(const glm::vec3& a, const glm::vec3& b) {
+	if (a.x != b.x)
+		return a.x < b.x;
+	if (a.y != b.y)
+		return a.y < b.y;
+	return a.z < b.z;
+}
+static bool equalPoint(const glm::vec3& a, const glm::vec3& b) {
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+ConvexHull::ConvexHull() {
+}
+ConvexHull::ConvexHull(const std::vector<glm::vec3>& input_points) {
+	build(input_points);
+}
+
+/*Incremental hull: start from a tetrahedron of far apart points, then for each
+point outside the current hull remove the faces it can see and stitch the horizon
+to it. Degenerate (flat or linear) clouds keep all unique points as vertices*/
+void ConvexHull::build(const std::vector<glm::vec3>& input_points) {
+
+	points = input_points;
+	faces.clear();
+	vertices.clear();
+	edgeFaces.clear();
+
+	std::sort(points.begin(), points.end(), lessThanPoint);
+	points.erase(std::unique(points.begin(), points.end(), equalPoint), points.end());
+
+	if (points.size() < 4) {
+		vertices = points;
+		return;
+	}
+
+	//tolerance relative to the size of the cloud
+	glm::vec3 lowest = points[0];
+	glm::vec3 highest = points[0];
+	for (unsigned int i = 0; i < points.size(); ++i) {
+		lowest = glm::min(lowest, points[i]);
+		highest = glm::max(highest, points[i]);
+	}
+	float epsilon = glm::length(highest - lowest) * 1e-5f;
+
+	//initial tetrahedron: extremes in x, farthest from their line, farthest from that plane
+	int p0 = 0;
+	int p1 = points.size() - 1;
+
+	int p2 = -1;
+	float bestDistance = epsilon;
+	glm::vec3 lineDirection = glm::normalize(points[p1] - points[p0]);
+	for (unsigned int i = 0; i < points.size(); ++i) {
+		glm::vec3 offset = points[i] - points[p0];
+		float distance = glm::length(offset - lineDirection * glm::dot(offset, lineDirection));
+		if (distance > bestDistance) {
+			bestDistance = distance;
+			p2 = i;
+		}
+	}
+	if (p2 < 0) {
+		vertices = points;
+		return;
+	}
+
+	int p3 = -1;
+	bestDistance = epsilon;
+	glm::vec3 planeNormal = glm::normalize(glm::cross(points[p1] - points[p0], points[p2] - points[p0]));
+	for (unsigned int i = 0; i < points.size(); ++i) {
+		float distance = fabs(glm::dot(points[i] - points[p0], planeNormal));
+		if (distance > bestDistance) {
+			bestDistance = distance;
+			p3 = i;
+		}
+	}
+	if (p3 < 0) {
+		vertices = points;
+		return;
+	}
+
+	glm::vec3 interior = (points[p0] + points[p1] + points[p2] + points[p3]) * 0.25f;
+	addFace(p0, p1, p2, interior);
+	addFace(p0, p1, p3, interior);
+	addFace(p0, p2, p3, interior);
+	addFace(p1, p2, p3, interior);
+
+	std::vector<int> visible;
+	std::vector<int> stack;
+	std::vector<std::pair<int, int> > horizon;
+	bool closed = true;
+	for (unsigned int i = 0; i < points.size(); ++i) {
+
+		if ((int)i == p0 || (int)i == p1 || (int)i == p2 || (int)i == p3) {
+			continue;
+		}
+
+		//seed with the face the point is farthest in front of
+		int seed = -1;
+		float seedDistance = epsilon;
+		for (unsigned int f = 0; f < faces.size(); ++f) {
+			float distance = glm::dot(faces[f].normal, points[i]) - faces[f].offset;
+			if (faces[f].alive && distance > seedDistance) {
+				seedDistance = distance;
+				seed = f;
+			}
+		}
+		if (seed < 0) {
+			continue;
+		}
+
+		/*grow the visible region across shared edges only, so it stays connected
+		and its boundary (the horizon) is a single loop even with near coplanar faces*/
+		visible.clear();
+		horizon.clear();
+		stack.clear();
+		stack.push_back(seed);
+		faces[seed].alive = false;
+		while (!stack.empty() && closed) {
+
+			int f = stack.back();
+			stack.pop_back();
+			visible.push_back(f);
+
+			int corners[3] = { faces[f].a, faces[f].b, faces[f].c };
+			for (int c = 0; c < 3; ++c) {
+
+				//every edge of a closed hull has its reverse on the neighboring face
+				std::pair<int, int> edge(corners[c], corners[(c + 1) % 3]);
+				std::map<std::pair<int, int>, int>::const_iterator twin = edgeFaces.find(std::make_pair(edge.second, edge.first));
+				if (twin == edgeFaces.end()) {
+					closed = false;
+					break;
+				}
+				int neighbor = twin->second;
+
+				if (!faces[neighbor].alive) {
+					continue;
+				}
+				if (glm::dot(faces[neighbor].normal, points[i]) - faces[neighbor].offset > 0) {
+					faces[neighbor].alive = false;
+					stack.push_back(neighbor);
+				}
+				else {
+					horizon.push_back(edge);
+				}
+			}
+		}
+
+		if (!closed) {
+			break;
+		}
+
+		for (unsigned int v = 0; v < visible.size(); ++v) {
+			Face& face = faces[visible[v]];
+			edgeFaces.erase(std::make_pair(face.a, face.b));
+			edgeFaces.erase(std::make_pair(face.b, face.c));
+			edgeFaces.erase(std::make_pair(face.c, face.a));
+		}
+		for (unsigned int e = 0; e < horizon.size(); ++e) {
+			addFace(horizon[e].first, horizon[e].second, i, interior);
+		}
+	}
+
+	/*rounding left the surface open, a hull can't be trusted from here. All unique
+	points are still a correct, if slower, stand in for support and bounds*/
+	if (!closed) {
+		std::cerr << "Convex hull of " << points.size() << " points lost an edge, keeping every point" << std::endl;
+		faces.clear();
+		vertices = points;
+		edgeFaces.clear();
+		return;
+	}
+
+	//compact, keeping only points referenced by surviving faces
+	std::vector<Face> aliveFaces;
+	std::vector<int> remap(points.size(), -1);
+	std::vector<glm::vec3> hullPoints;
+	for (unsigned int f = 0; f < faces.size(); ++f) {
+
+		if (!faces[f].alive) {
+			continue;
+		}
+
+		Face face = faces[f];
+		int* corners[3] = { &face.a, &face.b, &face.c };
+		for (int c = 0; c < 3; ++c) {
+			if (remap[*corners[c]] < 0) {
+				remap[*corners[c]] = hullPoints.size();
+				hullPoints.push_back(points[*corners[c]]);
+			}
+			*corners[c] = remap[*corners[c]];
+		}
+		aliveFaces.push_back(face);
+	}
+
+	points = hullPoints;
+	faces = aliveFaces;
+	vertices = hullPoints;
+	edgeFaces.clear();
+}
+
+const std::vector<glm::vec3>& ConvexHull::getVertices() const {
+	return vertices;
+}
+
+//three points per face, empty for degenerate hulls
+void ConvexHull::getTriangles(std::vector<glm::vec3>& triangle_vertices) const {
+	for (unsigned int f = 0; f < faces.size(); ++f) {
+		triangle_vertices.push_back(points[faces[f].a]);
+		triangle_vertices.push_back(points[faces[f].b]);
+		triangle_vertices.push_back(points[faces[f].c]);
+	}
+}
+
+//farthest hull vertex along direction
+glm::vec3 ConvexHull::getSupport(glm::vec3 direction) const {
+
+	glm::vec3 best(0, 0, 0);
+	float bestDot = -FLT_MAX;
+	for (unsigned int i = 0; i < vertices.size(); ++i) {
+		float d = glm::dot(vertices[i], direction);
+		if (d > bestDot) {
+			bestDot = d;
+			best = vertices[i];
+		}
+	}
+	return best;
+}
+
+//PRIVATE HELPERS
+
+//orient so the normal faces away from a point known to be inside
+void ConvexHull::addFace(int a, int b, int c, glm::vec3 interior_point) {
+
+	Face face;
+	face.a = a;
+	face.b = b;
+	face.c = c;
+	face.normal = glm::normalize(glm::cross(points[b] - points[a], points[c] - points[a]));
+	face.offset = glm::dot(face.normal, points[a]);
+	face.alive = true;
+
+	if (glm::dot(face.normal, interior_point) - face.offset > 0) {
+		std::swap(face.b, face.c);
+		face.normal = -face.normal;
+		face.offset = -face.offset;
+	}
+
+	int index = faces.size();
+	edgeFaces[std::make_pair(face.a, face.b)] = index;
+	edgeFaces[std::make_pair(face.b, face.c)] = index;
+	edgeFaces[std::make_pair(face.c, face.a)] = index;
+	faces.push_back(face);
+}
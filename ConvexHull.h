@@ -0,0 +1,36 @@
+#pragma once
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <map>
+#include <utility>
+#include <vector>
+
+/*3D convex hull of a point cloud, built once (e.g. per mesh) and then used wherever
+only the extreme points of a shape matter: tight bounds, support mapping, etc.*/
+class ConvexHull {
+
+	struct Face {
+		int a, b, c;			//indices into points, counter clockwise seen from outside
+		glm::vec3 normal;
+		float offset;			//dot(normal, point on plane)
+		bool alive;
+	};
+
+	std::vector<glm::vec3> points;		//unique input points
+	std::vector<Face> faces;
+	std::map<std::pair<int, int>, int> edgeFaces;	//directed edge to the face it belongs to
+	std::vector<glm::vec3> vertices;	//points that ended up on the hull
+
+public:
+	ConvexHull();
+	ConvexHull(const std::vector<glm::vec3>& input_points);
+
+	void build(const std::vector<glm::vec3>& input_points);
+
+	const std::vector<glm::vec3>& getVertices() const;
+	void getTriangles(std::vector<glm::vec3>& triangle_vertices) const;
+	glm::vec3 getSupport(glm::vec3 direction) const;
+
+private:
+	void addFace(int a, int b, int c, glm::vec3 interior_point);
+};
@@ -0,0 +1,123 @@
+#include "DebugDraw.h"
+#include "Camera.h"
+#include "FrameRing.h"
+#include "GLState.h"
+#include "shader.h"
+
+GLuint DebugDraw::shaderProgram = 0;
+GLuint DebugDraw::VAO = 0;
+GLuint DebugDraw::fallbackBuffer = 0;
+GLsizeiptr DebugDraw::fallbackBufferSize = 0;
+std::vector<DebugDraw::Vertex> DebugDraw::vertices;
+DebugDraw::Stats DebugDraw::stats;
+
+void DebugDraw::initStatics() {
+
+	shaderProgram = LoadShaders("../shader_debug.vert", "../shader_debug.frag");
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &fallbackBuffer);
+	fallbackBufferSize = 0;
+	stats.lines = 0;
+	stats.draws = 0;
+}
+void DebugDraw::cleanUpStatics() {
+	GLState::deleteProgram(shaderProgram);
+	GLState::deleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &fallbackBuffer);
+	vertices.clear();
+}
+
+void DebugDraw::line(const glm::vec3& from, const glm::vec3& to, const glm::vec3& color) {
+
+	Vertex vertex;
+	vertex.color = color;
+	vertex.position = from;
+	vertices.push_back(vertex);
+	vertex.position = to;
+	vertices.push_back(vertex);
+}
+
+void DebugDraw::lines(const std::vector<glm::vec3>& points, const glm::mat4& to_world, const glm::vec3& color) {
+
+	Vertex vertex;
+	vertex.color = color;
+	for (unsigned int i = 0; i + 1 < points.size(); i += 2) {
+		vertex.position = glm::vec3(to_world * glm::vec4(points[i], 1));
+		vertices.push_back(vertex);
+		vertex.position = glm::vec3(to_world * glm::vec4(points[i + 1], 1));
+		vertices.push_back(vertex);
+	}
+}
+
+void DebugDraw::box(const AABB& box, const glm::vec3& color) {
+
+	//corner i takes highest on the axes whose bit is set, x = 1, y = 2, z = 4
+	glm::vec3 corners[8];
+	for (int i = 0; i < 8; ++i) {
+		corners[i] = glm::vec3(i & 1 ? box.highest.x : box.lowest.x, i & 2 ? box.highest.y : box.lowest.y, i & 4 ? box.highest.z : box.lowest.z);
+	}
+
+	//edges along x, then y, then z
+	static const int edges[24] = { 0,1, 2,3, 4,5, 6,7, 0,2, 1,3, 4,6, 5,7, 0,4, 1,5, 2,6, 3,7 };
+
+	Vertex vertex;
+	vertex.color = color;
+	for (int i = 0; i < 24; ++i) {
+		vertex.position = corners[edges[i]];
+		vertices.push_back(vertex);
+	}
+}
+
+void DebugDraw::flush(Camera* camera) {
+
+	stats.lines = vertices.size() / 2;
+	stats.draws = 0;
+	if (vertices.empty())
+		return;
+
+	GLsizeiptr dataSize = vertices.size() * sizeof(Vertex);
+
+	//first vertex found from the offset, so ring allocations are aligned to whole vertices
+	FrameRing::Allocation allocation;
+	if (!FrameRing::upload(vertices.data(), dataSize, sizeof(Vertex), allocation)) {
+		if (dataSize > fallbackBufferSize) {
+			fallbackBufferSize = dataSize * 2;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, fallbackBuffer);
+		glBufferData(GL_ARRAY_BUFFER, fallbackBufferSize, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, dataSize, vertices.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		allocation.buffer = fallbackBuffer;
+		allocation.offset = 0;
+	}
+	pointArrayAt(allocation.buffer);
+
+	GLState::useProgram(shaderProgram);
+	camera->applySettings(shaderProgram);
+	GLState::lineWidth(LINE_WIDTH);
+	glDrawArrays(GL_LINES, allocation.offset / sizeof(Vertex), vertices.size());
+	GLState::bindVertexArray(0);
+
+	stats.draws = 1;
+	vertices.clear();
+}
+
+DebugDraw::Stats DebugDraw::getStats() {
+	return stats;
+}
+
+//PRIVATE HELPERS
+
+/*once per flush, the ring's buffer is replaced when it grows and may come back
+under the same name. Leaves the vertex array bound*/
+void DebugDraw::pointArrayAt(GLuint buffer) {
+
+	GLState::bindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)sizeof(glm::vec3));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
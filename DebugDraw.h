@@ -0,0 +1,64 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "AABB.h"
+
+class Camera;
+
+/*Immediate mode debug lines. Anything can add lines or boxes while the frame is
+drawn, they are kept in world space with a color per vertex and flushed in one
+draw with a flat color shader. Vertices go through the frame ring, or one
+orphaned buffer without it, so thousands of boxes cost a copy rather than a draw
+call and uniform upload each*/
+class DebugDraw {
+
+public:
+
+	const static int LINE_WIDTH = 2;
+
+	//the last flush
+	struct Stats {
+		unsigned int lines;
+		unsigned int draws;
+	};
+
+private:
+
+	struct Vertex {
+		glm::vec3 position;
+		glm::vec3 color;
+	};
+
+	static GLuint shaderProgram;
+	static GLuint VAO;
+	static GLuint fallbackBuffer;
+	static GLsizeiptr fallbackBufferSize;
+
+	static std::vector<Vertex> vertices;
+	static Stats stats;
+
+public:
+
+	//manage statics
+	static void initStatics();
+	static void cleanUpStatics();
+
+	static void line(const glm::vec3& from, const glm::vec3& to, const glm::vec3& color);
+
+	//points taken in pairs, each a line in to_world's space
+	static void lines(const std::vector<glm::vec3>& points, const glm::mat4& to_world, const glm::vec3& color);
+
+	//the twelve edges of a world space box
+	static void box(const AABB& box, const glm::vec3& color);
+
+	//draws everything added since the last flush, as seen by camera
+	static void flush(Camera* camera);
+
+	static Stats getStats();
+
+private:
+	static void pointArrayAt(GLuint buffer);
+};
@@ -0,0 +1,152 @@
+#include "FrameRing.h"
+#include <cstring>
+
+GLuint FrameRing::buffer = 0;
+char* FrameRing::mappedData = NULL;
+GLsizeiptr FrameRing::regionSize = 0;
+int FrameRing::currRegion = 0;
+GLintptr FrameRing::head = 0;
+RegionFences FrameRing::fences(FrameRing::NUM_FRAMES);
+GLsizeiptr FrameRing::overflowSize = 0;
+FrameRing::Stats FrameRing::frameStats;
+FrameRing::Stats FrameRing::lastFrameStats;
+
+void FrameRing::initStatics() {
+
+	frameStats.allocations = 0;
+	frameStats.bytesAllocated = 0;
+	frameStats.failedAllocations = 0;
+	frameStats.fenceWaits = 0;
+	frameStats.waitMilliseconds = 0;
+	lastFrameStats = frameStats;
+	overflowSize = 0;
+
+	if (!GLEW_ARB_buffer_storage)
+		return;
+
+	createBuffer(INITIAL_REGION_SIZE);
+}
+void FrameRing::cleanUpStatics() {
+	destroyBuffer();
+}
+
+bool FrameRing::isPersistent() {
+	return mappedData != NULL;
+}
+
+void FrameRing::beginFrame() {
+
+	lastFrameStats = frameStats;
+	frameStats.allocations = 0;
+	frameStats.bytesAllocated = 0;
+	frameStats.failedAllocations = 0;
+	frameStats.fenceWaits = 0;
+	frameStats.waitMilliseconds = 0;
+
+	if (!isPersistent())
+		return;
+
+	//last frame didn't fit, every region is drained before the buffer is replaced
+	if (overflowSize > 0) {
+		GLsizeiptr newSize = regionSize * 2;
+		while (newSize < regionSize + overflowSize) {
+			newSize *= 2;
+		}
+		for (int i = 0; i < NUM_FRAMES; ++i) {
+			waitForRegion(i);
+		}
+		destroyBuffer();
+		createBuffer(newSize);
+	}
+	overflowSize = 0;
+
+	waitForRegion(currRegion);
+	head = 0;
+}
+
+//fence the region written this frame and move on to the next
+void FrameRing::endFrame() {
+
+	if (!isPersistent())
+		return;
+
+	fences.fence(currRegion);
+	currRegion = (currRegion + 1) % NUM_FRAMES;
+}
+
+bool FrameRing::upload(const void* data, GLsizeiptr size, GLsizeiptr alignment, Allocation& allocation) {
+
+	if (!isPersistent()) {
+		++frameStats.failedAllocations;
+		return false;
+	}
+
+	//aligned within the whole buffer, which is what binding offsets are checked against
+	GLintptr regionStart = currRegion * regionSize;
+	GLintptr offset = (regionStart + head + alignment - 1) / alignment * alignment;
+	if (offset + size > regionStart + regionSize) {
+		overflowSize += size + alignment;
+		++frameStats.failedAllocations;
+		return false;
+	}
+
+	//coherent mapping, visible to the GPU without an explicit flush
+	memcpy(mappedData + offset, data, size);
+	head = offset + size - regionStart;
+
+	allocation.buffer = buffer;
+	allocation.offset = offset;
+	++frameStats.allocations;
+	frameStats.bytesAllocated += size;
+	return true;
+}
+
+GLsizeiptr FrameRing::getStorageAlignment() {
+
+	if (!GLEW_VERSION_4_3)
+		return 1;
+	GLint alignment = 256;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	return alignment;
+}
+
+FrameRing::Stats FrameRing::getStats() {
+	return lastFrameStats;
+}
+
+//PRIVATE HELPERS
+
+void FrameRing::createBuffer(GLsizeiptr region_size) {
+
+	regionSize = region_size;
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferStorage(GL_ARRAY_BUFFER, NUM_FRAMES * regionSize, NULL, flags);
+	mappedData = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, NUM_FRAMES * regionSize, flags);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	currRegion = 0;
+	head = 0;
+}
+
+void FrameRing::destroyBuffer() {
+
+	fences.clear();
+	if (mappedData != NULL) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		mappedData = NULL;
+	}
+	if (buffer != 0) {
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+}
+
+void FrameRing::waitForRegion(int region) {
+	if (fences.wait(region, frameStats.waitMilliseconds))
+		++frameStats.fenceWaits;
+}
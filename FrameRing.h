@@ -0,0 +1,78 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "RegionFences.h"
+
+/*Transient memory for data rewritten every frame: instance matrices, indirect
+commands, debug lines. One buffer is persistently and coherently mapped and
+split into NUM_FRAMES regions used round robin, each fenced when its frame ends.
+Within a frame allocations just bump a head through the current region, so
+writing never orphans, reallocates, or waits on the driver. The only possible
+stall is a region still being read when its turn comes round again, those waits
+are counted and timed. Without buffer storage, or once a frame's region is full,
+allocations fail and callers upload the old way. A frame that overflowed grows
+the ring before the next one*/
+class FrameRing {
+
+public:
+
+	const static int NUM_FRAMES = 3;
+	const static GLsizeiptr INITIAL_REGION_SIZE = 1 << 20;
+
+	struct Allocation {
+		GLuint buffer;
+		GLintptr offset;
+	};
+
+	//the last complete frame
+	struct Stats {
+		unsigned int allocations;
+		unsigned int bytesAllocated;
+		unsigned int failedAllocations;	//uploads that fell back to their caller's own buffer
+		unsigned int fenceWaits;		//frames whose region was still in use by the GPU
+		float waitMilliseconds;			//CPU time spent on those waits
+	};
+
+private:
+
+	static GLuint buffer;
+	static char* mappedData;
+	static GLsizeiptr regionSize;
+	static int currRegion;
+	static GLintptr head;
+	static RegionFences fences;
+
+	//bytes this frame couldn't fit, the ring grows by at least as much
+	static GLsizeiptr overflowSize;
+
+	static Stats frameStats;
+	static Stats lastFrameStats;
+
+public:
+
+	//manage statics
+	static void initStatics();
+	static void cleanUpStatics();
+
+	static bool isPersistent();
+
+	//waits for the region about to be reused, then starts allocating from it
+	static void beginFrame();
+	static void endFrame();
+
+	/*copies size bytes into the current region at an offset that is a multiple of
+	alignment, which need not be a power of two. False when nothing was written*/
+	static bool upload(const void* data, GLsizeiptr size, GLsizeiptr alignment, Allocation& allocation);
+
+	//alignment for ranges bound as shader storage, 1 when unsupported
+	static GLsizeiptr getStorageAlignment();
+
+	static Stats getStats();
+
+private:
+	static void createBuffer(GLsizeiptr region_size);
+	static void destroyBuffer();
+	static void waitForRegion(int region);
+};
@@ -0,0 +1,102 @@
+#include "Frustum.h"
+#include <cmath>
+#include <cfloat>
+#include <xmmintrin.h>
+
+Frustum::Frustum() {
+	update(glm::mat4(1.0f));
+}
+
+//Gribb/Hartmann extraction, rows of the matrix combined pairwise
+void Frustum::update(const glm::mat4& view_projection) {
+
+	glm::vec4 row0(view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0]);
+	glm::vec4 row1(view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1]);
+	glm::vec4 row2(view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2]);
+	glm::vec4 row3(view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3]);
+
+	planes[LEFT] = row3 + row0;
+	planes[RIGHT] = row3 - row0;
+	planes[BOTTOM] = row3 + row1;
+	planes[TOP] = row3 - row1;
+	planes[NEAR_PLANE] = row3 + row2;
+	planes[FAR_PLANE] = row3 - row2;
+
+	for (int i = 0; i < 8; ++i) {
+
+		glm::vec4 plane = planes[i < 6 ? i : 0];
+		float magnitude = glm::length(glm::vec3(plane));
+		if (magnitude > 0) {
+			plane = plane / magnitude;
+		}
+		if (i < 6) {
+			planes[i] = plane;
+		}
+
+		planeX[i] = plane.x;
+		planeY[i] = plane.y;
+		planeZ[i] = plane.z;
+		planeD[i] = plane.w;
+		absPlaneX[i] = fabs(plane.x);
+		absPlaneY[i] = fabs(plane.y);
+		absPlaneZ[i] = fabs(plane.z);
+	}
+}
+
+void Frustum::dropPlane(int plane) {
+
+	//zero normal, so every box is this far in front of it
+	planes[plane] = glm::vec4(0, 0, 0, FLT_MAX);
+	for (int i = 0; i < 8; ++i) {
+		if ((i < 6 ? i : 0) == plane) {
+			planeX[i] = planeY[i] = planeZ[i] = 0;
+			absPlaneX[i] = absPlaneY[i] = absPlaneZ[i] = 0;
+			planeD[i] = FLT_MAX;
+		}
+	}
+}
+
+/*center/extents test: the box is outside a plane when its center is further behind
+it than the box's projected radius, fully inside when it is in front by that much*/
+int Frustum::classify(const AABB& box) const {
+
+	glm::vec3 center = box.getCenter();
+	glm::vec3 extents = box.getExtents();
+
+	__m128 centerX = _mm_set1_ps(center.x);
+	__m128 centerY = _mm_set1_ps(center.y);
+	__m128 centerZ = _mm_set1_ps(center.z);
+	__m128 extentX = _mm_set1_ps(extents.x);
+	__m128 extentY = _mm_set1_ps(extents.y);
+	__m128 extentZ = _mm_set1_ps(extents.z);
+	__m128 zero = _mm_setzero_ps();
+
+	int outsideMask = 0;
+	int intersectMask = 0;
+	for (int batch = 0; batch < 8; batch += 4) {
+
+		__m128 distance = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(planeX + batch), centerX), _mm_mul_ps(_mm_loadu_ps(planeY + batch), centerY)),
+			_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(planeZ + batch), centerZ), _mm_loadu_ps(planeD + batch)));
+
+		__m128 radius = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(absPlaneX + batch), extentX), _mm_mul_ps(_mm_loadu_ps(absPlaneY + batch), extentY)),
+			_mm_mul_ps(_mm_loadu_ps(absPlaneZ + batch), extentZ));
+
+		outsideMask |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+		intersectMask |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), zero));
+	}
+
+	if (outsideMask != 0)
+		return OUTSIDE;
+	if (intersectMask != 0)
+		return INTERSECTING;
+	return INSIDE;
+}
+bool Frustum::intersects(const AABB& box) const {
+	return classify(box) != OUTSIDE;
+}
+
+glm::vec4 Frustum::getPlane(int plane) const {
+	return planes[plane];
+}
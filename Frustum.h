@@ -0,0 +1,31 @@
+#pragma once
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "AABB.h"
+
+/*View volume as six inward facing planes. Planes are kept twice: as vectors for
+readers and as padded structure of arrays so boxes are tested four planes at a time*/
+class Frustum {
+
+	glm::vec4 planes[6];
+
+	//SSE friendly copies, entries 6 and 7 repeat plane 0
+	float planeX[8], planeY[8], planeZ[8], planeD[8];
+	float absPlaneX[8], absPlaneY[8], absPlaneZ[8];
+
+public:
+
+	enum Planes { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE };
+	enum Result { OUTSIDE, INTERSECTING, INSIDE };
+
+	Frustum();
+	void update(const glm::mat4& view_projection);
+
+	//stop a plane from rejecting anything, e.g. the near plane of a shadow volume extended toward its light
+	void dropPlane(int plane);
+
+	int classify(const AABB& box) const;
+	bool intersects(const AABB& box) const;
+
+	glm::vec4 getPlane(int plane) const;
+};
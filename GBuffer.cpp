@@ -0,0 +1,72 @@
+#include "GBuffer.h"
+#include <cstdlib>
+#include "GLState.h"
+
+GBuffer::GBuffer() {
+	frameBuffer = 0;
+	for (int i = 0; i < NUM_COLOR_TARGETS; ++i) {
+		drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+	}
+}
+
+//targets match the window, recreated on every resize like the frame texture
+void GBuffer::resize(int width, int height) {
+
+	dispose();
+
+	glGenFramebuffers(1, &frameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+
+	//normals need the range and precision, the rest are colors
+	const GLint internalFormats[NUM_COLOR_TARGETS] = { GL_RGBA8, GL_RGBA16F, GL_RGBA8, GL_RGBA8 };
+	for (int i = 0; i < NUM_COLOR_TARGETS; ++i) {
+		colorTextures[i].generatePlainTexture();
+		GLState::bindTexture(GL_TEXTURE_2D, colorTextures[i].getID());
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], width, height, 0, GL_RGBA, GL_FLOAT, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glFramebufferTexture(GL_FRAMEBUFFER, drawBuffers[i], colorTextures[i].getID(), 0);
+	}
+
+	depthTexture.generatePlainTexture();
+	GLState::bindTexture(GL_TEXTURE_2D, depthTexture.getID());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture.getID(), 0);
+
+	glDrawBuffers(NUM_COLOR_TARGETS, drawBuffers);
+
+	//Validate FBO
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "G-buffer's status reported incomplete" << std::endl;
+		exit(1);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GBuffer::dispose() {
+
+	for (int i = 0; i < NUM_COLOR_TARGETS; ++i) {
+		colorTextures[i].disposeCurrentTexture();
+	}
+	depthTexture.disposeCurrentTexture();
+	if (frameBuffer != 0) {
+		glDeleteFramebuffers(1, &frameBuffer);
+		frameBuffer = 0;
+	}
+}
+
+void GBuffer::bindForWriting() {
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+}
+
+void GBuffer::applySettings(GLuint shader_program) {
+
+	const char* names[NUM_TEXTURES] = { "gAlbedo", "gNormal", "gSpecular", "gAmbient", "gDepth" };
+	for (int i = 0; i < NUM_TEXTURES; ++i) {
+		glUniform1i(glGetUniformLocation(shader_program, names[i]), i);
+		GLState::activeTexture(GL_TEXTURE0 + i);
+		GLState::bindTexture(GL_TEXTURE_2D, i < NUM_COLOR_TARGETS ? colorTextures[i].getID() : depthTexture.getID());
+	}
+}
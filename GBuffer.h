@@ -0,0 +1,42 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Texture.h"
+
+/*Render targets for the deferred path. The geometry pass writes the material's
+surface into them and the lighting pass reads them back as textures:
+	albedo		rgb: surface color, already multiplied by the diffuse color
+	normal		rgb: world normal, a: 1 if unlit (no diffuse term, albedo passes through)
+	specular	rgb: specular color
+	ambient		rgb: ambient color times surface texture and reflection
+	depth		for rebuilding the world position*/
+class GBuffer {
+
+public:
+	enum Targets { ALBEDO, NORMAL, SPECULAR, AMBIENT, NUM_COLOR_TARGETS };
+
+	//read on units 0 to NUM_TEXTURES - 1, depth after the color targets
+	const static int NUM_TEXTURES = NUM_COLOR_TARGETS + 1;
+
+private:
+
+	GLuint frameBuffer;
+	Texture colorTextures[NUM_COLOR_TARGETS];
+	Texture depthTexture;
+	GLenum drawBuffers[NUM_COLOR_TARGETS];
+
+public:
+
+	GBuffer();
+
+	void resize(int width, int height);
+	void dispose();
+
+	//bind for the geometry pass
+	void bindForWriting();
+
+	//bind the targets as textures for the lighting pass
+	void applySettings(GLuint shader_program);
+};
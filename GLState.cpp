@@ -0,0 +1,210 @@
+#include "GLState.h"
+
+const GLenum GLState::targets[GLState::NUM_TARGETS] = { GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BUFFER, GL_TEXTURE_2D_ARRAY };
+const GLenum GLState::capabilities[GLState::NUM_CAPABILITIES] = { GL_DEPTH_TEST, GL_DEPTH_CLAMP, GL_POLYGON_OFFSET_FILL, GL_SCISSOR_TEST, GL_CULL_FACE, GL_BLEND };
+
+GLuint GLState::program = GLState::UNKNOWN;
+GLuint GLState::vertexArray = GLState::UNKNOWN;
+GLuint GLState::activeUnit = GLState::UNKNOWN;
+GLuint GLState::textures[GLState::MAX_TEXTURE_UNITS][GLState::NUM_TARGETS];
+GLfloat GLState::currLineWidth = -1.0f;
+GLuint GLState::currDepthFunc = GLState::UNKNOWN;
+GLuint GLState::currDepthMask = GLState::UNKNOWN;
+GLuint GLState::enabled[GLState::NUM_CAPABILITIES];
+std::vector<GLState::UniformOwner> GLState::uniformOwners;
+GLState::Stats GLState::frameStats = { 0, 0 };
+GLState::Stats GLState::lastFrameStats = { 0, 0 };
+
+void GLState::reset() {
+
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	activeUnit = UNKNOWN;
+	for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit) {
+		for (int target = 0; target < NUM_TARGETS; ++target) {
+			textures[unit][target] = UNKNOWN;
+		}
+	}
+	currLineWidth = -1.0f;
+	currDepthFunc = UNKNOWN;
+	currDepthMask = UNKNOWN;
+	for (int i = 0; i < NUM_CAPABILITIES; ++i) {
+		enabled[i] = UNKNOWN;
+	}
+	uniformOwners.clear();
+}
+
+void GLState::beginFrame() {
+	lastFrameStats = frameStats;
+	frameStats.issued = 0;
+	frameStats.elided = 0;
+}
+GLState::Stats GLState::getStats() {
+	return lastFrameStats;
+}
+
+void GLState::useProgram(GLuint shader_program) {
+	if (shader_program == program) {
+		++frameStats.elided;
+		return;
+	}
+	glUseProgram(shader_program);
+	program = shader_program;
+	++frameStats.issued;
+}
+void GLState::bindVertexArray(GLuint vertex_array) {
+	if (vertex_array == vertexArray) {
+		++frameStats.elided;
+		return;
+	}
+	glBindVertexArray(vertex_array);
+	vertexArray = vertex_array;
+	++frameStats.issued;
+}
+void GLState::activeTexture(GLenum texture_unit) {
+	GLuint unit = texture_unit - GL_TEXTURE0;
+	if (unit == activeUnit) {
+		++frameStats.elided;
+		return;
+	}
+	glActiveTexture(texture_unit);
+	activeUnit = unit;
+	++frameStats.issued;
+}
+
+//binds to the active unit, like glBindTexture
+void GLState::bindTexture(GLenum target, GLuint texture) {
+
+	int targetIndex = getTargetIndex(target);
+	bool tracked = targetIndex >= 0 && activeUnit < (GLuint)MAX_TEXTURE_UNITS;
+	if (tracked && textures[activeUnit][targetIndex] == texture) {
+		++frameStats.elided;
+		return;
+	}
+	glBindTexture(target, texture);
+	if (tracked) {
+		textures[activeUnit][targetIndex] = texture;
+	}
+	++frameStats.issued;
+}
+void GLState::lineWidth(GLfloat width) {
+	if (width == currLineWidth) {
+		++frameStats.elided;
+		return;
+	}
+	glLineWidth(width);
+	currLineWidth = width;
+	++frameStats.issued;
+}
+void GLState::depthFunc(GLenum func) {
+	if (func == currDepthFunc) {
+		++frameStats.elided;
+		return;
+	}
+	glDepthFunc(func);
+	currDepthFunc = func;
+	++frameStats.issued;
+}
+void GLState::depthMask(GLboolean flag) {
+	if (flag == currDepthMask) {
+		++frameStats.elided;
+		return;
+	}
+	glDepthMask(flag);
+	currDepthMask = flag;
+	++frameStats.issued;
+}
+void GLState::enable(GLenum cap) {
+	setCapability(cap, GL_TRUE);
+}
+void GLState::disable(GLenum cap) {
+	setCapability(cap, GL_FALSE);
+}
+
+/*for uniforms like the camera's, which every object drawn with a program would
+otherwise send again. version changes whenever the owner's values do*/
+bool GLState::needsUniforms(GLuint shader_program, const void* owner, unsigned int version, unsigned int num_calls) {
+
+	for (unsigned int i = 0; i < uniformOwners.size(); ++i) {
+		UniformOwner& entry = uniformOwners[i];
+		if (entry.program != shader_program)
+			continue;
+		if (entry.owner == owner && entry.version == version) {
+			frameStats.elided += num_calls;
+			return false;
+		}
+		entry.owner = owner;
+		entry.version = version;
+		frameStats.issued += num_calls;
+		return true;
+	}
+	UniformOwner entry;
+	entry.program = shader_program;
+	entry.owner = owner;
+	entry.version = version;
+	uniformOwners.push_back(entry);
+	frameStats.issued += num_calls;
+	return true;
+}
+
+//a program in use stays in use until another replaces it, only its uniforms are forgotten
+void GLState::deleteProgram(GLuint shader_program) {
+	for (unsigned int i = 0; i < uniformOwners.size(); ++i) {
+		if (uniformOwners[i].program == shader_program) {
+			uniformOwners.erase(uniformOwners.begin() + i);
+			break;
+		}
+	}
+	glDeleteProgram(shader_program);
+}
+//deleting a bound object rebinds 0 in its place
+void GLState::deleteVertexArrays(GLsizei count, const GLuint* vertex_arrays) {
+	for (GLsizei i = 0; i < count; ++i) {
+		if (vertex_arrays[i] == vertexArray)
+			vertexArray = 0;
+	}
+	glDeleteVertexArrays(count, vertex_arrays);
+}
+void GLState::deleteTextures(GLsizei count, const GLuint* texture_list) {
+	for (GLsizei i = 0; i < count; ++i) {
+		for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit) {
+			for (int target = 0; target < NUM_TARGETS; ++target) {
+				if (textures[unit][target] == texture_list[i])
+					textures[unit][target] = 0;
+			}
+		}
+	}
+	glDeleteTextures(count, texture_list);
+}
+
+//PRIVATE HELPERS
+
+int GLState::getTargetIndex(GLenum target) {
+	for (int i = 0; i < NUM_TARGETS; ++i) {
+		if (targets[i] == target)
+			return i;
+	}
+	return -1;
+}
+int GLState::getCapabilityIndex(GLenum cap) {
+	for (int i = 0; i < NUM_CAPABILITIES; ++i) {
+		if (capabilities[i] == cap)
+			return i;
+	}
+	return -1;
+}
+void GLState::setCapability(GLenum cap, GLuint value) {
+
+	int index = getCapabilityIndex(cap);
+	if (index >= 0 && enabled[index] == value) {
+		++frameStats.elided;
+		return;
+	}
+	if (value == GL_TRUE)
+		glEnable(cap);
+	else
+		glDisable(cap);
+	if (index >= 0)
+		enabled[index] = value;
+	++frameStats.issued;
+}
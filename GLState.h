@@ -0,0 +1,85 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <vector>
+
+/*Every program, vertex array, texture, line width, depth and capability change
+goes through here instead of straight to GL. The last value set is remembered,
+and a call setting what is already current is dropped before it reaches the
+driver. Each function mirrors the GL call it replaces. Objects are forgotten as
+they are deleted, so a reused name is never mistaken for one still bound*/
+class GLState {
+
+public:
+
+	const static int MAX_TEXTURE_UNITS = 16;
+
+	//calls of the last complete frame
+	struct Stats {
+		unsigned int issued;
+		unsigned int elided;
+	};
+
+private:
+
+	//nothing known about it yet, the next call is always issued
+	const static GLuint UNKNOWN = 0xffffffff;
+
+	//texture targets bound per unit, others pass straight through
+	const static int NUM_TARGETS = 4;
+	static const GLenum targets[NUM_TARGETS];
+
+	static GLuint program;
+	static GLuint vertexArray;
+	static GLuint activeUnit;
+	static GLuint textures[MAX_TEXTURE_UNITS][NUM_TARGETS];
+	static GLfloat currLineWidth;
+	static GLuint currDepthFunc;
+	static GLuint currDepthMask;
+
+	//capabilities toggled each frame, UNKNOWN until first set
+	const static int NUM_CAPABILITIES = 6;
+	static const GLenum capabilities[NUM_CAPABILITIES];
+	static GLuint enabled[NUM_CAPABILITIES];
+
+	//uniforms sent alike by many objects, last sent to each program by which owner at which version
+	struct UniformOwner {
+		GLuint program;
+		const void* owner;
+		unsigned int version;
+	};
+	static std::vector<UniformOwner> uniformOwners;
+
+	static Stats frameStats;
+	static Stats lastFrameStats;
+
+public:
+
+	//forget everything, for when GL state was changed behind this class's back
+	static void reset();
+
+	static void beginFrame();
+	static Stats getStats();
+
+	static void useProgram(GLuint shader_program);
+	static void bindVertexArray(GLuint vertex_array);
+	static void activeTexture(GLenum texture_unit);
+	static void bindTexture(GLenum target, GLuint texture);
+	static void lineWidth(GLfloat width);
+	static void depthFunc(GLenum func);
+	static void depthMask(GLboolean flag);
+	static void enable(GLenum cap);
+	static void disable(GLenum cap);
+
+	//true when owner has to send its uniforms to shader_program, which then counts them as sent
+	static bool needsUniforms(GLuint shader_program, const void* owner, unsigned int version, unsigned int num_calls);
+
+	static void deleteProgram(GLuint shader_program);
+	static void deleteVertexArrays(GLsizei count, const GLuint* vertex_arrays);
+	static void deleteTextures(GLsizei count, const GLuint* texture_list);
+
+private:
+	static int getTargetIndex(GLenum target);
+	static int getCapabilityIndex(GLenum cap);
+	static void setCapability(GLenum cap, GLuint value);
+};
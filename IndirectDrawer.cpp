@@ -0,0 +1,144 @@
+#include "IndirectDrawer.h"
+#include "shader.h"
+#include "GLState.h"
+
+GLuint IndirectDrawer::cullProgram = 0;
+GLint IndirectDrawer::planesLocation = -1;
+GLint IndirectDrawer::numCommandsLocation = -1;
+
+void IndirectDrawer::initStatics() {
+	if (!isSupported())
+		return;
+	cullProgram = LoadComputeShader("../shader_cull.comp");
+	planesLocation = glGetUniformLocation(cullProgram, "planes");
+	numCommandsLocation = glGetUniformLocation(cullProgram, "numCommands");
+}
+void IndirectDrawer::cleanUpStatics() {
+	if (cullProgram != 0) {
+		GLState::deleteProgram(cullProgram);
+		cullProgram = 0;
+	}
+}
+
+//multi draw indirect, base instance in the command and compute shaders are all core in 4.3
+bool IndirectDrawer::isSupported() {
+	return GLEW_VERSION_4_3 != 0;
+}
+
+IndirectDrawer::IndirectDrawer() {
+	commandBuffer = 0;
+	commandBufferSize = 0;
+	boundsBuffer = 0;
+	boundsBufferSize = 0;
+	commandSource.buffer = 0;
+	commandSource.offset = 0;
+	boundsSource.buffer = 0;
+	boundsSource.offset = 0;
+}
+
+void IndirectDrawer::init() {
+	glGenBuffers(1, &commandBuffer);
+	glGenBuffers(1, &boundsBuffer);
+	commandBufferSize = 0;
+	boundsBufferSize = 0;
+}
+void IndirectDrawer::dispose() {
+	glDeleteBuffers(1, &commandBuffer);
+	glDeleteBuffers(1, &boundsBuffer);
+	commandBuffer = 0;
+	boundsBuffer = 0;
+	commands.clear();
+	bounds.clear();
+}
+
+void IndirectDrawer::beginFrame() {
+	commands.clear();
+	bounds.clear();
+}
+
+void IndirectDrawer::add(Mesh* mesh, GLuint first_instance, GLuint instance_count) {
+
+	DrawCommand command;
+	command.count = mesh->getNumIndices();
+	command.instanceCount = instance_count;
+	command.firstIndex = mesh->getFirstIndex();
+	command.baseVertex = mesh->getBaseVertex();
+	command.baseInstance = first_instance;
+	commands.push_back(command);
+
+	const AABB& meshBounds = mesh->getBounds();
+	bounds.push_back(glm::vec4(meshBounds.lowest, 1));
+	bounds.push_back(glm::vec4(meshBounds.highest, 1));
+}
+
+unsigned int IndirectDrawer::getNumCommands() {
+	return commands.size();
+}
+
+void IndirectDrawer::upload(bool with_bounds) {
+
+	if (commands.empty())
+		return;
+
+	uploadBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer, commandBufferSize, commands.data(), commands.size() * sizeof(DrawCommand), commandSource);
+	if (with_bounds) {
+		uploadBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer, boundsBufferSize, bounds.data(), bounds.size() * sizeof(glm::vec4), boundsSource);
+	}
+}
+
+void IndirectDrawer::cull(GLuint object_buffer, GLintptr offset, GLsizeiptr size, const Frustum& frustum) {
+
+	if (commands.empty() || cullProgram == 0)
+		return;
+
+	glm::vec4 planes[6];
+	for (int i = 0; i < 6; ++i) {
+		planes[i] = frustum.getPlane(i);
+	}
+
+	GLState::useProgram(cullProgram);
+	glUniform4fv(planesLocation, 6, &planes[0][0]);
+	glUniform1ui(numCommandsLocation, commands.size());
+
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, object_buffer, offset, size);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, boundsSource.buffer, boundsSource.offset, bounds.size() * sizeof(glm::vec4));
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, commandSource.buffer, commandSource.offset, commands.size() * sizeof(DrawCommand));
+	glDispatchCompute((commands.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	//the draws read the instance counts as commands, not through shader storage
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, 0);
+}
+
+void IndirectDrawer::draw(unsigned int first, unsigned int count) {
+
+	if (count == 0)
+		return;
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandSource.buffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (GLvoid*)(commandSource.offset + first * sizeof(DrawCommand)), count, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+//PRIVATE HELPERS
+
+/*into the frame ring, aligned for binding as shader storage. Otherwise into buffer,
+orphaning last frame's storage so the upload doesn't wait on draws still reading it*/
+void IndirectDrawer::uploadBuffer(GLenum target, GLuint buffer, GLsizeiptr& buffer_size, const void* data, GLsizeiptr data_size, FrameRing::Allocation& source) {
+
+	if (FrameRing::upload(data, data_size, FrameRing::getStorageAlignment(), source))
+		return;
+
+	source.buffer = buffer;
+	source.offset = 0;
+	if (data_size > buffer_size) {
+		buffer_size = data_size * 2;
+	}
+	glBindBuffer(target, buffer);
+	glBufferData(target, buffer_size, NULL, GL_STREAM_DRAW);
+	glBufferSubData(target, 0, data_size, data);
+	glBindBuffer(target, 0);
+}
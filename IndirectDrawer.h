@@ -0,0 +1,78 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "Mesh.h"
+#include "Frustum.h"
+#include "FrameRing.h"
+
+/*Draw commands for glMultiDrawElementsIndirect over the mesh pool, built on the
+CPU each frame and written to the frame ring, or to one command buffer when the
+ring is unavailable or full. A command's base instance picks where in the
+object buffer its toWorld matrices start. Optionally a compute shader frustum
+culls the commands in place before they are drawn, one object per command,
+setting the instance count of culled ones to zero so the CPU never learns or
+waits on the result. Needs OpenGL 4.3, callers fall back to ordinary draws when
+it is missing*/
+class IndirectDrawer {
+
+	//layout fixed by glMultiDrawElementsIndirect
+	struct DrawCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	const static int CULL_GROUP_SIZE = 64;
+
+	static GLuint cullProgram;
+	static GLint planesLocation;
+	static GLint numCommandsLocation;
+
+	std::vector<DrawCommand> commands;
+	std::vector<glm::vec4> bounds;		//mesh space box per command, lowest then highest
+
+	GLuint commandBuffer;
+	GLsizeiptr commandBufferSize;
+	GLuint boundsBuffer;
+	GLsizeiptr boundsBufferSize;
+
+	//where this frame's commands and bounds went
+	FrameRing::Allocation commandSource;
+	FrameRing::Allocation boundsSource;
+
+public:
+
+	//manage statics
+	static void initStatics();
+	static void cleanUpStatics();
+
+	static bool isSupported();
+
+	IndirectDrawer();
+
+	void init();
+	void dispose();
+
+	void beginFrame();
+
+	//instance_count objects of mesh, their matrices from first_instance on
+	void add(Mesh* mesh, GLuint first_instance, GLuint instance_count);
+	unsigned int getNumCommands();
+
+	//send this frame's commands, bounds only go along when they will be culled
+	void upload(bool with_bounds);
+
+	//every command must draw a single object, their toWorld matrices are size bytes of object_buffer from offset
+	void cull(GLuint object_buffer, GLintptr offset, GLsizeiptr size, const Frustum& frustum);
+
+	//count commands from first, with the pool and instance buffer bound
+	void draw(unsigned int first, unsigned int count);
+
+private:
+	static void uploadBuffer(GLenum target, GLuint buffer, GLsizeiptr& buffer_size, const void* data, GLsizeiptr data_size, FrameRing::Allocation& source);
+};
@@ -0,0 +1,186 @@
+#include "JobSystem.h"
+
+std::vector<JobSystem::WorkQueue*> JobSystem::queues;
+std::vector<std::thread> JobSystem::workers;
+std::atomic<bool> JobSystem::running(false);
+std::mutex JobSystem::sleepLock;
+std::condition_variable JobSystem::wakeUp;
+std::atomic<int> JobSystem::numSleeping(0);
+
+//main thread keeps index 0, workers are numbered from 1
+thread_local unsigned int JobSystem::threadIndex = 0;
+
+//manage statics
+void JobSystem::init(unsigned int num_workers) {
+
+	if (running) {
+		return;
+	}
+
+	if (num_workers == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		num_workers = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	//queue 0 belongs to the calling (main) thread
+	for (unsigned int i = 0; i < num_workers + 1; ++i) {
+		queues.push_back(new WorkQueue());
+	}
+
+	running = true;
+	for (unsigned int i = 1; i <= num_workers; ++i) {
+		workers.push_back(std::thread(workerLoop, i));
+	}
+}
+void JobSystem::dispose() {
+
+	if (!running) {
+		return;
+	}
+
+	running = false;
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		wakeUp.notify_all();
+	}
+	for (unsigned int i = 0; i < workers.size(); ++i) {
+		workers[i].join();
+	}
+	workers.clear();
+
+	for (unsigned int i = 0; i < queues.size(); ++i) {
+		delete queues[i];
+	}
+	queues.clear();
+}
+
+void JobSystem::run(Job job, Counter* counter) {
+
+	if (counter != NULL) {
+		counter->pending.fetch_add(1);
+	}
+
+	//not initialized, behave like a plain function call
+	if (queues.empty()) {
+		job();
+		if (counter != NULL) {
+			counter->pending.fetch_sub(1);
+		}
+		return;
+	}
+
+	WorkQueue* own = queues[threadIndex];
+	{
+		std::lock_guard<std::mutex> guard(own->lock);
+		own->jobs.push_back(QueuedJob{ job, counter });
+	}
+
+	if (numSleeping > 0) {
+		wakeUp.notify_one();
+	}
+}
+
+/*help with outstanding work until every job on the counter finished, so waiting
+inside a job never deadlocks the pool*/
+void JobSystem::wait(Counter* counter) {
+
+	while (counter->pending > 0) {
+		if (!executeOne()) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::parallelFor(unsigned int count, unsigned int batch_size, std::function<void(unsigned int, unsigned int)> func) {
+
+	if (batch_size == 0) {
+		batch_size = 1;
+	}
+
+	Counter batchesDone;
+	for (unsigned int begin = 0; begin < count; begin += batch_size) {
+		unsigned int end = begin + batch_size < count ? begin + batch_size : count;
+		run([func, begin, end]() { func(begin, end); }, &batchesDone);
+	}
+	wait(&batchesDone);
+}
+
+unsigned int JobSystem::getNumThreads() {
+	return queues.empty() ? 1 : queues.size();
+}
+
+//PRIVATE HELPERS
+void JobSystem::workerLoop(unsigned int index) {
+
+	threadIndex = index;
+
+	unsigned int idleSpins = 0;
+	while (running) {
+
+		if (executeOne()) {
+			idleSpins = 0;
+			continue;
+		}
+
+		//spin briefly before parking, jobs tend to come in bursts
+		if (++idleSpins < 64) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(sleepLock);
+		++numSleeping;
+		wakeUp.wait_for(guard, std::chrono::milliseconds(1));
+		--numSleeping;
+		idleSpins = 0;
+	}
+}
+
+//LIFO on own queue keeps recently spawned (cache warm) work local
+bool JobSystem::popOwn(QueuedJob& out) {
+
+	WorkQueue* own = queues[threadIndex];
+	std::lock_guard<std::mutex> guard(own->lock);
+	if (own->jobs.empty()) {
+		return false;
+	}
+	out = own->jobs.back();
+	own->jobs.pop_back();
+	return true;
+}
+
+//FIFO from victims takes the oldest, typically largest, pieces of work
+bool JobSystem::steal(QueuedJob& out) {
+
+	unsigned int numQueues = queues.size();
+	for (unsigned int i = 1; i < numQueues; ++i) {
+
+		WorkQueue* victim = queues[(threadIndex + i) % numQueues];
+		std::unique_lock<std::mutex> guard(victim->lock, std::try_to_lock);
+		if (!guard.owns_lock() || victim->jobs.empty()) {
+			continue;
+		}
+		out = victim->jobs.front();
+		victim->jobs.pop_front();
+		return true;
+	}
+	return false;
+}
+
+bool JobSystem::executeOne() {
+
+	if (queues.empty()) {
+		return false;
+	}
+
+	QueuedJob next;
+	if (!popOwn(next) && !steal(next)) {
+		return false;
+	}
+
+	next.job();
+	if (next.counter != NULL) {
+		next.counter->pending.fetch_sub(1);
+	}
+	return true;
+}
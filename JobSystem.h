@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*Work stealing job system. Every thread (main thread included) owns a deque,
+pushes and pops its own jobs from the back and steals from the front of other
+threads' deques when it runs dry. There is no lock shared by all threads.*/
+class JobSystem {
+
+public:
+
+	typedef std::function<void()> Job;
+
+	//jobs signal a counter when they finish, waiting on it expresses a dependency
+	struct Counter {
+		std::atomic<int> pending;
+		Counter() : pending(0) {}
+	};
+
+private:
+
+	struct QueuedJob {
+		Job job;
+		Counter* counter;
+	};
+
+	//one per thread, the lock is only contended by thieves
+	struct WorkQueue {
+		std::mutex lock;
+		std::deque<QueuedJob> jobs;
+	};
+
+	static std::vector<WorkQueue*> queues;
+	static std::vector<std::thread> workers;
+	static std::atomic<bool> running;
+
+	//idle workers park here instead of spinning
+	static std::mutex sleepLock;
+	static std::condition_variable wakeUp;
+	static std::atomic<int> numSleeping;
+
+	static thread_local unsigned int threadIndex;
+
+public:
+
+	//manage statics, num_workers of 0 picks one per spare hardware thread
+	static void init(unsigned int num_workers = 0);
+	static void dispose();
+
+	static void run(Job job, Counter* counter);
+	static void wait(Counter* counter);
+
+	//run count iterations of func in jobs of batch_size and wait for all of them
+	static void parallelFor(unsigned int count, unsigned int batch_size, std::function<void(unsigned int, unsigned int)> func);
+
+	static unsigned int getNumThreads();
+
+private:
+	static void workerLoop(unsigned int index);
+	static bool popOwn(QueuedJob& out);
+	static bool steal(QueuedJob& out);
+	static bool executeOne();
+};
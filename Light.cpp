@@ -1,12 +1,31 @@
 #include "Light.h"
 #include "Scene.h"
+#include "DebugDraw.h"
 #include <iostream>
+#include <cstring>
+
+//versions are unique across all lights, 0 is never handed out
+unsigned int Light::nextLightStructVersion = 1;
+
 Light::Light(int light_type, glm::vec3 light_color, float light_brightness, glm::vec3 light_position) {
 
 	type = light_type;
 	color = light_color;
 	brightness = light_brightness;
+
+	//past here brightness / distance is below one 8 bit color step, so cutting it off there can't be seen
+	range = light_brightness * 255.0f;
 	setLocalPosition(light_position);
+	setCastsShadows(false);
+
+	lightStruct = LightStruct();
+	lightStructVersion = 0;
+	firstShadowView = -1;
+	numCascades = 0;
+	spotAngle = glm::pi<float>() / 6.0f;
+	shadowFilter = ShadowAtlas::POISSON_SHADOWS;
+	shadowFilterRadius = 2.0f;
+	shadowFilterSamples = 8;
 
 	//for gizmos points math
 	float gizmosSize = 3;
@@ -17,7 +36,7 @@ Light::Light(int light_type, glm::vec3 light_color, float light_brightness, glm:
 	gizmosPoints.push_back(glm::vec3(-gizmosSize, 0, 0));
 	gizmosPoints.push_back(glm::vec3(0, gizmosSize, 0));
 	gizmosPoints.push_back(glm::vec3(0, -gizmosSize, 0));
-	if(type == Light::DIRECTIONAL)
+	if(type != Light::POINT)
 		gizmosPoints.push_back(glm::vec3(0, 0, gizmosSize * 10));
 	else
 		gizmosPoints.push_back(glm::vec3(0, 0, gizmosSize));
@@ -30,58 +49,96 @@ Light::Light(int light_type, glm::vec3 light_color, float light_brightness, glm:
 	gizmosPoints.push_back(glm::vec3(-dist, dist, -dist));
 	gizmosPoints.push_back(glm::vec3(dist, dist, -dist));
 	gizmosPoints.push_back(glm::vec3(-dist, -dist, dist));
+}
 
-	//prepare gizmos buffers
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-	glBufferData(GL_ARRAY_BUFFER, gizmosPoints.size() * sizeof(glm::vec3), gizmosPoints.data(), GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+Light::~Light() {
+}
 
+void Light::setSpotAngle(float spot_angle) {
+	spotAngle = spot_angle;
+}
+float Light::getSpotAngle() {
+	return spotAngle;
 }
 
-Light::~Light() {
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
+void Light::setShadowFilter(int filter, float radius_texels, int samples) {
+	shadowFilter = filter;
+	shadowFilterRadius = radius_texels;
+	shadowFilterSamples = samples;
+}
+int Light::getShadowFilter() {
+	return shadowFilter;
+}
+float Light::getShadowFilterRadius() {
+	return shadowFilterRadius;
+}
+int Light::getShadowFilterSamples() {
+	return shadowFilterSamples;
 }
 
-void Light::setViewProjectionMatrix(glm::mat4 light_vp_matrix) {
+void Light::setShadowViews(int first_view, int num_cascades, const float* splits) {
 
-	ViewProjectonMatrix = light_vp_matrix;
+	firstShadowView = first_view;
+	numCascades = num_cascades;
+	for (int i = 0; i < numCascades; ++i) {
+		cascadeSplits[i] = splits[i];
+	}
+}
+int Light::getFirstShadowView() {
+	return firstShadowView;
 }
-LightStruct Light::getLightStruct() {
+/*rebuild the struct from the light's attributes, returns true and bumps the
+version only if something the shader sees actually changed*/
+bool Light::updateLightStruct() {
 
-	LightStruct working;
+	//zeroed, unused cascades and padding fields are compared too
+	LightStruct working = LightStruct();
 	working.type = this->type;
 	working.color = glm::vec4(this->color, 1);
 	working.brightness = this->brightness;
 	working.position = parentToWorld * glm::vec4(local_position, 1);
 	working.direction = toWorld * glm::vec4(0,0,1,0);  //4th component is 0 so no translations applied
-	working.VP = ViewProjectonMatrix;
+	working.spotCosine = cos(spotAngle);
+	working.range = this->range;
+	working.firstShadowView = firstShadowView;
+	working.numCascades = numCascades;
+	for (int i = 0; i < numCascades; ++i) {
+		working.cascadeSplits[i] = cascadeSplits[i];
+	}
 
-	return working;
+	if (lightStructVersion != 0 && memcmp(&working, &lightStruct, sizeof(LightStruct)) == 0) {
+		return false;
+	}
+	lightStruct = working;
+	lightStructVersion = nextLightStructVersion++;
+	return true;
+}
+const LightStruct& Light::getLightStruct() {
+	return lightStruct;
+}
+unsigned int Light::getLightStructVersion() {
+	return lightStructVersion;
 }
 
 void Light::sendThisGeometryToShadowMap() {
 	//leave empty
 }
-void Light::drawThisSceneObject(Scene* currScene) {
+void Light::drawThisSceneObject(Scene*) {
 
-	drawGizmos(currScene);
+	drawGizmos();
+}
+bool Light::getLocalBounds(AABB& bounds) const {
+	bounds = AABB::fromPoints(gizmosPoints);
+	return true;
 }
 
-void Light::drawGizmos(Scene* currScene) {
-
-	glUseProgram(Material::getShaderProgram());
+void Light::drawGizmos() {
 
-	Camera* activeCamera = currScene->getActiveCamera();
+	//world position and rotation from a single decompose, the gizmo ignores scale
+	glm::vec3 scale, translation, skew;
+	glm::quat rotation;
+	glm::vec4 perspective;
+	glm::decompose(getToWorld(), scale, rotation, translation, skew, perspective);
 
 	//check for negative z scale
 	glm::mat4 rotationCorrector = glm::mat4(1.0f);
@@ -89,23 +146,8 @@ void Light::drawGizmos(Scene* currScene) {
 		rotationCorrector = glm::rotate(glm::mat4(1.0f), glm::pi<float>(), glm::vec3(1,0,0));
 	}
 	//calc toWorldNoScale
-	glm::mat4 toWorldNoScale = glm::translate(glm::mat4(1.0f), getPosition(SceneObject::WORLD)) * getRotation(SceneObject::WORLD) * rotationCorrector;
-
-	//apply object properties	
-	glUniformMatrix4fv(glGetUniformLocation(Material::getShaderProgram(), "toWorld"), 1, GL_FALSE, &toWorldNoScale[0][0]);
-
-	//apply camera properties
-	activeCamera->applySettings(Material::getShaderProgram());
-
-	//apply material properties
-	Material m;
-	m.setSurfaceColor(color);
-	m.setUseSurfaceColor(true);
-	m.applySettings();
+	glm::mat4 toWorldNoScale = glm::translate(glm::mat4(1.0f), translation) * glm::toMat4(glm::conjugate(rotation)) * rotationCorrector;
 
-	//Bind VAO for gizmos and draw 
-	glBindVertexArray(VAO);
-	glLineWidth(3);
-	glDrawArrays(GL_LINES, 0, gizmosPoints.size());
-	glBindVertexArray(0);
+	//batched with every other debug line, drawn when the scene flushes them
+	DebugDraw::lines(gizmosPoints, toWorldNoScale, color);
 }
\ No newline at end of file
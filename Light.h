@@ -7,17 +7,24 @@ class Scene;
 
 struct LightStruct {
 
+	const static int MAX_CASCADES = 4;
+
 	glm::vec4 color;
 	glm::vec4 position;
 	glm::vec4 direction;
 
 	int type;
 	float brightness;
+	int numCascades;
+	float spotCosine;			//cosine of the cone's half angle
+
+	glm::vec4 cascadeSplits;		//far view depth of each cascade
+
+	float range;
+	int firstShadowView;		//first of its views in the shadow atlas, -1 without shadows
 	float padding;
 	float padding2;
 
-	glm::mat4 VP;
-
 
 };
 
@@ -25,32 +32,61 @@ class Light : public SceneObject{
 
 	//Light gizmos
 	std::vector<glm::vec3> gizmosPoints;
-	GLuint VAO, VBO;
 
-	glm::mat4 ViewProjectonMatrix;
+	//shadow views, from the light's shadow map
+	int firstShadowView;
+	int numCascades;
+	float cascadeSplits[LightStruct::MAX_CASCADES];
+
+	float spotAngle;
+
+	//how its shadows are filtered, one of ShadowAtlas::Filter
+	int shadowFilter;
+	float shadowFilterRadius;
+	int shadowFilterSamples;
+
+	//last struct handed to the shader, its version changes whenever the contents do
+	LightStruct lightStruct;
+	unsigned int lightStructVersion;
+	static unsigned int nextLightStructVersion;
 
 public:
 	int type;
 	glm::vec3 color;
 	float brightness;
+	float range;	//point and spot lights only, no light reaches past it
 
 
-	enum type {DIRECTIONAL, POINT};
+	enum type {DIRECTIONAL, POINT, SPOT};
 
 	Light(int light_type, glm::vec3 light_color, float light_brightness, glm::vec3 light_position);
 	~Light();
 	
-	void setViewProjectionMatrix(glm::mat4 light_vp_matrix);
+	//half angle of a spot light's cone, in radians
+	void setSpotAngle(float spot_angle);
+	float getSpotAngle();
+
+	//radius in shadow atlas texels, samples only matter to Poisson kernels
+	void setShadowFilter(int filter, float radius_texels, int samples);
+	int getShadowFilter();
+	float getShadowFilterRadius();
+	int getShadowFilterSamples();
+
+	void setShadowViews(int first_view, int num_cascades, const float* splits);
+	int getFirstShadowView();
 
-	LightStruct getLightStruct();
+	bool updateLightStruct();
+	const LightStruct& getLightStruct();
+	unsigned int getLightStructVersion();
 
 	//override
 	void sendThisGeometryToShadowMap();
 	void drawThisSceneObject(Scene* currScene);
+	bool getLocalBounds(AABB& bounds) const;
 
 
 private:
 
-	void drawGizmos(Scene* currScene);
+	void drawGizmos();
 
 };
\ No newline at end of file
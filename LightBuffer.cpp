@@ -0,0 +1,153 @@
+#include "LightBuffer.h"
+#include <cstring>
+
+LightBuffer::LightBuffer() : fences(NUM_REGIONS) {
+	UBO = 0;
+	bindingPoint = 0;
+	maxLights = 0;
+	regionSize = 0;
+	persistent = false;
+	numRegions = 1;
+	currRegion = 0;
+	mappedData = NULL;
+	runStart = runEnd = -1;
+	stats.bytesUploaded = 0;
+	stats.rangesUploaded = 0;
+	stats.fenceWaits = 0;
+	stats.waitMilliseconds = 0;
+}
+
+void LightBuffer::init(GLuint binding_point, GLuint max_lights) {
+
+	bindingPoint = binding_point;
+	maxLights = max_lights;
+
+	//regions are bound with glBindBufferRange, so each has to start on an aligned offset
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	regionSize = maxLights * sizeof(LightStruct);
+	regionSize = (regionSize + alignment - 1) / alignment * alignment;
+
+	persistent = GLEW_ARB_buffer_storage ? true : false;
+	numRegions = persistent ? NUM_REGIONS : 1;
+
+	glGenBuffers(1, &UBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, numRegions * regionSize, NULL, flags);
+		mappedData = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, numRegions * regionSize, flags);
+	}
+	else {
+		glBufferData(GL_UNIFORM_BUFFER, regionSize, NULL, GL_DYNAMIC_DRAW);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	staging.resize(maxLights);
+	for (int i = 0; i < NUM_REGIONS; ++i) {
+		slotVersions[i].assign(maxLights, 0);
+	}
+	currRegion = 0;
+}
+
+void LightBuffer::dispose() {
+
+	fences.clear();
+	if (mappedData != NULL) {
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		mappedData = NULL;
+	}
+	glDeleteBuffers(1, &UBO);
+	UBO = 0;
+}
+
+void LightBuffer::bindBlock(GLuint shader_program, const char* block_name) {
+
+	GLuint blockIndex = glGetUniformBlockIndex(shader_program, block_name);
+	if (blockIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(shader_program, blockIndex, bindingPoint);
+	}
+}
+
+//wait until the GPU is done with the region about to be written
+void LightBuffer::beginFrame() {
+
+	stats.bytesUploaded = 0;
+	stats.rangesUploaded = 0;
+	stats.fenceWaits = 0;
+	stats.waitMilliseconds = 0;
+	runStart = runEnd = -1;
+
+	if (persistent && fences.wait(currRegion, stats.waitMilliseconds)) {
+		++stats.fenceWaits;
+	}
+}
+
+//stage a slot, skipped when the current region already holds this version
+void LightBuffer::write(GLuint slot, const LightStruct& light_struct, unsigned int version) {
+
+	if (slot >= maxLights || slotVersions[currRegion][slot] == version) {
+		return;
+	}
+	slotVersions[currRegion][slot] = version;
+	staging[slot] = light_struct;
+
+	if (runStart >= 0 && (int)slot == runEnd) {
+		++runEnd;
+		return;
+	}
+	flushRun();
+	runStart = slot;
+	runEnd = slot + 1;
+}
+
+void LightBuffer::commit() {
+
+	flushRun();
+	glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, UBO, currRegion * regionSize, maxLights * sizeof(LightStruct));
+}
+
+//fence the region drawn from this frame and move on to the next
+void LightBuffer::endFrame() {
+
+	if (!persistent) {
+		return;
+	}
+	fences.fence(currRegion);
+	currRegion = (currRegion + 1) % numRegions;
+}
+
+bool LightBuffer::isPersistent() {
+	return persistent;
+}
+LightBuffer::Stats LightBuffer::getStats() {
+	return stats;
+}
+
+//PRIVATE HELPERS
+
+void LightBuffer::flushRun() {
+
+	if (runStart < 0) {
+		return;
+	}
+
+	GLintptr offset = runStart * sizeof(LightStruct);
+	GLsizeiptr size = (runEnd - runStart) * sizeof(LightStruct);
+	if (persistent) {
+		//coherent mapping, visible to the GPU without an explicit flush
+		memcpy(mappedData + currRegion * regionSize + offset, &staging[runStart], size);
+	}
+	else {
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, size, &staging[runStart]);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	stats.bytesUploaded += size;
+	++stats.rangesUploaded;
+	runStart = runEnd = -1;
+}
+
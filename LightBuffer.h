@@ -0,0 +1,69 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <vector>
+#include "Light.h"
+#include "RegionFences.h"
+
+/*Uniform buffer of LightStructs that only uploads what changed. With buffer
+storage available the UBO is persistently mapped and split into NUM_REGIONS
+regions used round robin, each guarded by a fence, so the CPU writes one region
+while the GPU may still read the others. Every region remembers which version of
+each slot it holds and catches up on its own. Without buffer storage there is a
+single region updated with glBufferSubData*/
+class LightBuffer {
+
+public:
+	const static int NUM_REGIONS = 3;
+
+	struct Stats {
+		unsigned int bytesUploaded;
+		unsigned int rangesUploaded;	//contiguous runs of dirty slots
+		unsigned int fenceWaits;		//frames the region was still in use by the GPU
+		float waitMilliseconds;			//CPU time spent on those waits
+	};
+
+private:
+
+	GLuint UBO;
+	GLuint bindingPoint;
+	GLuint maxLights;
+	GLsizeiptr regionSize;			//padded to the uniform buffer offset alignment
+
+	bool persistent;
+	int numRegions;
+	int currRegion;
+	char* mappedData;
+	RegionFences fences;
+
+	//version of the LightStruct written to each slot, 0 for never written
+	std::vector<unsigned int> slotVersions[NUM_REGIONS];
+
+	//slots staged this frame, copied out as contiguous runs
+	std::vector<LightStruct> staging;
+	int runStart, runEnd;
+
+	Stats stats;
+
+public:
+
+	LightBuffer();
+
+	//the UBO lives until dispose, resizes don't touch it
+	void init(GLuint binding_point, GLuint max_lights);
+	void dispose();
+
+	//point a program's uniform block at the buffer's binding point
+	void bindBlock(GLuint shader_program, const char* block_name);
+
+	void beginFrame();
+	void write(GLuint slot, const LightStruct& light_struct, unsigned int version);
+	void commit();
+	void endFrame();
+
+	bool isPersistent();
+	Stats getStats();
+
+private:
+	void flushRun();
+};
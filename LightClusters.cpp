@@ -0,0 +1,228 @@
+#include "LightClusters.h"
+#include "JobSystem.h"
+#include "GLState.h"
+#include <algorithm>
+#include <cmath>
+
+LightClusters::LightClusters() {
+	projectionX = 0.0f;
+	projectionY = 0.0f;
+	clusterNear = 0.0f;
+	clusterFar = 0.0f;
+	depthScale = 0.0f;
+	depthBias = 0.0f;
+	clusterLights.resize(NUM_CLUSTERS);
+	clusterRanges.assign(NUM_CLUSTERS * 2, 0);
+	lightDataBuffer = clusterRangeBuffer = lightIndexBuffer = 0;
+	lightDataTexture = clusterRangeTexture = lightIndexTexture = 0;
+}
+
+void LightClusters::initBuffers() {
+
+	glGenBuffers(1, &lightDataBuffer);
+	glGenBuffers(1, &clusterRangeBuffer);
+	glGenBuffers(1, &lightIndexBuffer);
+	glGenTextures(1, &lightDataTexture);
+	glGenTextures(1, &clusterRangeTexture);
+	glGenTextures(1, &lightIndexTexture);
+
+	//buffers need storage before a texture can point at them
+	upload();
+
+	GLState::bindTexture(GL_TEXTURE_BUFFER, lightDataTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, lightDataBuffer);
+	GLState::bindTexture(GL_TEXTURE_BUFFER, clusterRangeTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, clusterRangeBuffer);
+	GLState::bindTexture(GL_TEXTURE_BUFFER, lightIndexTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, lightIndexBuffer);
+	GLState::bindTexture(GL_TEXTURE_BUFFER, 0);
+}
+void LightClusters::disposeBuffers() {
+	GLState::deleteTextures(1, &lightDataTexture);
+	GLState::deleteTextures(1, &clusterRangeTexture);
+	GLState::deleteTextures(1, &lightIndexTexture);
+	glDeleteBuffers(1, &lightDataBuffer);
+	glDeleteBuffers(1, &clusterRangeBuffer);
+	glDeleteBuffers(1, &lightIndexBuffer);
+}
+
+/*Each light gets a conservative range of slices and tiles from its sphere, then
+the sphere is tested against every froxel in that range. Slices are binned on
+separate jobs, a slice only writes its own froxels*/
+void LightClusters::build(const glm::mat4& view, const glm::mat4& projection, float camera_near, float camera_far,
+	const std::vector<PointLightData>& point_lights) {
+
+	lights = point_lights;
+	if (projection[0][0] != projectionX || projection[1][1] != projectionY || camera_near != clusterNear || camera_far != clusterFar) {
+		updateClusterBounds(projection, camera_near, camera_far);
+	}
+
+	struct LightRange {
+		glm::vec3 center;		//view space
+		float radius;
+		int firstX, lastX, firstY, lastY, firstZ, lastZ;
+	};
+	std::vector<LightRange> ranges;
+	ranges.reserve(lights.size());
+
+	for (unsigned int i = 0; i < lights.size(); ++i) {
+
+		LightRange range;
+		range.center = glm::vec3(view * glm::vec4(glm::vec3(lights[i].positionRange), 1.0f));
+		range.radius = lights[i].positionRange.w;
+
+		float depth = -range.center.z;
+		if (depth + range.radius < clusterNear || depth - range.radius > clusterFar) {
+			range.firstZ = 1;
+			range.lastZ = 0;
+			ranges.push_back(range);
+			continue;
+		}
+		range.firstZ = getSlice(glm::max(depth - range.radius, clusterNear));
+		range.lastZ = getSlice(glm::min(depth + range.radius, clusterFar));
+
+		//screen extent of the sphere's view space box, everything if it reaches the near plane
+		range.firstX = 0;
+		range.lastX = GRID_X - 1;
+		range.firstY = 0;
+		range.lastY = GRID_Y - 1;
+		float nearDepth = depth - range.radius;
+		if (nearDepth > clusterNear) {
+			float farDepth = depth + range.radius;
+			float minX = glm::min((range.center.x - range.radius) / nearDepth, (range.center.x - range.radius) / farDepth) * projectionX;
+			float maxX = glm::max((range.center.x + range.radius) / nearDepth, (range.center.x + range.radius) / farDepth) * projectionX;
+			float minY = glm::min((range.center.y - range.radius) / nearDepth, (range.center.y - range.radius) / farDepth) * projectionY;
+			float maxY = glm::max((range.center.y + range.radius) / nearDepth, (range.center.y + range.radius) / farDepth) * projectionY;
+			range.firstX = std::min(std::max((int)std::floor((minX * 0.5f + 0.5f) * GRID_X), 0), GRID_X - 1);
+			range.lastX = std::min(std::max((int)std::floor((maxX * 0.5f + 0.5f) * GRID_X), 0), GRID_X - 1);
+			range.firstY = std::min(std::max((int)std::floor((minY * 0.5f + 0.5f) * GRID_Y), 0), GRID_Y - 1);
+			range.lastY = std::min(std::max((int)std::floor((maxY * 0.5f + 0.5f) * GRID_Y), 0), GRID_Y - 1);
+		}
+		ranges.push_back(range);
+	}
+
+	JobSystem::parallelFor(GRID_Z, 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int z = begin; z < end; ++z) {
+
+			for (int cluster = z * GRID_X * GRID_Y; cluster < (int)(z + 1) * GRID_X * GRID_Y; ++cluster) {
+				clusterLights[cluster].clear();
+			}
+
+			for (unsigned int i = 0; i < ranges.size(); ++i) {
+
+				const LightRange& range = ranges[i];
+				if ((int)z < range.firstZ || (int)z > range.lastZ)
+					continue;
+
+				for (int y = range.firstY; y <= range.lastY; ++y) {
+					for (int x = range.firstX; x <= range.lastX; ++x) {
+
+						int cluster = (z * GRID_Y + y) * GRID_X + x;
+						const AABB& bounds = clusterBounds[cluster];
+						glm::vec3 closest = glm::clamp(range.center, bounds.lowest, bounds.highest);
+						glm::vec3 offset = closest - range.center;
+						if (glm::dot(offset, offset) <= range.radius * range.radius) {
+							clusterLights[cluster].push_back(i);
+						}
+					}
+				}
+			}
+		}
+	});
+
+	//pack into one index list
+	lightIndices.clear();
+	for (int cluster = 0; cluster < NUM_CLUSTERS; ++cluster) {
+		clusterRanges[cluster * 2] = lightIndices.size();
+		clusterRanges[cluster * 2 + 1] = clusterLights[cluster].size();
+		lightIndices.insert(lightIndices.end(), clusterLights[cluster].begin(), clusterLights[cluster].end());
+	}
+}
+
+void LightClusters::upload() {
+	uploadTextureBuffer(lightDataBuffer, lights.data(), lights.size() * sizeof(PointLightData));
+	uploadTextureBuffer(clusterRangeBuffer, clusterRanges.data(), clusterRanges.size() * sizeof(GLuint));
+	uploadTextureBuffer(lightIndexBuffer, lightIndices.data(), lightIndices.size() * sizeof(GLuint));
+}
+
+void LightClusters::applySettings(GLuint shader_program, int screen_width, int screen_height) {
+
+	glUniform1i(glGetUniformLocation(shader_program, "pointLightData"), LIGHT_DATA_UNIT);
+	glUniform1i(glGetUniformLocation(shader_program, "clusterRanges"), CLUSTER_RANGE_UNIT);
+	glUniform1i(glGetUniformLocation(shader_program, "clusterLightIndices"), LIGHT_INDEX_UNIT);
+
+	glUniform3i(glGetUniformLocation(shader_program, "clusterGrid"), GRID_X, GRID_Y, GRID_Z);
+	glUniform2f(glGetUniformLocation(shader_program, "clusterTileSize"), (float)screen_width / GRID_X, (float)screen_height / GRID_Y);
+	glUniform1f(glGetUniformLocation(shader_program, "clusterDepthScale"), depthScale);
+	glUniform1f(glGetUniformLocation(shader_program, "clusterDepthBias"), depthBias);
+
+	GLState::activeTexture(GL_TEXTURE0 + LIGHT_DATA_UNIT);
+	GLState::bindTexture(GL_TEXTURE_BUFFER, lightDataTexture);
+	GLState::activeTexture(GL_TEXTURE0 + CLUSTER_RANGE_UNIT);
+	GLState::bindTexture(GL_TEXTURE_BUFFER, clusterRangeTexture);
+	GLState::activeTexture(GL_TEXTURE0 + LIGHT_INDEX_UNIT);
+	GLState::bindTexture(GL_TEXTURE_BUFFER, lightIndexTexture);
+	GLState::activeTexture(GL_TEXTURE0);
+}
+
+unsigned int LightClusters::getNumLights() const {
+	return lights.size();
+}
+unsigned int LightClusters::getNumLightIndices() const {
+	return lightIndices.size();
+}
+const std::vector<unsigned int>& LightClusters::getClusterLights(int x, int y, int z) const {
+	return clusterLights[(z * GRID_Y + y) * GRID_X + x];
+}
+
+
+//PRIVATE HELPERS
+
+/*slice k spans near * (far / near)^(k / GRID_Z) to the next, so froxels stay
+roughly cube shaped instead of stretching with distance*/
+void LightClusters::updateClusterBounds(const glm::mat4& projection, float camera_near, float camera_far) {
+
+	projectionX = projection[0][0];
+	projectionY = projection[1][1];
+	clusterNear = camera_near;
+	clusterFar = camera_far;
+
+	float logRatio = std::log(clusterFar / clusterNear);
+	depthScale = GRID_Z / logRatio;
+	depthBias = -GRID_Z * std::log(clusterNear) / logRatio;
+
+	clusterBounds.resize(NUM_CLUSTERS);
+	for (int z = 0; z < GRID_Z; ++z) {
+
+		float sliceNear = clusterNear * std::pow(clusterFar / clusterNear, (float)z / GRID_Z);
+		float sliceFar = clusterNear * std::pow(clusterFar / clusterNear, (float)(z + 1) / GRID_Z);
+
+		for (int y = 0; y < GRID_Y; ++y) {
+			for (int x = 0; x < GRID_X; ++x) {
+
+				AABB bounds;
+				for (int corner = 0; corner < 8; ++corner) {
+					float ndcX = -1.0f + 2.0f * (x + (corner & 1)) / GRID_X;
+					float ndcY = -1.0f + 2.0f * (y + ((corner >> 1) & 1)) / GRID_Y;
+					float depth = (corner & 4) ? sliceFar : sliceNear;
+					bounds.expand(glm::vec3(ndcX * depth / projectionX, ndcY * depth / projectionY, -depth));
+				}
+				clusterBounds[(z * GRID_Y + y) * GRID_X + x] = bounds;
+			}
+		}
+	}
+}
+
+int LightClusters::getSlice(float depth) const {
+	return std::min(std::max((int)std::floor(std::log(depth) * depthScale + depthBias), 0), GRID_Z - 1);
+}
+
+//orphan and refill, never smaller than one texel so the texture stays valid
+void LightClusters::uploadTextureBuffer(GLuint buffer, const void* data, size_t size) {
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max(size, (size_t)16), NULL, GL_STREAM_DRAW);
+	if (size > 0) {
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "AABB.h"
+
+/*Clustered forward light culling. The camera frustum is cut into a grid of
+froxels, screen tiles by exponential depth slices, and every point light is
+binned into the froxels its range sphere touches. The material shader looks up
+its froxel and only loops over that froxel's lights. Lights, per froxel ranges
+and the packed index list reach the shader through texture buffers, which GLSL
+330 can read. Binning is CPU only, upload is the only part touching GL*/
+class LightClusters {
+
+public:
+	const static int GRID_X = 16;
+	const static int GRID_Y = 9;
+	const static int GRID_Z = 24;
+	const static int NUM_CLUSTERS = GRID_X * GRID_Y * GRID_Z;
+
+	//texture units, after material textures (0-2), the shadow atlases (3-4) and their view data (12)
+	const static int LIGHT_DATA_UNIT = 13;
+	const static int CLUSTER_RANGE_UNIT = 14;
+	const static int LIGHT_INDEX_UNIT = 15;
+
+	//two texels per light in the light data buffer
+	struct PointLightData {
+		glm::vec4 positionRange;	//world position, range in w
+		glm::vec4 color;			//color times brightness, first shadow atlas view in w or -1
+	};
+
+private:
+
+	std::vector<PointLightData> lights;
+
+	//view space froxel bounds, rebuilt when the projection changes
+	std::vector<AABB> clusterBounds;
+	float projectionX, projectionY;
+	float clusterNear, clusterFar;
+	float depthScale, depthBias;	//slice = log(depth) * scale + bias
+
+	std::vector<std::vector<unsigned int> > clusterLights;
+	std::vector<GLuint> clusterRanges;		//offset and count per froxel
+	std::vector<GLuint> lightIndices;
+
+	GLuint lightDataBuffer, clusterRangeBuffer, lightIndexBuffer;
+	GLuint lightDataTexture, clusterRangeTexture, lightIndexTexture;
+
+public:
+
+	LightClusters();
+
+	void initBuffers();
+	void disposeBuffers();
+
+	//bin lights for a symmetric perspective camera, CPU only
+	void build(const glm::mat4& view, const glm::mat4& projection, float camera_near, float camera_far,
+		const std::vector<PointLightData>& point_lights);
+
+	void upload();
+	void applySettings(GLuint shader_program, int screen_width, int screen_height);
+
+	unsigned int getNumLights() const;
+	unsigned int getNumLightIndices() const;
+	const std::vector<unsigned int>& getClusterLights(int x, int y, int z) const;
+
+private:
+	void updateClusterBounds(const glm::mat4& projection, float camera_near, float camera_far);
+	int getSlice(float depth) const;
+	static void uploadTextureBuffer(GLuint buffer, const void* data, size_t size);
+};
@@ -1,15 +1,24 @@
 #include "Material.h"
 #include "shader.h"
+#include "GLState.h"
 
 GLuint Material::shaderProgram = -1;
+GLuint Material::gBufferShaderProgram = -1;
+GLuint Material::deferredLightingProgram = -1;
+bool Material::deferred = false;
 
 void Material::initStatics() {
-	shaderProgram = LoadShaders("../shader.vert", "../shader_material.frag");
+	//both lighting shaders are compiled after the lights and shadow lookups they share
+	shaderProgram = LoadShaders("../shader.vert", { "../shader_lighting.glsl", "../shader_material.frag" });
+	gBufferShaderProgram = LoadShaders("../shader.vert", "../shader_gbuffer.frag");
+	deferredLightingProgram = LoadShaders("../shader_blur.vert", { "../shader_lighting.glsl", "../shader_deferred.frag" });
 
 }
 void Material::cleanUpStatics() {
 
-	glDeleteProgram(shaderProgram);
+	GLState::deleteProgram(shaderProgram);
+	GLState::deleteProgram(gBufferShaderProgram);
+	GLState::deleteProgram(deferredLightingProgram);
 }
 
 
@@ -172,54 +181,107 @@ float Material::getReflectiveness() {
 
 //static shader program for others to use
 GLuint Material::getShaderProgram() {
+	return deferred ? gBufferShaderProgram : shaderProgram;
+}
+GLuint Material::getLightingProgram() {
+	return deferred ? deferredLightingProgram : shaderProgram;
+}
+GLuint Material::getForwardShaderProgram() {
 	return shaderProgram;
 }
+GLuint Material::getDeferredLightingProgram() {
+	return deferredLightingProgram;
+}
+
+void Material::setDeferred(bool opt) {
+	deferred = opt;
+}
+bool Material::isDeferred() {
+	return deferred;
+}
 
 
 void Material::applySettings() {
 
-	glUseProgram(shaderProgram);
+	GLuint currShaderProgram = getShaderProgram();
+	GLState::useProgram(currShaderProgram);
 
 	//material properties	
-	glUniform1i(glGetUniformLocation(shaderProgram, "material.useDiffuse"), useDiffuse);
-	glUniform1i(glGetUniformLocation(shaderProgram, "material.useSpecular"), useSpecular);
-	glUniform1i(glGetUniformLocation(shaderProgram, "material.useAmbient"), useAmbient);
-	glUniform1i(glGetUniformLocation(shaderProgram, "material.useSurfaceColor"), useSurfaceColor);
-	glUniform1i(glGetUniformLocation(shaderProgram, "material.useSurfaceTexture"), useSurfaceTexture);
-	glUniform1i(glGetUniformLocation(shaderProgram, "material.useNormalMap"), useNormalMap);
-	glUniform1i(glGetUniformLocation(shaderProgram, "material.useReflectionTexture"), useReflectionTexture - 1);
+	glUniform1i(glGetUniformLocation(currShaderProgram, "material.useDiffuse"), useDiffuse);
+	glUniform1i(glGetUniformLocation(currShaderProgram, "material.useSpecular"), useSpecular);
+	glUniform1i(glGetUniformLocation(currShaderProgram, "material.useAmbient"), useAmbient);
+	glUniform1i(glGetUniformLocation(currShaderProgram, "material.useSurfaceColor"), useSurfaceColor);
+	glUniform1i(glGetUniformLocation(currShaderProgram, "material.useSurfaceTexture"), useSurfaceTexture);
+	glUniform1i(glGetUniformLocation(currShaderProgram, "material.useNormalMap"), useNormalMap);
+	glUniform1i(glGetUniformLocation(currShaderProgram, "material.useReflectionTexture"), useReflectionTexture - 1);
 	if (useDiffuse) {
-		glUniform3f(glGetUniformLocation(shaderProgram, "material.diffuse"), diffuse.r, diffuse.g, diffuse.b);
+		glUniform3f(glGetUniformLocation(currShaderProgram, "material.diffuse"), diffuse.r, diffuse.g, diffuse.b);
 	}
 	if (useSpecular) {
-		glUniform3f(glGetUniformLocation(shaderProgram, "material.specular"), specular.r, specular.g, specular.b);
+		glUniform3f(glGetUniformLocation(currShaderProgram, "material.specular"), specular.r, specular.g, specular.b);
 	}
 	if (useAmbient) {
-		glUniform3f(glGetUniformLocation(shaderProgram, "material.ambient"), ambient.r, ambient.g, ambient.b);
+		glUniform3f(glGetUniformLocation(currShaderProgram, "material.ambient"), ambient.r, ambient.g, ambient.b);
 	}
 	if (useSurfaceColor) {
-		glUniform3f(glGetUniformLocation(shaderProgram, "material.surfaceColor"), surfaceColor.r, surfaceColor.g, surfaceColor.b);
+		glUniform3f(glGetUniformLocation(currShaderProgram, "material.surfaceColor"), surfaceColor.r, surfaceColor.g, surfaceColor.b);
 	}
 	if (useSurfaceTexture) {
-		glUniform1i(glGetUniformLocation(shaderProgram, "material.surfaceTexture"), 0);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, surfaceTexture.getID());
+		glUniform1i(glGetUniformLocation(currShaderProgram, "material.surfaceTexture"), 0);
+		GLState::activeTexture(GL_TEXTURE0);
+		GLState::bindTexture(GL_TEXTURE_2D, surfaceTexture.getID());
 
-		glUniform1f(glGetUniformLocation(shaderProgram, "material.surfaceTextureStrength"), surfaceTextureStrength);
+		glUniform1f(glGetUniformLocation(currShaderProgram, "material.surfaceTextureStrength"), surfaceTextureStrength);
 	}
 	if (useNormalMap) {
-		glUniform1i(glGetUniformLocation(shaderProgram, "material.normalMap"), 1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, normalMap.getID());
+		glUniform1i(glGetUniformLocation(currShaderProgram, "material.normalMap"), 1);
+		GLState::activeTexture(GL_TEXTURE1);
+		GLState::bindTexture(GL_TEXTURE_2D, normalMap.getID());
 
-		glUniform1f(glGetUniformLocation(shaderProgram, "material.normalMapStrength"), normalMapStrength);
+		glUniform1f(glGetUniformLocation(currShaderProgram, "material.normalMapStrength"), normalMapStrength);
 	}
 	
 	if (useReflectionTexture) {
-		glUniform1i(glGetUniformLocation(shaderProgram, "material.reflectionTexture"), 2);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, reflectionTexture.getID());
+		glUniform1i(glGetUniformLocation(currShaderProgram, "material.reflectionTexture"), 2);
+		GLState::activeTexture(GL_TEXTURE2);
+		GLState::bindTexture(GL_TEXTURE_CUBE_MAP, reflectionTexture.getID());
 
-		glUniform1f(glGetUniformLocation(shaderProgram, "material.reflectiveness"), reflectiveness);
+		glUniform1f(glGetUniformLocation(currShaderProgram, "material.reflectiveness"), reflectiveness);
 	}
 }
+
+//only what applySettings actually sends is compared, unused colors and textures may differ
+bool Material::sameSettings(Material& other) {
+
+	if (useDiffuse != other.useDiffuse || useSpecular != other.useSpecular || useAmbient != other.useAmbient
+		|| useSurfaceColor != other.useSurfaceColor || useSurfaceTexture != other.useSurfaceTexture
+		|| useNormalMap != other.useNormalMap || useReflectionTexture != other.useReflectionTexture)
+		return false;
+
+	if (useDiffuse && diffuse != other.diffuse)
+		return false;
+	if (useSpecular && specular != other.specular)
+		return false;
+	if (useAmbient && ambient != other.ambient)
+		return false;
+	if (useSurfaceColor && surfaceColor != other.surfaceColor)
+		return false;
+	if (useSurfaceTexture && (surfaceTexture.getID() != other.surfaceTexture.getID() || surfaceTextureStrength != other.surfaceTextureStrength))
+		return false;
+	if (useNormalMap && (normalMap.getID() != other.normalMap.getID() || normalMapStrength != other.normalMapStrength))
+		return false;
+	if (useReflectionTexture && (reflectionTexture.getID() != other.reflectionTexture.getID() || reflectiveness != other.reflectiveness))
+		return false;
+	return true;
+}
+int Material::countTextureChanges(Material* previous) {
+
+	int changes = 0;
+	if (useSurfaceTexture && (previous == NULL || !previous->useSurfaceTexture || surfaceTexture.getID() != previous->surfaceTexture.getID()))
+		++changes;
+	if (useNormalMap && (previous == NULL || !previous->useNormalMap || normalMap.getID() != previous->normalMap.getID()))
+		++changes;
+	if (useReflectionTexture && (previous == NULL || !previous->useReflectionTexture || reflectionTexture.getID() != previous->reflectionTexture.getID()))
+		++changes;
+	return changes;
+}
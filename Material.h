@@ -14,6 +14,11 @@ class Material {
 	//static fields
 	static GLuint shaderProgram;
 
+	//deferred path: materials write the G-buffer, one screen pass lights it
+	static GLuint gBufferShaderProgram;
+	static GLuint deferredLightingProgram;
+	static bool deferred;
+
 	//diffuse
 	int useDiffuse;
 	glm::vec3 diffuse;
@@ -96,10 +101,25 @@ public:
 	void setReflectiveness(float r);
 	float getReflectiveness();
 	
-	//return static material shader program for clinets to use
+	//return static material shader program for clinets to use, the G-buffer one when deferred
 	static GLuint getShaderProgram();
 
+	//program that evaluates scene lights, the material shader itself unless deferred
+	static GLuint getLightingProgram();
+	static GLuint getForwardShaderProgram();
+	static GLuint getDeferredLightingProgram();
+
+	//switch between forward and deferred shading at runtime
+	static void setDeferred(bool opt);
+	static bool isDeferred();
+
 	//sent material settings to static shader program
 	void applySettings();
 
+	//true when applySettings of either would send the same uniforms and textures
+	bool sameSettings(Material& other);
+
+	//texture units applySettings would rebind after previous was applied, every used one without it
+	int countTextureChanges(Material* previous);
+
 };
@@ -0,0 +1,217 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <cmath>
+#include "Mesh.h"
+#include "GLState.h"
+using namespace std;
+
+std::map<std::string, Mesh*> Mesh::loadedMeshes;
+unsigned int Mesh::nextID = 0;
+
+//every model of the same file shares one mesh, parsed and uploaded the first time it is asked for
+Mesh* Mesh::load(const char* filepath) {
+
+	std::map<std::string, Mesh*>::iterator found = loadedMeshes.find(filepath);
+	if (found != loadedMeshes.end()) {
+		++found->second->users;
+		return found->second;
+	}
+	Mesh* mesh = new Mesh(filepath);
+	loadedMeshes[filepath] = mesh;
+	return mesh;
+}
+void Mesh::release(Mesh* mesh) {
+
+	if (--mesh->users > 0)
+		return;
+	loadedMeshes.erase(mesh->filepath);
+	delete mesh;
+}
+
+Mesh::Mesh(const char* filepath) {
+
+	this->filepath = filepath;
+	users = 1;
+	id = nextID++;
+
+	//read in geometry data disk
+	parse(filepath);
+
+	//into the shared buffers, indices stay relative to this mesh's base vertex
+	MeshPool::add(vertices, normals, UVs, tangents, bitangents, indices, baseVertex, firstIndex);
+}
+
+Mesh::~Mesh() {
+	MeshPool::remove(baseVertex, vertices.size(), firstIndex, indices.size());
+}
+
+void Mesh::draw() {
+	bind();
+	drawElements();
+	GLState::bindVertexArray(0);
+}
+
+//every mesh lives in the pool's vertex array, binding one binds them all
+void Mesh::bind() {
+	MeshPool::bind();
+}
+void Mesh::drawElements() {
+	glDrawElementsBaseVertex(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, (GLvoid*)(firstIndex * sizeof(GLuint)), baseVertex);
+}
+
+//count copies in one draw of the bound mesh, instance_buffer holds a toWorld matrix per instance starting at offset
+void Mesh::drawElementsInstanced(GLuint instance_buffer, GLintptr offset, GLsizei count) {
+	MeshPool::setInstanceBuffer(instance_buffer, offset);
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, (GLvoid*)(firstIndex * sizeof(GLuint)), count, baseVertex);
+	MeshPool::clearInstanceBuffer();
+}
+
+unsigned int Mesh::getID() {
+	return id;
+}
+GLint Mesh::getBaseVertex() {
+	return baseVertex;
+}
+GLuint Mesh::getFirstIndex() {
+	return firstIndex;
+}
+
+GLsizei Mesh::getNumIndices() {
+	return indices.size();
+}
+const std::vector<GLuint>& Mesh::getIndices() const {
+	return indices;
+}
+const std::vector<glm::vec3>& Mesh::getVertices() const {
+	return vertices;
+}
+glm::vec3 Mesh::getCenterOffset() {
+	return centerOffset;
+}
+const AABB& Mesh::getBounds() const {
+	return bounds;
+}
+const ConvexHull& Mesh::getCollisionHull() const {
+	return collisionHull;
+}
+
+//PRIVATE HELPERS
+void Mesh::parse(const char *filepath) 
+{
+
+	// Parsing Variables	
+	FILE* fp;
+	char currLine[BUFSIZ];
+	GLfloat x, y, z;
+	GLfloat r, g, b;
+	GLuint v1, v2, v3, n1, n2, n3, t1, t2, t3;
+
+	GLfloat lowestX, highestX, lowestY, highestY, lowestZ, highestZ;
+
+	// Variables for finding Model Center of Mass
+	bool firstVertex = true;
+
+	fp = fopen(filepath, "rb");
+	if (fp == NULL) {
+		cerr << "error loading file" << endl;
+		exit(-1);
+	}
+	cout << "Parsing " << string(filepath) << "..."<< endl;
+
+	while (fgets(currLine, BUFSIZ, fp) != NULL) {
+
+		//Process vertex attributes
+		if (currLine[0] == 'v') {
+
+			//process vertex position
+			if (currLine[1] == ' ') {
+				sscanf(currLine + 2, "%f %f %f %f %f %f", &x, &y, &z, &r, &g, &b);
+				vertices.push_back(glm::vec3(x,y,z));
+
+				//Code to calc center of mass
+				if (firstVertex) {
+					lowestX = highestX = x;
+					lowestY = highestY = y;
+					lowestZ = highestZ = z;
+					firstVertex = false;
+				}
+				if (x > highestX)	highestX = x;
+				if (x < lowestX)	lowestX = x;
+				if (y > highestY)	highestY = y;
+				if (y < lowestY)	lowestY = y;
+				if (z > highestZ)	highestZ = z;
+				if (z < lowestZ)	lowestZ = z;
+
+			}
+
+			//process vertex normal
+			else if (currLine[1] == 'n' && currLine[2] == ' ') {
+				sscanf(currLine + 3, "%f %f %f", &x, &y, &z);
+				GLfloat magnitude = sqrt(x * x + y * y + z * z);
+
+				normals.push_back(glm::vec3(x / magnitude, y / magnitude, z / magnitude));
+
+			}
+
+			//process vertex texture UVs
+			else if (currLine[1] == 't' && currLine[2] == ' ') {
+				sscanf(currLine + 3, "%f %f", &x, &y);
+				UVs.push_back(glm::vec2(x, y));
+			}
+		}
+		//process face
+		else if (currLine[0] == 'f' && currLine[1] == ' ') {		
+			sscanf(currLine + 2, "%i/%i/%i %i/%i/%i %i/%i/%i", &v1, &n1, &t1, &v2, &n2, &t2, &v3, &n3, &t3);
+			indices.push_back(v1 - 1);
+			indices.push_back(v2 - 1);
+			indices.push_back(v3 - 1);
+		}
+		
+	}//END FOR
+	
+	//define object center
+	centerOffset.x = (highestX + lowestX) / 2.0f;
+	centerOffset.y = (highestY + lowestY) / 2.0f;
+	centerOffset.z = (highestZ + lowestZ) / 2.0f;
+	bounds = AABB(glm::vec3(lowestX, lowestY, lowestZ), glm::vec3(highestX, highestY, highestZ));
+	collisionHull.build(vertices);
+
+	
+	//Calc Tangents and Bitangents
+	for (unsigned int i = 0; i< vertices.size(); i += 3) {
+
+		// Shortcuts for vertices
+		glm::vec3 & v0 = vertices[i + 0];
+		glm::vec3 & v1 = vertices[i + 1];
+		glm::vec3 & v2 = vertices[i + 2];
+
+		// Shortcuts for UVs
+		glm::vec2 & uv0 = UVs[i + 0];
+		glm::vec2 & uv1 = UVs[i + 1];
+		glm::vec2 & uv2 = UVs[i + 2];
+
+		// Edges of the triangle : postion delta
+		glm::vec3 deltaPos1 = v1 - v0;
+		glm::vec3 deltaPos2 = v2 - v0;
+
+		// UV delta
+		glm::vec2 deltaUV1 = uv1 - uv0;
+		glm::vec2 deltaUV2 = uv2 - uv0;
+
+		float r = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x);
+		glm::vec3 tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y)*r;
+		glm::vec3 bitangent = (deltaPos2 * deltaUV1.x - deltaPos1 * deltaUV2.x)*r;
+
+		tangents.push_back(tangent);
+		tangents.push_back(tangent);
+		tangents.push_back(tangent);
+
+		// Same thing for binormals
+		bitangents.push_back(bitangent);
+		bitangents.push_back(bitangent);
+		bitangents.push_back(bitangent);
+
+	}//END FOR
+}//END PARSE
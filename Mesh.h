@@ -0,0 +1,73 @@
+#pragma once
+
+#define GLFW_INCLUDE_GLEXT
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#define GLM_FORCE_RADIANS
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vector>
+#include <map>
+#include <string>
+#include "AABB.h"
+#include "ConvexHull.h"
+#include "MeshPool.h"
+
+/*Geometry parsed from an obj file and uploaded once into the mesh pool, shared
+by every model loaded from the same file. Sharing the geometry is what lets
+models of the same mesh and material be drawn together in one instanced draw*/
+class Mesh {
+
+	//loaded meshes by file, released when their last model is
+	static std::map<std::string, Mesh*> loadedMeshes;
+	static unsigned int nextID;
+	std::string filepath;
+	int users;
+	unsigned int id;		//load order, small enough for a render queue sort key
+
+	//Mesh Geometry Data
+	std::vector<GLuint> indices;
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> UVs;
+	std::vector<glm::vec3> tangents;
+	std::vector<glm::vec3> bitangents;
+
+	glm::vec3 centerOffset;
+	AABB bounds;
+
+	//collision shape, built once from the mesh when it is parsed
+	ConvexHull collisionHull;
+
+	//where the pool put this mesh's vertices and indices
+	GLint baseVertex;
+	GLuint firstIndex;
+
+public:
+
+	static Mesh* load(const char* filepath);
+	static void release(Mesh* mesh);
+
+	void draw();
+
+	//the render queue binds a mesh once for a run of draws of it
+	void bind();
+	void drawElements();
+	void drawElementsInstanced(GLuint instance_buffer, GLintptr offset, GLsizei count);
+
+	unsigned int getID();
+	GLint getBaseVertex();
+	GLuint getFirstIndex();
+	GLsizei getNumIndices();
+	const std::vector<GLuint>& getIndices() const;
+	const std::vector<glm::vec3>& getVertices() const;
+	glm::vec3 getCenterOffset();
+	const AABB& getBounds() const;
+	const ConvexHull& getCollisionHull() const;
+
+private:
+	Mesh(const char* filepath);
+	~Mesh();
+	void parse(const char* filepath);
+};
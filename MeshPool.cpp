@@ -0,0 +1,168 @@
+#include "MeshPool.h"
+#include "GLState.h"
+
+GLuint MeshPool::VAO = 0;
+GLuint MeshPool::vertexBuffers[MeshPool::NUM_ATTRIBUTES];
+GLuint MeshPool::indexBuffer = 0;
+RangeAllocator MeshPool::vertexRanges;
+RangeAllocator MeshPool::indexRanges;
+
+void MeshPool::initStatics() {
+
+	// Create array object and buffers. Remember to delete your buffers when the pool is cleaned up!
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(NUM_ATTRIBUTES, vertexBuffers);
+	glGenBuffers(1, &indexBuffer);
+
+	for (int i = 0; i < NUM_ATTRIBUTES; ++i) {
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[i]);
+		glBufferData(GL_ARRAY_BUFFER, INITIAL_VERTICES * getAttributeSize(i), NULL, GL_STATIC_DRAW);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	vertexRanges.init(INITIAL_VERTICES);
+
+	GLState::bindVertexArray(VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, INITIAL_INDICES * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+	GLState::bindVertexArray(0);
+	indexRanges.init(INITIAL_INDICES);
+
+	setUpVertexArray();
+}
+void MeshPool::cleanUpStatics() {
+	GLState::deleteVertexArrays(1, &VAO);
+	glDeleteBuffers(NUM_ATTRIBUTES, vertexBuffers);
+	glDeleteBuffers(1, &indexBuffer);
+}
+
+void MeshPool::add(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& uvs,
+	const std::vector<glm::vec3>& tangents, const std::vector<glm::vec3>& bitangents, const std::vector<GLuint>& indices,
+	GLint& base_vertex, GLuint& first_index) {
+
+	unsigned int vertexCount = positions.size();
+	unsigned int vertexOffset = vertexRanges.allocate(vertexCount);
+	if (vertexOffset == RangeAllocator::INVALID) {
+		growVertices(vertexRanges.getCapacity() + vertexCount);
+		vertexOffset = vertexRanges.allocate(vertexCount);
+	}
+	unsigned int indexOffset = indexRanges.allocate(indices.size());
+	if (indexOffset == RangeAllocator::INVALID) {
+		growIndices(indexRanges.getCapacity() + indices.size());
+		indexOffset = indexRanges.allocate(indices.size());
+	}
+
+	const void* attributeData[NUM_ATTRIBUTES] = { positions.data(), normals.data(), uvs.data(), tangents.data(), bitangents.data() };
+	unsigned int attributeCounts[NUM_ATTRIBUTES] = { (unsigned int)positions.size(), (unsigned int)normals.size(), (unsigned int)uvs.size(),
+		(unsigned int)tangents.size(), (unsigned int)bitangents.size() };
+	for (int i = 0; i < NUM_ATTRIBUTES; ++i) {
+		unsigned int count = attributeCounts[i] < vertexCount ? attributeCounts[i] : vertexCount;
+		if (count == 0)
+			continue;
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[i]);
+		glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * getAttributeSize(i), count * getAttributeSize(i), attributeData[i]);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//indices stay relative to the mesh, the base vertex offsets them when drawn
+	GLState::bindVertexArray(VAO);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset * sizeof(GLuint), indices.size() * sizeof(GLuint), indices.data());
+	GLState::bindVertexArray(0);
+
+	base_vertex = vertexOffset;
+	first_index = indexOffset;
+}
+void MeshPool::remove(GLint base_vertex, unsigned int vertex_count, GLuint first_index, unsigned int index_count) {
+	vertexRanges.free(base_vertex, vertex_count);
+	indexRanges.free(first_index, index_count);
+}
+
+void MeshPool::bind() {
+	GLState::bindVertexArray(VAO);
+}
+
+/*The matrix takes four attribute slots, one per column, that advance once per
+instance instead of once per vertex. Instanced attributes also start at each
+draw's base instance, which is how indirect draws find their objects*/
+void MeshPool::setInstanceBuffer(GLuint instance_buffer, GLintptr offset) {
+
+	bind();
+	glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+	for (int i = 0; i < 4; ++i) {
+		glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + i);
+		glVertexAttribPointer(INSTANCE_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (GLvoid*)(offset + i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(INSTANCE_ATTRIBUTE + i, 1);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+//single draws read toWorld from the uniform again
+void MeshPool::clearInstanceBuffer() {
+	bind();
+	for (int i = 0; i < 4; ++i) {
+		glDisableVertexAttribArray(INSTANCE_ATTRIBUTE + i);
+	}
+}
+
+//PRIVATE HELPERS
+
+//attribute i at location i, each in its own tightly packed buffer
+void MeshPool::setUpVertexArray() {
+
+	GLint components[NUM_ATTRIBUTES] = { 3, 3, 2, 3, 3 };
+
+	GLState::bindVertexArray(VAO);
+	for (int i = 0; i < NUM_ATTRIBUTES; ++i) {
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[i]);
+		glEnableVertexAttribArray(i);
+		glVertexAttribPointer(i, components[i], GL_FLOAT, GL_FALSE, components[i] * sizeof(GLfloat), (GLvoid*)0);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	// Unbind the currently bound buffer so that we don't accidentally make unwanted changes to it.
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::bindVertexArray(0);
+}
+
+void MeshPool::growVertices(unsigned int min_capacity) {
+
+	unsigned int oldCapacity = vertexRanges.getCapacity();
+	unsigned int newCapacity = oldCapacity * 2;
+	while (newCapacity < min_capacity) {
+		newCapacity *= 2;
+	}
+	for (int i = 0; i < NUM_ATTRIBUTES; ++i) {
+		vertexBuffers[i] = resizeBuffer(vertexBuffers[i], oldCapacity * getAttributeSize(i), newCapacity * getAttributeSize(i));
+	}
+	vertexRanges.grow(newCapacity);
+	setUpVertexArray();
+}
+void MeshPool::growIndices(unsigned int min_capacity) {
+
+	unsigned int oldCapacity = indexRanges.getCapacity();
+	unsigned int newCapacity = oldCapacity * 2;
+	while (newCapacity < min_capacity) {
+		newCapacity *= 2;
+	}
+	indexBuffer = resizeBuffer(indexBuffer, oldCapacity * sizeof(GLuint), newCapacity * sizeof(GLuint));
+	indexRanges.grow(newCapacity);
+	setUpVertexArray();
+}
+
+//a larger buffer holding the old one's contents, which is deleted
+GLuint MeshPool::resizeBuffer(GLuint buffer, GLsizeiptr old_size, GLsizeiptr new_size) {
+
+	GLuint resized;
+	glGenBuffers(1, &resized);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, resized);
+	glBufferData(GL_COPY_WRITE_BUFFER, new_size, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_size);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &buffer);
+	return resized;
+}
+
+GLsizeiptr MeshPool::getAttributeSize(int attribute) {
+	return attribute == UVS ? sizeof(glm::vec2) : sizeof(glm::vec3);
+}
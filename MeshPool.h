@@ -0,0 +1,58 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "RangeAllocator.h"
+
+/*Every mesh's vertices and indices, in one buffer per vertex attribute and one
+index buffer, all behind a single vertex array. Meshes get a range of each from
+sub-allocators and draw with a base vertex, so switching mesh never switches
+vertex array, and one indirect draw can cover any number of meshes. The buffers
+double when full, their contents copied over on the GPU*/
+class MeshPool {
+
+public:
+
+	enum Attributes { POSITIONS, NORMALS, UVS, TANGENTS, BITANGENTS, NUM_ATTRIBUTES };
+
+	const static unsigned int INITIAL_VERTICES = 1 << 16;
+	const static unsigned int INITIAL_INDICES = 1 << 18;
+
+	//first of the four attribute locations holding a per instance toWorld matrix
+	const static GLuint INSTANCE_ATTRIBUTE = 5;
+
+private:
+
+	static GLuint VAO;
+	static GLuint vertexBuffers[NUM_ATTRIBUTES];
+	static GLuint indexBuffer;
+	static RangeAllocator vertexRanges;
+	static RangeAllocator indexRanges;
+
+public:
+
+	//manage statics
+	static void initStatics();
+	static void cleanUpStatics();
+
+	//copies a mesh in, attributes shorter than positions are left undefined past their end
+	static void add(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& uvs,
+		const std::vector<glm::vec3>& tangents, const std::vector<glm::vec3>& bitangents, const std::vector<GLuint>& indices,
+		GLint& base_vertex, GLuint& first_index);
+	static void remove(GLint base_vertex, unsigned int vertex_count, GLuint first_index, unsigned int index_count);
+
+	static void bind();
+
+	//per instance toWorld matrices read from buffer, starting at offset, until cleared
+	static void setInstanceBuffer(GLuint instance_buffer, GLintptr offset);
+	static void clearInstanceBuffer();
+
+private:
+	static void setUpVertexArray();
+	static void growVertices(unsigned int min_capacity);
+	static void growIndices(unsigned int min_capacity);
+	static GLuint resizeBuffer(GLuint buffer, GLsizeiptr old_size, GLsizeiptr new_size);
+	static GLsizeiptr getAttributeSize(int attribute);
+};
@@ -11,46 +11,56 @@
 #include "Material.h"
 #include "ShadowMap.h"
 #include "SceneObject.h"
+#include "Mesh.h"
 class Scene;
+class BoundingBox;
 
 class Model : public SceneObject
 {
 
-	//Model Geometry Data
-	std::vector<GLuint> indices;
-	std::vector<glm::vec3> vertices;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::vec2> UVs;
-	std::vector<glm::vec3> tangents;
-	std::vector<glm::vec3> bitangents;
+	//Model Geometry Data, shared with every model of the same file
+	Mesh* mesh;
 
 	//centers model geometry
-	glm::vec3 meshCenterOffset;
 	glm::mat4 centerModelMeshMatrix;
 
-	//Rendering with modern OpenGL
-	GLuint VBO_positions, VBO_normals, VBO_uvs, VBO_tangents, VBO_bitangents, VAO, EBO;
+	//occlusion culling, triangles are the render mesh unless a simpler one is given
+	bool occluder;
+	std::vector<glm::vec3> occluderMesh;
 
 	//object's material
 	Material material;
+
+	//follows the model for the scene's broad and narrow phase
+	BoundingBox* boundingBox;
 	
 public:
 
 	Model(const char* filepath, Material m);
 	~Model();
-	void parse(const char* filepath);
 
 	
 
 	//override
 	void sendThisGeometryToShadowMap();
+	void sendThisGeometryToOcclusionBuffer(OcclusionBuffer* buffer);
 	void drawThisSceneObject(Scene* currScene);
+	bool getLocalBounds(AABB& bounds) const;
+	BoundingBox* getBoundingBox();
+
+	//the draw put off until the scene's render queue was submitted
+	void drawQueried(Scene* currScene);
 
 	void setMaterial(Material m);
 	Material& getMaterial();
 	void centerMesh(bool opt);
+	void setOccluder(bool opt);
+	void setOccluderMesh(const std::vector<glm::vec3>& triangle_vertices);
 	glm::mat4 getToWorldWithCenteredMesh();
+	Mesh* getMesh();
 	std::vector<glm::vec3> getVertices();
+	const AABB& getMeshBounds() const;
+	const ConvexHull& getCollisionHull() const;
 
 private:
 	void applySettings();
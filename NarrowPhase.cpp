@@ -0,0 +1,402 @@
+#include "NarrowPhase.h"
+#include "Model.h"
+#include "BoundingBox.h"
+#include "JobSystem.h"
+#include <cfloat>
+#include <cmath>
+
+/*Ericson's formulation: everything is expressed in a's frame, R takes b's axes
+into it. Besides the separating test each axis reports its overlap, the smallest
+overlap gives the contact normal. Cross product axes are divided by their length
+so overlaps on every axis are measured in the same units*/
+bool NarrowPhase::testOBBs(const OBB& a, const OBB& b, glm::vec3& normal, float& depth) {
+
+	//near parallel edges give near zero cross products, the face axes already cover them
+	const float PARALLEL_EPSILON = 1e-6f;
+
+	float R[3][3], absR[3][3];
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			R[i][j] = glm::dot(a.axes[i], b.axes[j]);
+			absR[i][j] = std::fabs(R[i][j]) + PARALLEL_EPSILON;
+		}
+	}
+
+	glm::vec3 offset = b.center - a.center;
+	float t[3] = { glm::dot(offset, a.axes[0]), glm::dot(offset, a.axes[1]), glm::dot(offset, a.axes[2]) };
+	const glm::vec3& ea = a.halfExtents;
+	const glm::vec3& eb = b.halfExtents;
+
+	float bestDepth = FLT_MAX;
+	glm::vec3 bestAxis(0, 1, 0);
+
+	//false if the axis separates the boxes, otherwise keeps it when it overlaps least
+	auto testAxis = [&](float ra, float rb, float distance, glm::vec3 axis, float axis_length) {
+		float overlap = ra + rb - std::fabs(distance);
+		if (overlap < 0.0f) {
+			return false;
+		}
+		overlap /= axis_length;
+		if (overlap < bestDepth) {
+			bestDepth = overlap;
+			bestAxis = (distance < 0.0f ? -axis : axis) / axis_length;
+		}
+		return true;
+	};
+
+	//a's faces
+	for (int i = 0; i < 3; ++i) {
+		float rb = eb[0] * absR[i][0] + eb[1] * absR[i][1] + eb[2] * absR[i][2];
+		if (!testAxis(ea[i], rb, t[i], a.axes[i], 1.0f))
+			return false;
+	}
+
+	//b's faces
+	for (int j = 0; j < 3; ++j) {
+		float ra = ea[0] * absR[0][j] + ea[1] * absR[1][j] + ea[2] * absR[2][j];
+		float distance = t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j];
+		if (!testAxis(ra, eb[j], distance, b.axes[j], 1.0f))
+			return false;
+	}
+
+	//edge pairs
+	for (int i = 0; i < 3; ++i) {
+		int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+		for (int j = 0; j < 3; ++j) {
+			int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+
+			float axisLength = std::sqrt(glm::max(0.0f, 1.0f - R[i][j] * R[i][j]));
+			if (axisLength < 1e-3f)
+				continue;
+
+			float ra = ea[i1] * absR[i2][j] + ea[i2] * absR[i1][j];
+			float rb = eb[j1] * absR[i][j2] + eb[j2] * absR[i][j1];
+			float distance = t[i2] * R[i1][j] - t[i1] * R[i2][j];
+			if (!testAxis(ra, rb, distance, glm::cross(a.axes[i], b.axes[j]), axisLength))
+				return false;
+		}
+	}
+
+	normal = bestAxis;
+	depth = bestDepth;
+	return true;
+}
+
+bool NarrowPhase::testHulls(const ConvexHull& a, const glm::mat4& a_to_world,
+	const ConvexHull& b, const glm::mat4& b_to_world, glm::vec3& normal, float& depth) {
+
+	Shape shapeA = { &a, a_to_world };
+	Shape shapeB = { &b, b_to_world };
+
+	glm::vec3 simplex[4];
+	if (!runGJK(shapeA, shapeB, simplex)) {
+		return false;
+	}
+	runEPA(shapeA, shapeB, simplex, normal, depth);
+	return true;
+}
+
+bool NarrowPhase::collide(Model* a, Model* b, Contact& contact) {
+
+	glm::mat4 aToWorld = a->getToWorldWithCenteredMesh();
+	glm::mat4 bToWorld = b->getToWorldWithCenteredMesh();
+
+	contact.a = a;
+	contact.b = b;
+
+	OBB boxA(a->getMeshBounds(), aToWorld);
+	OBB boxB(b->getMeshBounds(), bToWorld);
+	if (!testOBBs(boxA, boxB, contact.normal, contact.depth)) {
+		return false;
+	}
+
+	//flat meshes have no hull, the box answer is the best there is
+	const ConvexHull& hullA = a->getCollisionHull();
+	const ConvexHull& hullB = b->getCollisionHull();
+	if (hullA.getVertices().empty() || hullB.getVertices().empty()) {
+		return true;
+	}
+	return testHulls(hullA, aToWorld, hullB, bToWorld, contact.normal, contact.depth);
+}
+
+void NarrowPhase::collidePairs(const std::vector<BroadPhase::Pair>& pairs, std::vector<Contact>& contacts) {
+
+	//each pair writes its own slot, so no locking while testing
+	std::vector<Contact> results(pairs.size());
+	std::vector<char> colliding(pairs.size(), 0);
+
+	JobSystem::parallelFor(pairs.size(), 32, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i) {
+			Model* a = pairs[i].a->getOwner();
+			Model* b = pairs[i].b->getOwner();
+			if (a != NULL && b != NULL && collide(a, b, results[i])) {
+				colliding[i] = 1;
+			}
+		}
+	});
+
+	contacts.clear();
+	for (unsigned int i = 0; i < pairs.size(); ++i) {
+		if (colliding[i]) {
+			contacts.push_back(results[i]);
+		}
+	}
+}
+
+
+//PRIVATE HELPERS
+
+//directions are taken into hull space with the transpose, which is exact for any linear part
+glm::vec3 NarrowPhase::Shape::getSupport(glm::vec3 direction) const {
+
+	glm::vec3 localDirection(glm::dot(direction, glm::vec3(toWorld[0])),
+		glm::dot(direction, glm::vec3(toWorld[1])),
+		glm::dot(direction, glm::vec3(toWorld[2])));
+
+	return glm::vec3(toWorld * glm::vec4(hull->getSupport(localDirection), 1.0f));
+}
+
+glm::vec3 NarrowPhase::getMinkowskiSupport(const Shape& a, const Shape& b, glm::vec3 direction) {
+	return a.getSupport(direction) - b.getSupport(-direction);
+}
+
+/*Searches the Minkowski difference a - b for the origin. On success the simplex
+is a tetrahedron around the origin, newest point first*/
+bool NarrowPhase::runGJK(const Shape& a, const Shape& b, glm::vec3 simplex[4]) {
+
+	const int MAX_ITERATIONS = 64;
+
+	glm::vec3 direction = glm::vec3(a.toWorld[3]) - glm::vec3(b.toWorld[3]);
+	if (glm::dot(direction, direction) < 1e-12f) {
+		direction = glm::vec3(1, 0, 0);
+	}
+
+	simplex[0] = getMinkowskiSupport(a, b, direction);
+	int size = 1;
+	direction = -simplex[0];
+
+	for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+
+		//origin sits on the simplex, the shapes only touch
+		if (glm::dot(direction, direction) < 1e-12f) {
+			return false;
+		}
+
+		glm::vec3 point = getMinkowskiSupport(a, b, direction);
+		if (glm::dot(point, direction) <= 0.0f) {
+			return false;
+		}
+
+		for (int i = size; i > 0; --i) {
+			simplex[i] = simplex[i - 1];
+		}
+		simplex[0] = point;
+		++size;
+
+		if (updateSimplex(simplex, size, direction)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*Keeps the feature of the simplex closest to the origin and points the search
+direction at the origin from it. After the triangle case the winding is such
+that cross(b - a, c - a) faces the origin, which the tetrahedron case relies on*/
+bool NarrowPhase::updateSimplex(glm::vec3 simplex[4], int& size, glm::vec3& direction) {
+
+	glm::vec3 a = simplex[0];
+	glm::vec3 ao = -a;
+
+	//toward the origin from segment a b, or any perpendicular if the origin is on it
+	auto lineCase = [&](glm::vec3 b) {
+		glm::vec3 ab = b - a;
+		if (glm::dot(ab, ao) > 0.0f) {
+			simplex[0] = a;
+			simplex[1] = b;
+			size = 2;
+			direction = glm::cross(glm::cross(ab, ao), ab);
+			if (glm::dot(direction, direction) < 1e-12f) {
+				direction = glm::cross(ab, glm::vec3(1, 0, 0));
+				if (glm::dot(direction, direction) < 1e-12f)
+					direction = glm::cross(ab, glm::vec3(0, 1, 0));
+			}
+		}
+		else {
+			simplex[0] = a;
+			size = 1;
+			direction = ao;
+		}
+	};
+
+	auto triangleCase = [&](glm::vec3 b, glm::vec3 c) {
+		glm::vec3 ab = b - a;
+		glm::vec3 ac = c - a;
+		glm::vec3 abc = glm::cross(ab, ac);
+
+		if (glm::dot(glm::cross(abc, ac), ao) > 0.0f) {
+			if (glm::dot(ac, ao) > 0.0f) {
+				simplex[0] = a;
+				simplex[1] = c;
+				size = 2;
+				direction = glm::cross(glm::cross(ac, ao), ac);
+			}
+			else {
+				lineCase(b);
+			}
+		}
+		else if (glm::dot(glm::cross(ab, abc), ao) > 0.0f) {
+			lineCase(b);
+		}
+		else if (glm::dot(abc, ao) > 0.0f) {
+			simplex[0] = a;
+			simplex[1] = b;
+			simplex[2] = c;
+			size = 3;
+			direction = abc;
+		}
+		else {
+			simplex[0] = a;
+			simplex[1] = c;
+			simplex[2] = b;
+			size = 3;
+			direction = -abc;
+		}
+	};
+
+	if (size == 2) {
+		lineCase(simplex[1]);
+		return false;
+	}
+	if (size == 3) {
+		triangleCase(simplex[1], simplex[2]);
+		return false;
+	}
+
+	//tetrahedron, the face opposite a was checked on the previous step
+	glm::vec3 b = simplex[1], c = simplex[2], d = simplex[3];
+	if (glm::dot(glm::cross(b - a, c - a), ao) > 0.0f) {
+		triangleCase(b, c);
+		return false;
+	}
+	if (glm::dot(glm::cross(c - a, d - a), ao) > 0.0f) {
+		triangleCase(c, d);
+		return false;
+	}
+	if (glm::dot(glm::cross(d - a, b - a), ao) > 0.0f) {
+		triangleCase(d, b);
+		return false;
+	}
+	return true;
+}
+
+/*Grows the GJK tetrahedron toward the boundary of a - b. Each step finds the face
+closest to the origin and pushes a new support point out along its normal; once
+the support stops moving the face, that face's normal and distance are the
+minimum translation*/
+void NarrowPhase::runEPA(const Shape& a, const Shape& b, const glm::vec3 simplex[4], glm::vec3& normal, float& depth) {
+
+	const int MAX_ITERATIONS = 64;
+	const float TOLERANCE = 1e-4f;
+
+	struct Face {
+		int a, b, c;
+		glm::vec3 normal;
+		float distance;
+	};
+
+	std::vector<glm::vec3> points(simplex, simplex + 4);
+	std::vector<Face> faces;
+	std::vector<std::pair<int, int> > horizon;
+
+	//the origin is inside, so an outward normal has a positive distance
+	auto addFace = [&](int i0, int i1, int i2) {
+		Face face = { i0, i1, i2, glm::cross(points[i1] - points[i0], points[i2] - points[i0]), 0.0f };
+		float length = glm::length(face.normal);
+		if (length < 1e-12f) {
+			face.normal = glm::vec3(0, 1, 0);
+			face.distance = FLT_MAX;	//sliver, never chosen as the closest face
+		}
+		else {
+			face.normal /= length;
+			face.distance = glm::dot(face.normal, points[i0]);
+			if (face.distance < 0.0f) {
+				std::swap(face.b, face.c);
+				face.normal = -face.normal;
+				face.distance = -face.distance;
+			}
+		}
+		faces.push_back(face);
+	};
+
+	addFace(0, 1, 2);
+	addFace(0, 2, 3);
+	addFace(0, 3, 1);
+	addFace(1, 3, 2);
+
+	for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+
+		unsigned int closest = 0;
+		for (unsigned int i = 1; i < faces.size(); ++i) {
+			if (faces[i].distance < faces[closest].distance)
+				closest = i;
+		}
+
+		glm::vec3 searchNormal = faces[closest].normal;
+		glm::vec3 support = getMinkowskiSupport(a, b, searchNormal);
+		if (glm::dot(support, searchNormal) - faces[closest].distance < TOLERANCE) {
+			break;
+		}
+
+		//remove every face the new point can see, keeping the edges of the hole
+		int newIndex = points.size();
+		points.push_back(support);
+		horizon.clear();
+		for (unsigned int i = 0; i < faces.size();) {
+
+			if (glm::dot(faces[i].normal, support - points[faces[i].a]) <= 0.0f) {
+				++i;
+				continue;
+			}
+
+			int edges[3][2] = { { faces[i].a, faces[i].b }, { faces[i].b, faces[i].c }, { faces[i].c, faces[i].a } };
+			for (int e = 0; e < 3; ++e) {
+
+				//an edge shared by two removed faces is interior to the hole
+				bool shared = false;
+				for (unsigned int h = 0; h < horizon.size(); ++h) {
+					if (horizon[h].first == edges[e][1] && horizon[h].second == edges[e][0]) {
+						horizon[h] = horizon.back();
+						horizon.pop_back();
+						shared = true;
+						break;
+					}
+				}
+				if (!shared) {
+					horizon.push_back(std::make_pair(edges[e][0], edges[e][1]));
+				}
+			}
+			faces[i] = faces.back();
+			faces.pop_back();
+		}
+
+		for (unsigned int h = 0; h < horizon.size(); ++h) {
+			addFace(horizon[h].first, horizon[h].second, newIndex);
+		}
+
+		//numerical trouble removed everything, keep the last good answer
+		if (faces.empty()) {
+			normal = searchNormal;
+			depth = glm::dot(support, searchNormal);
+			return;
+		}
+	}
+
+	unsigned int closest = 0;
+	for (unsigned int i = 1; i < faces.size(); ++i) {
+		if (faces[i].distance < faces[closest].distance)
+			closest = i;
+	}
+	normal = faces[closest].normal;
+	depth = faces[closest].distance;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "OBB.h"
+#include "ConvexHull.h"
+#include "BroadPhase.h"
+
+class Model;
+
+//one colliding pair, moving b by normal * depth separates the two
+struct Contact {
+	Model* a;
+	Model* b;
+	glm::vec3 normal;		//unit length, points from a towards b
+	float depth;
+};
+
+/*Exact tests for pairs the broad phase reports. Oriented boxes are separated
+with the 15 axis SAT test, convex hulls with GJK, and EPA expands the final GJK
+simplex to find penetration depth and normal. Every function is stateless so
+pairs can be tested on any thread*/
+class NarrowPhase {
+
+public:
+
+	static bool testOBBs(const OBB& a, const OBB& b, glm::vec3& normal, float& depth);
+	static bool testHulls(const ConvexHull& a, const glm::mat4& a_to_world,
+		const ConvexHull& b, const glm::mat4& b_to_world, glm::vec3& normal, float& depth);
+
+	//OBB test as an early out, then the hulls for an exact answer
+	static bool collide(Model* a, Model* b, Contact& contact);
+
+	//test every pair that has models on both boxes, on the job system
+	static void collidePairs(const std::vector<BroadPhase::Pair>& pairs, std::vector<Contact>& contacts);
+
+private:
+
+	//support of a hull carried into world space by to_world
+	struct Shape {
+		const ConvexHull* hull;
+		glm::mat4 toWorld;
+		glm::vec3 getSupport(glm::vec3 direction) const;
+	};
+
+	static glm::vec3 getMinkowskiSupport(const Shape& a, const Shape& b, glm::vec3 direction);
+
+	static bool runGJK(const Shape& a, const Shape& b, glm::vec3 simplex[4]);
+	static bool updateSimplex(glm::vec3 simplex[4], int& size, glm::vec3& direction);
+	static void runEPA(const Shape& a, const Shape& b, const glm::vec3 simplex[4], glm::vec3& normal, float& depth);
+};
@@ -0,0 +1,42 @@
+#include "OBB.h"
+
+OBB::OBB() {
+	center = glm::vec3(0, 0, 0);
+	axes[0] = glm::vec3(1, 0, 0);
+	axes[1] = glm::vec3(0, 1, 0);
+	axes[2] = glm::vec3(0, 0, 1);
+	halfExtents = glm::vec3(0, 0, 0);
+}
+
+/*scale is moved out of the axes into the extents, assumes to_world has no shear,
+which holds for everything built from position, rotation and scale*/
+OBB::OBB(const AABB& local_bounds, const glm::mat4& to_world) {
+
+	center = glm::vec3(to_world * glm::vec4(local_bounds.getCenter(), 1.0f));
+
+	glm::vec3 localExtents = local_bounds.getExtents();
+	for (int i = 0; i < 3; ++i) {
+		glm::vec3 column = glm::vec3(to_world[i]);
+		float scale = glm::length(column);
+		axes[i] = scale > 0.0f ? column / scale : glm::vec3(i == 0, i == 1, i == 2);
+		halfExtents[i] = localExtents[i] * scale;
+	}
+}
+
+glm::vec3 OBB::getSupport(glm::vec3 direction) const {
+
+	glm::vec3 support = center;
+	for (int i = 0; i < 3; ++i) {
+		support += axes[i] * (glm::dot(axes[i], direction) >= 0.0f ? halfExtents[i] : -halfExtents[i]);
+	}
+	return support;
+}
+
+AABB OBB::getBounds() const {
+
+	glm::vec3 extents(0, 0, 0);
+	for (int i = 0; i < 3; ++i) {
+		extents += glm::abs(axes[i]) * halfExtents[i];
+	}
+	return AABB(center - extents, center + extents);
+}
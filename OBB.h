@@ -0,0 +1,19 @@
+#pragma once
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "AABB.h"
+
+//oriented box, an object space AABB carried along by the object's rotation
+class OBB {
+
+public:
+	glm::vec3 center;
+	glm::vec3 axes[3];			//unit length, right handed
+	glm::vec3 halfExtents;
+
+	OBB();
+	OBB(const AABB& local_bounds, const glm::mat4& to_world);
+
+	glm::vec3 getSupport(glm::vec3 direction) const;
+	AABB getBounds() const;
+};
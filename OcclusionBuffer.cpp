@@ -0,0 +1,284 @@
+#include "OcclusionBuffer.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <xmmintrin.h>
+
+OcclusionBuffer::OcclusionBuffer(int buffer_width, int buffer_height) {
+
+	tilesX = (buffer_width + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY = (buffer_height + TILE_SIZE - 1) / TILE_SIZE;
+	width = tilesX * TILE_SIZE;
+	height = tilesY * TILE_SIZE;
+	blocksX = width / BLOCK_SIZE;
+	blocksY = height / BLOCK_SIZE;
+
+	depth.assign(width * height, 1.0f);
+	blockDepth.assign(blocksX * blocksY, 1.0f);
+	tileBins.resize(tilesX * tilesY);
+
+	viewProjection = glm::mat4(1.0f);
+	numOccluderTriangles = 0;
+}
+
+void OcclusionBuffer::beginFrame(const glm::mat4& view_projection) {
+
+	viewProjection = view_projection;
+	triangles.clear();
+	for (unsigned int i = 0; i < tileBins.size(); ++i) {
+		tileBins[i].clear();
+	}
+	numOccluderTriangles = 0;
+}
+
+/*Triangles crossing the near plane are dropped rather than clipped, which can
+only let more through as visible. Facing is ignored so occluders work from
+either side*/
+void OcclusionBuffer::addOccluder(const std::vector<glm::vec3>& triangle_vertices, const glm::mat4& to_world) {
+
+	glm::mat4 toClip = viewProjection * to_world;
+
+	for (unsigned int i = 0; i + 2 < triangle_vertices.size(); i += 3) {
+
+		glm::vec4 clip[3];
+		bool behindNear = false;
+		for (int v = 0; v < 3; ++v) {
+			clip[v] = toClip * glm::vec4(triangle_vertices[i + v], 1.0f);
+			behindNear = behindNear || clip[v].z < -clip[v].w || clip[v].w <= 0.0f;
+		}
+		if (behindNear) {
+			continue;
+		}
+
+		//all three outside the same side of the view
+		bool offScreen = false;
+		for (int axis = 0; axis < 2 && !offScreen; ++axis) {
+			offScreen = (clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w)
+				|| (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w);
+		}
+		if (offScreen || (clip[0].z > clip[0].w && clip[1].z > clip[1].w && clip[2].z > clip[2].w)) {
+			continue;
+		}
+
+		//to pixels, depth in [0, 1] with 0 at the near plane
+		glm::vec3 screen[3];
+		for (int v = 0; v < 3; ++v) {
+			float inverseW = 1.0f / clip[v].w;
+			screen[v] = glm::vec3((clip[v].x * inverseW * 0.5f + 0.5f) * width,
+				(clip[v].y * inverseW * 0.5f + 0.5f) * height,
+				clip[v].z * inverseW * 0.5f + 0.5f);
+		}
+
+		float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+		if (std::fabs(area) < 1e-8f) {
+			continue;
+		}
+		if (area < 0.0f) {
+			std::swap(screen[1], screen[2]);
+			area = -area;
+		}
+
+		//depth varies linearly across the screen after the divide
+		ScreenTriangle triangle;
+		triangle.v0 = glm::vec2(screen[0].x, screen[0].y);
+		triangle.v1 = glm::vec2(screen[1].x, screen[1].y);
+		triangle.v2 = glm::vec2(screen[2].x, screen[2].y);
+		triangle.depthDx = ((screen[1].z - screen[0].z) * (screen[2].y - screen[0].y) - (screen[2].z - screen[0].z) * (screen[1].y - screen[0].y)) / area;
+		triangle.depthDy = ((screen[2].z - screen[0].z) * (screen[1].x - screen[0].x) - (screen[1].z - screen[0].z) * (screen[2].x - screen[0].x)) / area;
+		triangle.depth0 = screen[0].z - triangle.depthDx * screen[0].x - triangle.depthDy * screen[0].y;
+
+		//bin into every tile the bounding rectangle touches
+		float minX = glm::min(screen[0].x, glm::min(screen[1].x, screen[2].x));
+		float maxX = glm::max(screen[0].x, glm::max(screen[1].x, screen[2].x));
+		float minY = glm::min(screen[0].y, glm::min(screen[1].y, screen[2].y));
+		float maxY = glm::max(screen[0].y, glm::max(screen[1].y, screen[2].y));
+		int firstTileX = glm::max(0, (int)std::floor(minX) / TILE_SIZE);
+		int lastTileX = glm::min(tilesX - 1, (int)std::floor(maxX) / TILE_SIZE);
+		int firstTileY = glm::max(0, (int)std::floor(minY) / TILE_SIZE);
+		int lastTileY = glm::min(tilesY - 1, (int)std::floor(maxY) / TILE_SIZE);
+		if (firstTileX > lastTileX || firstTileY > lastTileY) {
+			continue;
+		}
+
+		unsigned int index = triangles.size();
+		triangles.push_back(triangle);
+		for (int tileY = firstTileY; tileY <= lastTileY; ++tileY) {
+			for (int tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+				tileBins[tileY * tilesX + tileX].push_back(index);
+			}
+		}
+		++numOccluderTriangles;
+	}
+}
+
+void OcclusionBuffer::rasterize() {
+	JobSystem::parallelFor(tilesX * tilesY, 1, [this](unsigned int begin, unsigned int end) {
+		for (unsigned int tile = begin; tile < end; ++tile) {
+			rasterizeTile(tile);
+		}
+	});
+}
+
+/*Conservative on both sides: any box corner behind the near plane or any covered
+pixel at or behind the box's nearest depth counts as visible. Blocks are tried
+first so most hidden boxes never touch individual pixels*/
+bool OcclusionBuffer::isVisible(const AABB& bounds) const {
+
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float nearestDepth = FLT_MAX;
+	for (int corner = 0; corner < 8; ++corner) {
+
+		glm::vec3 point((corner & 1) ? bounds.highest.x : bounds.lowest.x,
+			(corner & 2) ? bounds.highest.y : bounds.lowest.y,
+			(corner & 4) ? bounds.highest.z : bounds.lowest.z);
+		glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+		if (clip.z < -clip.w || clip.w <= 0.0f) {
+			return true;
+		}
+
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+		float y = (clip.y * inverseW * 0.5f + 0.5f) * height;
+		minX = glm::min(minX, x);
+		maxX = glm::max(maxX, x);
+		minY = glm::min(minY, y);
+		maxY = glm::max(maxY, y);
+		nearestDepth = glm::min(nearestDepth, clip.z * inverseW * 0.5f + 0.5f);
+	}
+
+	//every pixel the projected box touches
+	int firstX = glm::max(0, (int)std::floor(minX));
+	int lastX = glm::min(width - 1, (int)std::floor(maxX));
+	int firstY = glm::max(0, (int)std::floor(minY));
+	int lastY = glm::min(height - 1, (int)std::floor(maxY));
+	if (firstX > lastX || firstY > lastY) {
+		return true;	//off screen, the frustum test owns this case
+	}
+
+	for (int blockY = firstY / BLOCK_SIZE; blockY <= lastY / BLOCK_SIZE; ++blockY) {
+		for (int blockX = firstX / BLOCK_SIZE; blockX <= lastX / BLOCK_SIZE; ++blockX) {
+
+			if (blockDepth[blockY * blocksX + blockX] < nearestDepth) {
+				continue;
+			}
+
+			//block is not hidden as a whole, check the pixels the box actually covers
+			int startX = glm::max(firstX, blockX * BLOCK_SIZE), endX = glm::min(lastX, blockX * BLOCK_SIZE + BLOCK_SIZE - 1);
+			int startY = glm::max(firstY, blockY * BLOCK_SIZE), endY = glm::min(lastY, blockY * BLOCK_SIZE + BLOCK_SIZE - 1);
+			for (int y = startY; y <= endY; ++y) {
+				for (int x = startX; x <= endX; ++x) {
+					if (depth[y * width + x] >= nearestDepth) {
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+
+int OcclusionBuffer::getWidth() const {
+	return width;
+}
+int OcclusionBuffer::getHeight() const {
+	return height;
+}
+float OcclusionBuffer::getDepth(int x, int y) const {
+	return depth[y * width + x];
+}
+unsigned int OcclusionBuffer::getNumOccluderTriangles() const {
+	return numOccluderTriangles;
+}
+
+
+//PRIVATE HELPERS
+
+/*Edge functions are evaluated at pixel centers for four horizontally adjacent
+pixels per step. A pixel is covered when all three are non negative*/
+void OcclusionBuffer::rasterizeTile(int tile) {
+
+	int tileX = (tile % tilesX) * TILE_SIZE;
+	int tileY = (tile / tilesX) * TILE_SIZE;
+
+	for (int y = tileY; y < tileY + TILE_SIZE; ++y) {
+		std::fill(depth.begin() + y * width + tileX, depth.begin() + y * width + tileX + TILE_SIZE, 1.0f);
+	}
+
+	const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	const std::vector<unsigned int>& bin = tileBins[tile];
+	for (unsigned int i = 0; i < bin.size(); ++i) {
+
+		const ScreenTriangle& triangle = triangles[bin[i]];
+
+		//triangle bounds inside this tile, x snapped to groups of four
+		int minX = glm::max(tileX, (int)std::floor(glm::min(triangle.v0.x, glm::min(triangle.v1.x, triangle.v2.x))));
+		int maxX = glm::min(tileX + TILE_SIZE - 1, (int)std::floor(glm::max(triangle.v0.x, glm::max(triangle.v1.x, triangle.v2.x))));
+		int minY = glm::max(tileY, (int)std::floor(glm::min(triangle.v0.y, glm::min(triangle.v1.y, triangle.v2.y))));
+		int maxY = glm::min(tileY + TILE_SIZE - 1, (int)std::floor(glm::max(triangle.v0.y, glm::max(triangle.v1.y, triangle.v2.y))));
+		minX &= ~3;
+		if (minX > maxX || minY > maxY) {
+			continue;
+		}
+
+		//edge i is positive on the inside, as a * x + b * y + c
+		glm::vec2 from[3] = { triangle.v1, triangle.v2, triangle.v0 };
+		glm::vec2 to[3] = { triangle.v2, triangle.v0, triangle.v1 };
+		__m128 edgeA[3], edgeB[3], edgeC[3];
+		for (int e = 0; e < 3; ++e) {
+			float a = from[e].y - to[e].y;
+			float b = to[e].x - from[e].x;
+			float c = from[e].x * to[e].y - from[e].y * to[e].x;
+			edgeA[e] = _mm_set1_ps(a);
+			edgeB[e] = _mm_set1_ps(b);
+			edgeC[e] = _mm_set1_ps(c);
+		}
+		__m128 depthDx = _mm_set1_ps(triangle.depthDx);
+		__m128 depthDy = _mm_set1_ps(triangle.depthDy);
+		__m128 depth0 = _mm_set1_ps(triangle.depth0);
+
+		for (int y = minY; y <= maxY; ++y) {
+
+			__m128 pixelY = _mm_set1_ps(y + 0.5f);
+			float* row = &depth[y * width];
+
+			for (int x = minX; x <= maxX; x += 4) {
+
+				__m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (int e = 0; e < 3; ++e) {
+					__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[e], pixelX), _mm_mul_ps(edgeB[e], pixelY)), edgeC[e]);
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+				}
+				if (_mm_movemask_ps(inside) == 0) {
+					continue;
+				}
+
+				__m128 pixelDepth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(depthDx, pixelX), _mm_mul_ps(depthDy, pixelY)), depth0);
+				__m128 stored = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_min_ps(stored, pixelDepth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored)));
+			}
+		}
+	}
+
+	//farthest depth of each block in the tile
+	for (int blockY = tileY / BLOCK_SIZE; blockY < (tileY + TILE_SIZE) / BLOCK_SIZE; ++blockY) {
+		for (int blockX = tileX / BLOCK_SIZE; blockX < (tileX + TILE_SIZE) / BLOCK_SIZE; ++blockX) {
+
+			__m128 farthest = zero;
+			for (int y = blockY * BLOCK_SIZE; y < (blockY + 1) * BLOCK_SIZE; ++y) {
+				for (int x = blockX * BLOCK_SIZE; x < (blockX + 1) * BLOCK_SIZE; x += 4) {
+					farthest = _mm_max_ps(farthest, _mm_loadu_ps(&depth[y * width + x]));
+				}
+			}
+
+			float lanes[4];
+			_mm_storeu_ps(lanes, farthest);
+			blockDepth[blockY * blocksX + blockX] = glm::max(glm::max(lanes[0], lanes[1]), glm::max(lanes[2], lanes[3]));
+		}
+	}
+}
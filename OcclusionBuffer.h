@@ -0,0 +1,56 @@
+#pragma once
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "AABB.h"
+
+/*Low resolution CPU depth buffer for occlusion culling. Occluder triangles are
+projected and binned into screen tiles, tiles are rasterized on the job system
+four pixels at a time with SSE, and every tile then writes a hierarchical level
+holding the farthest depth of each block. A box is hidden when its nearest
+point lies behind every pixel it covers. Pure CPU, no GL calls*/
+class OcclusionBuffer {
+
+public:
+	const static int TILE_SIZE = 32;	//pixels, one job each
+	const static int BLOCK_SIZE = 8;	//pixels per hierarchical depth entry
+
+private:
+
+	struct ScreenTriangle {
+		glm::vec2 v0, v1, v2;			//pixel coordinates, counter clockwise
+		float depth0, depthDx, depthDy;	//depth plane, depth0 at pixel (0, 0)
+	};
+
+	int width, height;
+	int tilesX, tilesY;
+	int blocksX, blocksY;
+
+	glm::mat4 viewProjection;
+
+	std::vector<float> depth;			//nearest occluder depth per pixel, 1 is empty
+	std::vector<float> blockDepth;		//farthest depth per block
+	std::vector<ScreenTriangle> triangles;
+	std::vector<std::vector<unsigned int> > tileBins;
+
+	unsigned int numOccluderTriangles;
+
+public:
+
+	//width and height are rounded up to whole tiles
+	OcclusionBuffer(int buffer_width = 256, int buffer_height = 128);
+
+	void beginFrame(const glm::mat4& view_projection);
+	void addOccluder(const std::vector<glm::vec3>& triangle_vertices, const glm::mat4& to_world);
+	void rasterize();
+
+	bool isVisible(const AABB& bounds) const;
+
+	int getWidth() const;
+	int getHeight() const;
+	float getDepth(int x, int y) const;
+	unsigned int getNumOccluderTriangles() const;
+
+private:
+	void rasterizeTile(int tile);
+};
@@ -0,0 +1,218 @@
+#include "OcclusionQueryManager.h"
+#include "ShadowMap.h"
+#include "Camera.h"
+#include "GLState.h"
+
+GLuint OcclusionQueryManager::proxyVAO = 0;
+GLuint OcclusionQueryManager::proxyVBO = 0;
+
+//manage statics
+void OcclusionQueryManager::initStatics() {
+
+	//unit cube from -1 to 1, scaled onto each object's bounds when drawn
+	glm::vec3 corners[8];
+	for (int i = 0; i < 8; ++i) {
+		corners[i] = glm::vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+	}
+	const int faces[36] = {
+		0, 2, 1,  1, 2, 3,		//-z
+		4, 5, 6,  5, 7, 6,		//+z
+		0, 1, 4,  1, 5, 4,		//-y
+		2, 6, 3,  3, 6, 7,		//+y
+		0, 4, 2,  2, 4, 6,		//-x
+		1, 3, 5,  3, 7, 5		//+x
+	};
+	glm::vec3 vertices[36];
+	for (int i = 0; i < 36; ++i) {
+		vertices[i] = corners[faces[i]];
+	}
+
+	glGenVertexArrays(1, &proxyVAO);
+	glGenBuffers(1, &proxyVBO);
+	GLState::bindVertexArray(proxyVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, proxyVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::bindVertexArray(0);
+}
+void OcclusionQueryManager::cleanUpStatics() {
+	GLState::deleteVertexArrays(1, &proxyVAO);
+	glDeleteBuffers(1, &proxyVBO);
+}
+
+OcclusionQueryManager::OcclusionQueryManager() {
+	frame = 0;
+	queryOpen = false;
+	conditionalOpen = false;
+	beginFrame();
+}
+
+void OcclusionQueryManager::dispose() {
+	for (std::unordered_map<SceneObject*, Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+		glDeleteQueries(QUERY_LATENCY, it->second.queries);
+	}
+	entries.clear();
+}
+void OcclusionQueryManager::remove(SceneObject* object) {
+	std::unordered_map<SceneObject*, Entry>::iterator found = entries.find(object);
+	if (found != entries.end()) {
+		glDeleteQueries(QUERY_LATENCY, found->second.queries);
+		entries.erase(found);
+	}
+}
+
+void OcclusionQueryManager::beginFrame() {
+	++frame;
+	stats.queriesIssued = 0;
+	stats.resultsRead = 0;
+	stats.proxiesDrawn = 0;
+	stats.conditionalDraws = 0;
+}
+
+void OcclusionQueryManager::beginDraw(SceneObject* object, const AABB& bounds, Camera* camera) {
+
+	std::unordered_map<SceneObject*, Entry>::iterator found = entries.find(object);
+	if (found == entries.end()) {
+
+		//assume visible until the first result says otherwise
+		Entry entry;
+		glGenQueries(QUERY_LATENCY, entry.queries);
+		for (int i = 0; i < QUERY_LATENCY; ++i) {
+			entry.issuedFrame[i] = 0;
+			entry.pending[i] = false;
+		}
+		entry.newest = -1;
+		entry.visible = true;
+		entry.lastIssuedFrame = 0;
+		found = entries.insert(std::make_pair(object, entry)).first;
+	}
+	Entry& entry = found->second;
+
+	collectResults(entry);
+
+	//a proxy the near plane cuts through would report hidden, the camera is inside anyway
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(camera->getViewMatrix())[3]);
+	AABB nearBounds = bounds;
+	nearBounds.lowest -= glm::vec3(1.0f);
+	nearBounds.highest += glm::vec3(1.0f);
+	if (nearBounds.contains(AABB(cameraPosition, cameraPosition))) {
+		entry.visible = true;
+	}
+
+	int freeQuery = findFreeQuery(entry);
+
+	if (entry.visible) {
+
+		//count the real draw's samples, no proxy needed
+		if (freeQuery >= 0 && frame - entry.lastIssuedFrame >= VISIBLE_REQUERY_INTERVAL) {
+			glBeginQuery(GL_ANY_SAMPLES_PASSED, entry.queries[freeQuery]);
+			entry.pending[freeQuery] = true;
+			entry.issuedFrame[freeQuery] = frame;
+			entry.newest = freeQuery;
+			entry.lastIssuedFrame = frame;
+			queryOpen = true;
+			++stats.queriesIssued;
+		}
+		return;
+	}
+
+	if (freeQuery >= 0) {
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, entry.queries[freeQuery]);
+		drawProxy(bounds, camera);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+		entry.pending[freeQuery] = true;
+		entry.issuedFrame[freeQuery] = frame;
+		entry.newest = freeQuery;
+		entry.lastIssuedFrame = frame;
+		++stats.queriesIssued;
+		++stats.proxiesDrawn;
+	}
+
+	//with every query in flight the newest one still says something about this frame
+	if (entry.newest >= 0) {
+		glBeginConditionalRender(entry.queries[entry.newest], GL_QUERY_NO_WAIT);
+		conditionalOpen = true;
+		++stats.conditionalDraws;
+	}
+}
+
+void OcclusionQueryManager::endDraw() {
+
+	if (queryOpen) {
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+		queryOpen = false;
+	}
+	if (conditionalOpen) {
+		glEndConditionalRender();
+		conditionalOpen = false;
+	}
+}
+
+OcclusionQueryManager::Stats OcclusionQueryManager::getStats() {
+	return stats;
+}
+
+
+//PRIVATE HELPERS
+
+//only reads results the driver already has, oldest first so the newest one wins
+void OcclusionQueryManager::collectResults(Entry& entry) {
+
+	while (true) {
+
+		int oldest = -1;
+		for (int i = 0; i < QUERY_LATENCY; ++i) {
+			if (entry.pending[i] && (oldest < 0 || entry.issuedFrame[i] < entry.issuedFrame[oldest]))
+				oldest = i;
+		}
+		if (oldest < 0) {
+			return;
+		}
+
+		GLuint available = 0;
+		glGetQueryObjectuiv(entry.queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			return;
+		}
+
+		GLuint anySamples = 0;
+		glGetQueryObjectuiv(entry.queries[oldest], GL_QUERY_RESULT, &anySamples);
+		entry.visible = anySamples != 0;
+		entry.pending[oldest] = false;
+		++stats.resultsRead;
+	}
+}
+
+int OcclusionQueryManager::findFreeQuery(const Entry& entry) {
+	for (int i = 0; i < QUERY_LATENCY; ++i) {
+		if (!entry.pending[i])
+			return i;
+	}
+	return -1;
+}
+
+//bounding box through the shadow program with camera matrices, depth tested but never written
+void OcclusionQueryManager::drawProxy(const AABB& bounds, Camera* camera) {
+
+	GLuint program = ShadowMap::getShaderProgram();
+	GLState::useProgram(program);
+
+	glm::mat4 projection = camera->getProjectionMatrix();
+	glm::mat4 view = camera->getViewMatrix();
+	glm::mat4 boxToWorld = glm::scale(glm::translate(glm::mat4(1.0f), bounds.getCenter()), bounds.getExtents());
+	ShadowMap::applyMatrices(projection, view);
+	ShadowMap::applyToWorld(boxToWorld);
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	GLState::depthMask(GL_FALSE);
+
+	GLState::bindVertexArray(proxyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 36);
+	GLState::bindVertexArray(0);
+
+	GLState::depthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
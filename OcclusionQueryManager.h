@@ -0,0 +1,78 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <unordered_map>
+#include "AABB.h"
+
+class SceneObject;
+class Camera;
+
+/*Hardware occlusion queries with temporal coherence. Each object keeps a small
+ring of queries so results can arrive a few frames late, they are only read once
+the driver reports them available. Objects visible last frame draw normally with
+a query around the real draw. Objects that were hidden draw their bounding box
+with color and depth writes off inside a query, and the real draw is made
+conditional on it so the GPU drops it without the CPU ever waiting*/
+class OcclusionQueryManager {
+
+public:
+
+	//queries in flight per object before a new one has to wait for a result
+	const static int QUERY_LATENCY = 3;
+
+	//visible objects are only requeried this often, hidden ones every frame
+	const static unsigned int VISIBLE_REQUERY_INTERVAL = 4;
+
+	struct Stats {
+		unsigned int queriesIssued;
+		unsigned int resultsRead;
+		unsigned int proxiesDrawn;
+		unsigned int conditionalDraws;		//draws the GPU may skip
+	};
+
+private:
+
+	struct Entry {
+		GLuint queries[QUERY_LATENCY];
+		unsigned int issuedFrame[QUERY_LATENCY];
+		bool pending[QUERY_LATENCY];
+		int newest;						//most recently issued query, -1 before the first
+		bool visible;					//from the latest result read back
+		unsigned int lastIssuedFrame;
+	};
+
+	static GLuint proxyVAO, proxyVBO;
+
+	std::unordered_map<SceneObject*, Entry> entries;
+	unsigned int frame;
+	Stats stats;
+
+	//what endDraw has to close
+	bool queryOpen;
+	bool conditionalOpen;
+
+public:
+
+	//manage statics
+	static void initStatics();
+	static void cleanUpStatics();
+
+	OcclusionQueryManager();
+	void dispose();
+
+	void beginFrame();
+	void beginDraw(SceneObject* object, const AABB& bounds, Camera* camera);
+	void endDraw();
+
+	//frees an object's queries once it leaves the scene
+	void remove(SceneObject* object);
+
+	Stats getStats();
+
+private:
+	void collectResults(Entry& entry);
+	int findFreeQuery(const Entry& entry);
+	void drawProxy(const AABB& bounds, Camera* camera);
+};
@@ -0,0 +1,95 @@
+#include "PipelineQuery.h"
+
+PipelineQuery::PipelineQuery() {
+	target = 0;
+	supported = false;
+	for (int i = 0; i < QUERY_LATENCY; ++i) {
+		queries[i] = 0;
+		pending[i] = false;
+	}
+	current = -1;
+	next = 0;
+	lastResult = 0;
+	hasResult = false;
+}
+
+void PipelineQuery::init(GLenum query_target, bool is_supported) {
+
+	target = query_target;
+	supported = is_supported;
+	if (supported) {
+		glGenQueries(QUERY_LATENCY, queries);
+	}
+}
+
+void PipelineQuery::dispose() {
+
+	if (supported) {
+		glDeleteQueries(QUERY_LATENCY, queries);
+	}
+	for (int i = 0; i < QUERY_LATENCY; ++i) {
+		queries[i] = 0;
+		pending[i] = false;
+	}
+	supported = false;
+}
+
+/*reuses the oldest query in the ring. If its result still hasn't arrived this
+frame goes unmeasured rather than stalling*/
+void PipelineQuery::begin() {
+
+	if (!supported || current != -1) {
+		return;
+	}
+	if (pending[next]) {
+		collectResult(next);
+		if (pending[next]) {
+			return;
+		}
+	}
+	current = next;
+	next = (next + 1) % QUERY_LATENCY;
+	glBeginQuery(target, queries[current]);
+}
+
+void PipelineQuery::end() {
+
+	if (current == -1) {
+		return;
+	}
+	glEndQuery(target);
+	pending[current] = true;
+	current = -1;
+}
+
+bool PipelineQuery::isSupported() {
+	return supported;
+}
+
+//newest result that has arrived, false before the first one
+bool PipelineQuery::getResult(GLuint64& result) {
+
+	//results may be ready before their query comes around again
+	for (int i = 0; i < QUERY_LATENCY; ++i) {
+		int query = (next + i) % QUERY_LATENCY;
+		if (pending[query]) {
+			collectResult(query);
+		}
+	}
+	result = lastResult;
+	return hasResult;
+}
+
+//PRIVATE HELPERS
+
+void PipelineQuery::collectResult(int query) {
+
+	GLuint available = 0;
+	glGetQueryObjectuiv(queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		return;
+	}
+	glGetQueryObjectui64v(queries[query], GL_QUERY_RESULT, &lastResult);
+	pending[query] = false;
+	hasResult = true;
+}
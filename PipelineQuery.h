@@ -0,0 +1,41 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+/*A GPU counter read back a few frames late so the CPU never waits on it, e.g.
+fragment shader invocations or elapsed time around a pass. Each frame's
+begin/end uses the next query in a ring, and a result is only read once the
+driver reports it available*/
+class PipelineQuery {
+
+public:
+	const static int QUERY_LATENCY = 3;
+
+private:
+
+	GLenum target;
+	bool supported;
+	GLuint queries[QUERY_LATENCY];
+	bool pending[QUERY_LATENCY];
+	int current;			//query begun this frame, -1 when none is open
+	int next;
+	GLuint64 lastResult;
+	bool hasResult;
+
+public:
+
+	PipelineQuery();
+
+	//supported is false when the target is missing, begin and end then do nothing
+	void init(GLenum query_target, bool is_supported);
+	void dispose();
+
+	void begin();
+	void end();
+
+	bool isSupported();
+	bool getResult(GLuint64& result);
+
+private:
+	void collectResult(int query);
+};
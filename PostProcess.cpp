@@ -0,0 +1,257 @@
+#include "PostProcess.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "GLState.h"
+#include "shader.h"
+
+//spread of the camera's blur as a fraction of the screen, per unit of blur radius
+static const float SIGMA_PER_RADIUS = 0.0118f;
+
+PostProcess::PostProcess() {
+	width = height = 0;
+	method = FRAGMENT_BLUR;
+	for (int i = 0; i < MAX_LEVELS; ++i) {
+		levelWidths[i] = levelHeights[i] = 0;
+		levelFrameBuffers[i] = 0;
+		scratchFrameBuffers[i] = 0;
+	}
+	blurProgram = 0;
+	computeProgram = 0;
+	skipped = true;
+	lastLevel = 0;
+}
+
+void PostProcess::init() {
+
+	blurProgram = LoadShaders("../shader_blur.vert", "../shader_blur.frag");
+	if (GLEW_VERSION_4_3) {
+		computeProgram = LoadComputeShader("../shader_blur.comp");
+	}
+	for (int i = 0; i < NUM_PASSES; ++i) {
+		passTimes[i].init(GL_TIME_ELAPSED, true);
+	}
+}
+
+//levels follow the window, recreated on every resize like the frame texture
+void PostProcess::resize(int window_width, int window_height) {
+
+	deleteLevels();
+	width = window_width;
+	height = window_height;
+
+	for (int i = 0; i < MAX_LEVELS; ++i) {
+
+		levelWidths[i] = std::max(width >> (i + 1), 1);
+		levelHeights[i] = std::max(height >> (i + 1), 1);
+
+		//the blur writes both as images, so they need a sized format images accept
+		Texture* textures[2] = { &levelTextures[i], &scratchTextures[i] };
+		GLuint* frameBuffers[2] = { &levelFrameBuffers[i], &scratchFrameBuffers[i] };
+		for (int j = 0; j < 2; ++j) {
+			textures[j]->generatePlainTexture();
+			GLState::bindTexture(GL_TEXTURE_2D, textures[j]->getID());
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, levelWidths[i], levelHeights[i], 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+			glGenFramebuffers(1, frameBuffers[j]);
+			glBindFramebuffer(GL_FRAMEBUFFER, *frameBuffers[j]);
+			glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textures[j]->getID(), 0);
+
+			//Validate FBO
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+				std::cerr << "Post process level's status reported incomplete" << std::endl;
+				exit(1);
+			}
+		}
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void PostProcess::dispose() {
+
+	deleteLevels();
+	GLState::deleteProgram(blurProgram);
+	blurProgram = 0;
+	if (computeProgram != 0) {
+		GLState::deleteProgram(computeProgram);
+		computeProgram = 0;
+	}
+	for (int i = 0; i < NUM_PASSES; ++i) {
+		passTimes[i].dispose();
+	}
+}
+
+/*leaves the window's frame buffer bound. A blur is found as a Gaussian's sigma,
+and every halving halves it in texels, so the level is the first one where it
+fits in MAX_SIGMA*/
+void PostProcess::apply(GLuint source_frame_buffer, float blur_radius, GLuint screen_quad) {
+
+	skipped = blur_radius <= 0;
+	if (skipped) {
+		passTimes[UPSAMPLE_PASS].begin();
+		blit(source_frame_buffer, width, height, 0, width, height, GL_NEAREST);
+		passTimes[UPSAMPLE_PASS].end();
+		return;
+	}
+
+	float sigma = blur_radius * SIGMA_PER_RADIUS;
+	int level = 0;
+	while (level < MAX_LEVELS - 1 && sigma * std::max(levelWidths[level], levelHeights[level]) > MAX_SIGMA) {
+		++level;
+	}
+	lastLevel = level + 1;
+
+	//linear blits at exactly half size average each 2x2 block
+	passTimes[DOWNSAMPLE_PASS].begin();
+	blit(source_frame_buffer, width, height, levelFrameBuffers[0], levelWidths[0], levelHeights[0], GL_LINEAR);
+	for (int i = 1; i <= level; ++i) {
+		blit(levelFrameBuffers[i - 1], levelWidths[i - 1], levelHeights[i - 1], levelFrameBuffers[i], levelWidths[i], levelHeights[i], GL_LINEAR);
+	}
+	passTimes[DOWNSAMPLE_PASS].end();
+
+	//the old blur was round in screen space, so it is wider in texels across than down
+	passTimes[BLUR_PASS].begin();
+	if (method == COMPUTE_BLUR && computeProgram != 0) {
+		blurCompute(level, sigma * levelWidths[level], sigma * levelHeights[level]);
+	}
+	else {
+		blurFragment(level, sigma * levelWidths[level], sigma * levelHeights[level], screen_quad);
+	}
+	passTimes[BLUR_PASS].end();
+
+	//a level at a time, each bilinear step smoothing the last
+	passTimes[UPSAMPLE_PASS].begin();
+	for (int i = level; i > 0; --i) {
+		blit(levelFrameBuffers[i], levelWidths[i], levelHeights[i], levelFrameBuffers[i - 1], levelWidths[i - 1], levelHeights[i - 1], GL_LINEAR);
+	}
+	blit(levelFrameBuffers[0], levelWidths[0], levelHeights[0], 0, width, height, GL_LINEAR);
+	passTimes[UPSAMPLE_PASS].end();
+}
+
+void PostProcess::setMethod(int blur_method) {
+	method = blur_method;
+}
+int PostProcess::getMethod() {
+	return method;
+}
+bool PostProcess::supportsCompute() {
+	return computeProgram != 0;
+}
+
+//the newest pass times that have arrived, of whichever frames they came from
+PostProcess::Stats PostProcess::getStats() {
+
+	Stats stats;
+	stats.available = true;
+	stats.skipped = skipped;
+	stats.level = skipped ? 0 : lastLevel;
+	for (int i = 0; i < NUM_PASSES; ++i) {
+		stats.passNanoseconds[i] = 0;
+
+		//a copy only times the last pass, the others would be from an older blur
+		if (skipped && i != UPSAMPLE_PASS)
+			continue;
+		if (!passTimes[i].getResult(stats.passNanoseconds[i])) {
+			stats.available = false;
+		}
+	}
+	return stats;
+}
+
+//PRIVATE HELPERS
+
+void PostProcess::deleteLevels() {
+
+	for (int i = 0; i < MAX_LEVELS; ++i) {
+		levelTextures[i].disposeCurrentTexture();
+		scratchTextures[i].disposeCurrentTexture();
+		if (levelFrameBuffers[i] != 0) {
+			glDeleteFramebuffers(1, &levelFrameBuffers[i]);
+			levelFrameBuffers[i] = 0;
+		}
+		if (scratchFrameBuffers[i] != 0) {
+			glDeleteFramebuffers(1, &scratchFrameBuffers[i]);
+			scratchFrameBuffers[i] = 0;
+		}
+	}
+}
+
+//across into the scratch texture, then down back into the level
+void PostProcess::blurFragment(int level, float sigma_x, float sigma_y, GLuint screen_quad) {
+
+	GLState::useProgram(blurProgram);
+	glUniform1i(glGetUniformLocation(blurProgram, "source"), 0);
+	GLState::activeTexture(GL_TEXTURE0);
+
+	//every pixel is covered once, depth is not needed
+	GLState::disable(GL_DEPTH_TEST);
+	glViewport(0, 0, levelWidths[level], levelHeights[level]);
+	GLState::bindVertexArray(screen_quad);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, scratchFrameBuffers[level]);
+	GLState::bindTexture(GL_TEXTURE_2D, levelTextures[level].getID());
+	glUniform2f(glGetUniformLocation(blurProgram, "texelStep"), 1.0f / levelWidths[level], 0);
+	glUniform1f(glGetUniformLocation(blurProgram, "sigma"), sigma_x);
+	glUniform1i(glGetUniformLocation(blurProgram, "radius"), getRadius(sigma_x));
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, levelFrameBuffers[level]);
+	GLState::bindTexture(GL_TEXTURE_2D, scratchTextures[level].getID());
+	glUniform2f(glGetUniformLocation(blurProgram, "texelStep"), 0, 1.0f / levelHeights[level]);
+	glUniform1f(glGetUniformLocation(blurProgram, "sigma"), sigma_y);
+	glUniform1i(glGetUniformLocation(blurProgram, "radius"), getRadius(sigma_y));
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+	GLState::bindVertexArray(0);
+	GLState::enable(GL_DEPTH_TEST);
+	glViewport(0, 0, width, height);
+}
+
+/*same two passes as work groups of TILE_SIZE pixels along a row, then a column.
+Each group reads its tile and apron once into shared memory*/
+void PostProcess::blurCompute(int level, float sigma_x, float sigma_y) {
+
+	int levelWidth = levelWidths[level];
+	int levelHeight = levelHeights[level];
+
+	GLState::useProgram(computeProgram);
+	glUniform1i(glGetUniformLocation(computeProgram, "source"), 0);
+	GLState::activeTexture(GL_TEXTURE0);
+
+	GLState::bindTexture(GL_TEXTURE_2D, levelTextures[level].getID());
+	glBindImageTexture(0, scratchTextures[level].getID(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	glUniform2i(glGetUniformLocation(computeProgram, "direction"), 1, 0);
+	glUniform1f(glGetUniformLocation(computeProgram, "sigma"), sigma_x);
+	glUniform1i(glGetUniformLocation(computeProgram, "radius"), getRadius(sigma_x));
+	glDispatchCompute((levelWidth + TILE_SIZE - 1) / TILE_SIZE, levelHeight, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	GLState::bindTexture(GL_TEXTURE_2D, scratchTextures[level].getID());
+	glBindImageTexture(0, levelTextures[level].getID(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	glUniform2i(glGetUniformLocation(computeProgram, "direction"), 0, 1);
+	glUniform1f(glGetUniformLocation(computeProgram, "sigma"), sigma_y);
+	glUniform1i(glGetUniformLocation(computeProgram, "radius"), getRadius(sigma_y));
+	glDispatchCompute((levelHeight + TILE_SIZE - 1) / TILE_SIZE, levelWidth, 1);
+
+	//the upsample blits read the result through the frame buffer
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+}
+
+//three sigmas either side hold nearly all of the Gaussian
+int PostProcess::getRadius(float sigma) {
+	int radius = (int)std::ceil(3.0f * sigma);
+	return radius < 1 ? 1 : (radius > MAX_RADIUS ? MAX_RADIUS : radius);
+}
+
+void PostProcess::blit(GLuint from, int from_width, int from_height, GLuint to, int to_width, int to_height, GLenum filter) {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, from);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, to);
+	glBlitFramebuffer(0, 0, from_width, from_height, 0, 0, to_width, to_height, GL_COLOR_BUFFER_BIT, filter);
+	glBindFramebuffer(GL_FRAMEBUFFER, to);
+}
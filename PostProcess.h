@@ -0,0 +1,85 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Texture.h"
+#include "PipelineQuery.h"
+
+/*Camera blur between the frame texture and the window. Without blur the frame is
+copied straight across. Otherwise it is halved with linear blits until the
+Gaussian is at most MAX_SIGMA texels wide at that level, blurred there by two
+separable passes ping-ponging between a pair of textures, then blitted back up a
+level at a time into the window. The blur passes are either fragment shaders on
+a screen quad or compute shaders that read each tile and its apron into shared
+memory once. Every stage is timed with GPU timer queries*/
+class PostProcess {
+
+public:
+
+	enum Methods { FRAGMENT_BLUR, COMPUTE_BLUR };
+	enum Passes { DOWNSAMPLE_PASS, BLUR_PASS, UPSAMPLE_PASS, NUM_PASSES };
+
+	//halvings available, the last one blurs whatever sigma is left
+	const static int MAX_LEVELS = 6;
+
+	//widest Gaussian blurred at a level before moving down another, in texels
+	const static int MAX_SIGMA = 4;
+
+	//taps either side of the center, matches the shaders
+	const static int MAX_RADIUS = 12;
+
+	//pixels along a line per compute work group, matches shader_blur.comp
+	const static int TILE_SIZE = 128;
+
+	struct Stats {
+		bool available;					//false before timer results arrive
+		bool skipped;					//no blur, the frame was copied across
+		int level;						//halvings before the blur, 1 is half size
+		GLuint64 passNanoseconds[NUM_PASSES];
+	};
+
+private:
+
+	int width, height;
+	int method;
+
+	//level i is 1 / 2^(i + 1) of the window, the blur ping-pongs between both textures of one level
+	int levelWidths[MAX_LEVELS];
+	int levelHeights[MAX_LEVELS];
+	Texture levelTextures[MAX_LEVELS];
+	Texture scratchTextures[MAX_LEVELS];
+	GLuint levelFrameBuffers[MAX_LEVELS];
+	GLuint scratchFrameBuffers[MAX_LEVELS];
+
+	GLuint blurProgram;
+	GLuint computeProgram;		//0 without compute shaders
+
+	PipelineQuery passTimes[NUM_PASSES];
+	bool skipped;
+	int lastLevel;
+
+public:
+
+	PostProcess();
+
+	void init();
+	void resize(int window_width, int window_height);
+	void dispose();
+
+	//blur the color of source_frame_buffer into the window, blur_radius as the camera sets it
+	void apply(GLuint source_frame_buffer, float blur_radius, GLuint screen_quad);
+
+	void setMethod(int blur_method);
+	int getMethod();
+	bool supportsCompute();
+
+	Stats getStats();
+
+private:
+	void deleteLevels();
+	void blurFragment(int level, float sigma_x, float sigma_y, GLuint screen_quad);
+	void blurCompute(int level, float sigma_x, float sigma_y);
+	static int getRadius(float sigma);
+	static void blit(GLuint from, int from_width, int from_height, GLuint to, int to_width, int to_height, GLenum filter);
+};
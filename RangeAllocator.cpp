@@ -0,0 +1,85 @@
+#include "RangeAllocator.h"
+
+RangeAllocator::RangeAllocator() {
+	capacity = 0;
+	used = 0;
+}
+
+void RangeAllocator::init(unsigned int initial_capacity) {
+	capacity = initial_capacity;
+	used = 0;
+	freeRanges.clear();
+	Range whole = { 0, initial_capacity };
+	freeRanges.push_back(whole);
+}
+
+unsigned int RangeAllocator::allocate(unsigned int size) {
+
+	for (unsigned int i = 0; i < freeRanges.size(); ++i) {
+		if (freeRanges[i].size < size)
+			continue;
+
+		unsigned int offset = freeRanges[i].offset;
+		freeRanges[i].offset += size;
+		freeRanges[i].size -= size;
+		if (freeRanges[i].size == 0) {
+			freeRanges.erase(freeRanges.begin() + i);
+		}
+		used += size;
+		return offset;
+	}
+	return INVALID;
+}
+
+void RangeAllocator::free(unsigned int offset, unsigned int size) {
+
+	//first free range after the one being returned
+	unsigned int next = 0;
+	while (next < freeRanges.size() && freeRanges[next].offset < offset) {
+		++next;
+	}
+	used -= size;
+
+	bool joinsPrevious = next > 0 && freeRanges[next - 1].offset + freeRanges[next - 1].size == offset;
+	bool joinsNext = next < freeRanges.size() && offset + size == freeRanges[next].offset;
+
+	if (joinsPrevious && joinsNext) {
+		freeRanges[next - 1].size += size + freeRanges[next].size;
+		freeRanges.erase(freeRanges.begin() + next);
+	}
+	else if (joinsPrevious) {
+		freeRanges[next - 1].size += size;
+	}
+	else if (joinsNext) {
+		freeRanges[next].offset = offset;
+		freeRanges[next].size += size;
+	}
+	else {
+		Range range = { offset, size };
+		freeRanges.insert(freeRanges.begin() + next, range);
+	}
+}
+
+void RangeAllocator::grow(unsigned int new_capacity) {
+
+	if (new_capacity <= capacity)
+		return;
+
+	//the added space extends a free range ending at the old capacity, or starts a new one
+	unsigned int added = new_capacity - capacity;
+	if (!freeRanges.empty() && freeRanges.back().offset + freeRanges.back().size == capacity) {
+		freeRanges.back().size += added;
+	}
+	else {
+		Range range = { capacity, added };
+		freeRanges.push_back(range);
+	}
+	capacity = new_capacity;
+}
+
+unsigned int RangeAllocator::getCapacity() {
+	return capacity;
+}
+unsigned int RangeAllocator::getUsed() {
+	return used;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+
+/*Hands out ranges of a buffer of some capacity, in whatever unit the owner
+counts in (vertices, indices). Free space is a list of ranges sorted by offset,
+allocations take the first one large enough and frees merge with their
+neighbours, so meshes loaded and released in any order don't leave the
+buffer in splinters*/
+class RangeAllocator {
+
+	struct Range {
+		unsigned int offset;
+		unsigned int size;
+	};
+
+	unsigned int capacity;
+	unsigned int used;
+	std::vector<Range> freeRanges;
+
+public:
+
+	const static unsigned int INVALID = 0xffffffff;
+
+	RangeAllocator();
+
+	void init(unsigned int initial_capacity);
+
+	//offset of size free units, INVALID when no free range is large enough
+	unsigned int allocate(unsigned int size);
+	void free(unsigned int offset, unsigned int size);
+
+	//more room at the end, the owner has already grown its buffer to match
+	void grow(unsigned int new_capacity);
+
+	unsigned int getCapacity();
+	unsigned int getUsed();
+};
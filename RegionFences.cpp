@@ -0,0 +1,40 @@
+#include "RegionFences.h"
+
+RegionFences::RegionFences(int num_regions) {
+	fences.assign(num_regions, 0);
+}
+
+void RegionFences::fence(int region) {
+	if (fences[region] != 0) {
+		glDeleteSync(fences[region]);
+	}
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool RegionFences::wait(int region, float& wait_milliseconds) {
+
+	if (fences[region] == 0) {
+		return false;
+	}
+
+	//poll first so only real stalls are counted
+	bool stalled = glClientWaitSync(fences[region], 0, 0) == GL_TIMEOUT_EXPIRED;
+	if (stalled) {
+		double waitStart = glfwGetTime();
+		while (glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+		}
+		wait_milliseconds += (float)((glfwGetTime() - waitStart) * 1000.0);
+	}
+	glDeleteSync(fences[region]);
+	fences[region] = 0;
+	return stalled;
+}
+
+void RegionFences::clear() {
+	for (unsigned int i = 0; i < fences.size(); ++i) {
+		if (fences[i] != 0) {
+			glDeleteSync(fences[i]);
+			fences[i] = 0;
+		}
+	}
+}
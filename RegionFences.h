@@ -0,0 +1,25 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <vector>
+
+/*One fence per region of a buffer that is written round robin while the GPU
+reads the regions written before it. A region is fenced once the commands
+reading it have been issued, and waited on before it is written again*/
+class RegionFences {
+
+	std::vector<GLsync> fences;		//0 for regions with nothing in flight
+
+public:
+
+	RegionFences(int num_regions);
+
+	void fence(int region);
+
+	/*blocks until the GPU is done with the region. True if it was still in use,
+	then the time spent waiting is added to wait_milliseconds*/
+	bool wait(int region, float& wait_milliseconds);
+
+	//drops every fence without waiting, for buffers about to be deleted
+	void clear();
+};
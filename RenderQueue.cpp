@@ -0,0 +1,360 @@
+#include "RenderQueue.h"
+#include "Camera.h"
+#include "GLState.h"
+#include "Frustum.h"
+#include <algorithm>
+
+RenderQueue::RenderQueue() {
+	instancing = true;
+	indirect = false;
+	gpuCulling = false;
+	instanceBuffer = 0;
+	instanceBufferSize = 0;
+	instances.buffer = 0;
+	instances.offset = 0;
+	depthScale = 0;
+	stats.packets = 0;
+	stats.draws = 0;
+	stats.instancedDraws = 0;
+	stats.indirectDraws = 0;
+	stats.indirectCommands = 0;
+	stats.programSwitches = 0;
+	stats.materialSwitches = 0;
+	stats.textureSwitches = 0;
+	stats.meshSwitches = 0;
+}
+
+void RenderQueue::init() {
+	glGenBuffers(1, &instanceBuffer);
+	instanceBufferSize = 0;
+	indirectDrawer.init();
+}
+void RenderQueue::dispose() {
+	glDeleteBuffers(1, &instanceBuffer);
+	instanceBuffer = 0;
+	indirectDrawer.dispose();
+	packets.clear();
+}
+
+void RenderQueue::setInstancing(bool opt) {
+	instancing = opt;
+}
+bool RenderQueue::isInstancingEnabled() {
+	return instancing;
+}
+
+void RenderQueue::setIndirect(bool opt) {
+	indirect = opt;
+}
+bool RenderQueue::usesIndirect() {
+	return indirect && IndirectDrawer::isSupported();
+}
+void RenderQueue::setGPUCulling(bool opt) {
+	gpuCulling = opt;
+}
+bool RenderQueue::isGPUCullingEnabled() {
+	return gpuCulling;
+}
+
+void RenderQueue::beginFrame(Camera* camera) {
+
+	packets.clear();
+	sortEntries.clear();
+	programs.clear();
+	materials.clear();
+	view = camera->getViewMatrix();
+	depthScale = 1.0f / camera->getCameraFar();
+
+	stats.packets = 0;
+	stats.draws = 0;
+	stats.instancedDraws = 0;
+	stats.indirectDraws = 0;
+	stats.indirectCommands = 0;
+	stats.programSwitches = 0;
+	stats.materialSwitches = 0;
+	stats.textureSwitches = 0;
+	stats.meshSwitches = 0;
+}
+
+void RenderQueue::add(int pass, Mesh* mesh, Material* material, const glm::mat4& to_world) {
+
+	DrawPacket packet;
+	packet.mesh = mesh;
+	packet.material = material;
+	packet.toWorld = to_world;
+	packets.push_back(packet);
+
+	//front to back by the object's origin, opaque draws then fail the depth test early
+	float depth = -(view * to_world[3]).z * depthScale;
+	depth = depth < 0 ? 0 : (depth > 1 ? 1 : depth);
+	unsigned long long depthField = (unsigned long long)(depth * ((1 << DEPTH_BITS) - 1));
+
+	unsigned long long programField = getProgramID(Material::getShaderProgram());
+	unsigned long long materialField = getMaterialID(material);
+	unsigned long long meshField = mesh->getID() & ((1 << MESH_BITS) - 1);
+
+	SortEntry entry;
+	entry.key = ((unsigned long long)pass << (PROGRAM_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS))
+		| (programField << (MATERIAL_BITS + MESH_BITS + DEPTH_BITS))
+		| (materialField << (MESH_BITS + DEPTH_BITS))
+		| (meshField << DEPTH_BITS)
+		| depthField;
+	entry.packet = packets.size() - 1;
+	sortEntries.push_back(entry);
+	++stats.packets;
+}
+
+void RenderQueue::submit(Camera* camera, bool pre_passed) {
+
+	if (packets.empty())
+		return;
+
+	sortKeys();
+
+	bool drawIndirect = usesIndirect();
+	if (instancing || drawIndirect) {
+		uploadInstances();
+	}
+
+	//commands for the whole frame go up, and are culled, before the first draw
+	if (drawIndirect) {
+		buildCommands();
+		indirectDrawer.upload(gpuCulling);
+		if (gpuCulling) {
+			Frustum frustum;
+			frustum.update(camera->getProjectionMatrix() * camera->getViewMatrix());
+			indirectDrawer.cull(instances.buffer, instances.offset, sortEntries.size() * sizeof(glm::mat4), frustum);
+		}
+		MeshPool::setInstanceBuffer(instances.buffer, instances.offset);
+	}
+
+	//depth is already laid down by the pre-pass, only the visible surface passes EQUAL
+	if (pre_passed) {
+		GLState::depthFunc(GL_EQUAL);
+		GLState::depthMask(GL_FALSE);
+	}
+
+	const int materialShift = MESH_BITS + DEPTH_BITS;
+	const int programShift = MATERIAL_BITS + MESH_BITS + DEPTH_BITS;
+	const unsigned long long materialMask = (1 << MATERIAL_BITS) - 1;
+
+	unsigned long long lastProgramKey = ~0ULL;
+	unsigned long long lastMaterialKey = ~0ULL;
+	Material* lastMaterial = NULL;
+	Mesh* lastMesh = NULL;
+	GLint toWorldLocation = -1;
+	GLint instancedLocation = -1;
+	unsigned int run = 0;
+
+	unsigned int i = 0;
+	while (i < sortEntries.size()) {
+
+		unsigned long long key = sortEntries[i].key;
+		DrawPacket& packet = packets[sortEntries[i].packet];
+
+		//uniforms belong to the program, a new one needs the camera and material sent again
+		if ((key >> programShift) != lastProgramKey) {
+			GLuint program = programs[(key >> programShift) & ((1 << PROGRAM_BITS) - 1)];
+
+			//the flag stays set on a program left behind, the next draw through it would read per instance matrices
+			if (lastProgramKey != ~0ULL) {
+				glUniform1i(instancedLocation, 0);
+			}
+			GLState::useProgram(program);
+			camera->applySettings(program);
+			toWorldLocation = glGetUniformLocation(program, "toWorld");
+			instancedLocation = glGetUniformLocation(program, "instanced");
+			glUniform1i(instancedLocation, instancing || drawIndirect);
+			lastProgramKey = key >> programShift;
+			lastMaterialKey = ~0ULL;
+			++stats.programSwitches;
+		}
+
+		//materials past the id range share the last id and are told apart by their settings
+		unsigned long long materialKey = key >> materialShift;
+		bool overflowed = (materialKey & materialMask) == materialMask;
+		if (materialKey != lastMaterialKey || (overflowed && !packet.material->sameSettings(*lastMaterial))) {
+			stats.textureSwitches += packet.material->countTextureChanges(lastMaterial);
+			packet.material->applySettings();
+			lastMaterialKey = materialKey;
+			lastMaterial = packet.material;
+			++stats.materialSwitches;
+		}
+
+		//every mesh of the run in one call, the pool's vertex array holds them all
+		if (drawIndirect) {
+			unsigned int commandCount = runCommands[run + 1] - runCommands[run];
+			indirectDrawer.draw(runCommands[run], commandCount);
+			stats.indirectCommands += commandCount;
+			++stats.indirectDraws;
+			++stats.draws;
+			++run;
+			i = findRunEnd(i, materialShift);
+			continue;
+		}
+
+		if (packet.mesh != lastMesh) {
+			packet.mesh->bind();
+			lastMesh = packet.mesh;
+			++stats.meshSwitches;
+		}
+
+		if (instancing) {
+
+			//everything up to the next change of state, the depth bits only ordered it
+			unsigned int runEnd = findRunEnd(i, DEPTH_BITS);
+			packet.mesh->drawElementsInstanced(instances.buffer, instances.offset + i * sizeof(glm::mat4), runEnd - i);
+			++stats.instancedDraws;
+			i = runEnd;
+		}
+		else {
+			glUniformMatrix4fv(toWorldLocation, 1, GL_FALSE, &packet.toWorld[0][0]);
+			packet.mesh->drawElements();
+			++i;
+		}
+		++stats.draws;
+	}
+	if (drawIndirect) {
+		MeshPool::clearInstanceBuffer();
+	}
+	GLState::bindVertexArray(0);
+
+	if (pre_passed) {
+		GLState::depthFunc(GL_LEQUAL);
+		GLState::depthMask(GL_TRUE);
+	}
+	glUniform1i(instancedLocation, 0);
+
+	packets.clear();
+	sortEntries.clear();
+}
+
+RenderQueue::Stats RenderQueue::getStats() {
+	return stats;
+}
+
+//PRIVATE HELPERS
+
+unsigned int RenderQueue::getProgramID(GLuint program) {
+	for (unsigned int i = 0; i < programs.size(); ++i) {
+		if (programs[i] == program)
+			return i;
+	}
+	programs.push_back(program);
+	return programs.size() - 1;
+}
+
+//a handful of distinct materials per frame, a linear search for an equal one is cheapest
+unsigned int RenderQueue::getMaterialID(Material* material) {
+
+	const unsigned int maxID = (1 << MATERIAL_BITS) - 1;
+	for (unsigned int i = 0; i < materials.size(); ++i) {
+		if (materials[i] == material || materials[i]->sameSettings(*material))
+			return i;
+	}
+	if (materials.size() == maxID)
+		return maxID;
+	materials.push_back(material);
+	return materials.size() - 1;
+}
+
+/*least significant digit radix sort, a byte per pass. Passes where every key has
+the same byte, like the pass and program fields most frames, are skipped*/
+void RenderQueue::sortKeys() {
+
+	unsigned int count = sortEntries.size();
+	sortScratch.resize(count);
+
+	for (int shift = 0; shift < 64; shift += 8) {
+
+		unsigned int offsets[256] = { 0 };
+		for (unsigned int i = 0; i < count; ++i) {
+			++offsets[(sortEntries[i].key >> shift) & 0xff];
+		}
+		if (offsets[(sortEntries[0].key >> shift) & 0xff] == count)
+			continue;
+
+		unsigned int sum = 0;
+		for (int digit = 0; digit < 256; ++digit) {
+			unsigned int digitCount = offsets[digit];
+			offsets[digit] = sum;
+			sum += digitCount;
+		}
+		for (unsigned int i = 0; i < count; ++i) {
+			sortScratch[offsets[(sortEntries[i].key >> shift) & 0xff]++] = sortEntries[i];
+		}
+		sortEntries.swap(sortScratch);
+	}
+}
+
+/*end of the run starting at first whose keys agree above shift. Overflowed
+material ids are split by settings, and runs down to the mesh bits by the mesh
+itself, since ids wrap past the mesh field*/
+unsigned int RenderQueue::findRunEnd(unsigned int first, int shift) {
+
+	const unsigned long long materialMask = (1 << MATERIAL_BITS) - 1;
+
+	unsigned long long key = sortEntries[first].key >> shift;
+	DrawPacket& packet = packets[sortEntries[first].packet];
+	bool overflowed = ((sortEntries[first].key >> (MESH_BITS + DEPTH_BITS)) & materialMask) == materialMask;
+
+	unsigned int end = first + 1;
+	while (end < sortEntries.size() && (sortEntries[end].key >> shift) == key) {
+		DrawPacket& next = packets[sortEntries[end].packet];
+		if (shift <= DEPTH_BITS && next.mesh != packet.mesh)
+			break;
+		if (overflowed && !next.material->sameSettings(*packet.material))
+			break;
+		++end;
+	}
+	return end;
+}
+
+/*one upload for every instanced run of the frame. The ring never waits on last
+frame's draws, the fallback orphans their storage instead. Culling reads the
+matrices as shader storage, so they start on its alignment as well*/
+void RenderQueue::uploadInstances() {
+
+	instanceData.resize(sortEntries.size());
+	for (unsigned int i = 0; i < sortEntries.size(); ++i) {
+		instanceData[i] = packets[sortEntries[i].packet].toWorld;
+	}
+	GLsizeiptr dataSize = instanceData.size() * sizeof(glm::mat4);
+	GLsizeiptr alignment = std::max((GLsizeiptr)sizeof(glm::mat4), FrameRing::getStorageAlignment());
+	if (FrameRing::upload(instanceData.data(), dataSize, alignment, instances))
+		return;
+
+	instances.buffer = instanceBuffer;
+	instances.offset = 0;
+	if (dataSize > instanceBufferSize) {
+		instanceBufferSize = dataSize * 2;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, instanceBufferSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, dataSize, instanceData.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/*commands of each program and material run back to back, runCommands holding
+where each run's start plus one past the last. A command covers a run of one
+mesh, or with GPU culling a single object so the cull can drop it alone*/
+void RenderQueue::buildCommands() {
+
+	indirectDrawer.beginFrame();
+	runCommands.clear();
+
+	unsigned int i = 0;
+	while (i < sortEntries.size()) {
+
+		unsigned int runEnd = findRunEnd(i, MESH_BITS + DEPTH_BITS);
+		runCommands.push_back(indirectDrawer.getNumCommands());
+
+		while (i < runEnd) {
+			Mesh* mesh = packets[sortEntries[i].packet].mesh;
+			unsigned int meshEnd = gpuCulling ? i + 1 : findRunEnd(i, DEPTH_BITS);
+			indirectDrawer.add(mesh, i, meshEnd - i);
+			i = meshEnd;
+		}
+	}
+	runCommands.push_back(indirectDrawer.getNumCommands());
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "Mesh.h"
+#include "Material.h"
+#include "IndirectDrawer.h"
+#include "FrameRing.h"
+
+class Camera;
+
+/*Model draws of the main pass, collected while the scene graph is walked instead
+of issued on the spot. Each packet gets a 64 bit key, from the most significant
+bits down: pass, shader program, material, mesh, then view depth front to back.
+A radix sort over the keys puts draws sharing state next to each other, and
+submission only switches program, material or mesh when the key says it
+changed. Runs of the same mesh and material become one instanced draw, their
+world matrices written back to back into a single instance buffer. With indirect
+drawing every run of a program and material is one multi draw over the mesh
+pool instead, optionally frustum culled per object on the GPU*/
+class RenderQueue {
+
+public:
+
+	//sort key fields, widths add up to 64
+	const static int PASS_BITS = 4;
+	const static int PROGRAM_BITS = 4;
+	const static int MATERIAL_BITS = 16;
+	const static int MESH_BITS = 16;
+	const static int DEPTH_BITS = 24;
+
+	//later passes sort after earlier ones, only opaque models are queued so far
+	enum Pass { OPAQUE_PASS };
+
+	struct Stats {
+		unsigned int packets;			//model draws queued
+		unsigned int draws;				//draw calls they were submitted with
+		unsigned int instancedDraws;	//of those, how many were instanced
+		unsigned int indirectDraws;		//of those, how many were multi draws
+		unsigned int indirectCommands;	//commands those multi draws were given
+		unsigned int programSwitches;
+		unsigned int materialSwitches;
+		unsigned int textureSwitches;	//texture units rebound by material switches
+		unsigned int meshSwitches;
+	};
+
+private:
+
+	struct DrawPacket {
+		Mesh* mesh;
+		Material* material;				//owned by the queued model, alive for the frame
+		glm::mat4 toWorld;
+	};
+
+	struct SortEntry {
+		unsigned long long key;
+		unsigned int packet;
+	};
+
+	std::vector<DrawPacket> packets;
+	std::vector<SortEntry> sortEntries;
+	std::vector<SortEntry> sortScratch;
+
+	//small per frame ids for the key, materials are compared by their settings
+	std::vector<GLuint> programs;
+	std::vector<Material*> materials;
+
+	//view space depth range quantized into the depth bits
+	glm::mat4 view;
+	float depthScale;
+
+	//world matrices in sorted order, instanced runs draw straight from it
+	bool instancing;
+	std::vector<glm::mat4> instanceData;
+	GLuint instanceBuffer;
+	GLsizeiptr instanceBufferSize;
+
+	//where this frame's matrices went, the frame ring or instanceBuffer when it was full
+	FrameRing::Allocation instances;
+
+	//multi draw indirect, command ranges of each program and material run
+	bool indirect;
+	bool gpuCulling;
+	IndirectDrawer indirectDrawer;
+	std::vector<unsigned int> runCommands;
+
+	Stats stats;
+
+public:
+
+	RenderQueue();
+
+	void init();
+	void dispose();
+
+	void setInstancing(bool opt);
+	bool isInstancingEnabled();
+
+	//ignored where indirect drawing isn't supported
+	void setIndirect(bool opt);
+	bool usesIndirect();
+	void setGPUCulling(bool opt);
+	bool isGPUCullingEnabled();
+
+	//depths are measured from the camera, up to its far plane
+	void beginFrame(Camera* camera);
+	void add(int pass, Mesh* mesh, Material* material, const glm::mat4& to_world);
+
+	//sort and draw everything queued since beginFrame
+	void submit(Camera* camera, bool pre_passed);
+
+	Stats getStats();
+
+private:
+	unsigned int getProgramID(GLuint program);
+	unsigned int getMaterialID(Material* material);
+	void sortKeys();
+	unsigned int findRunEnd(unsigned int first, int shift);
+	void uploadInstances();
+	void buildCommands();
+};
@@ -1,4 +1,7 @@
 #include "SampleScene.h"
+#include "GLState.h"
+#include "FrameRing.h"
+#include "DebugDraw.h"
 
 void SampleScene::initThisScene() {
 
@@ -17,6 +20,13 @@ void SampleScene::initThisScene() {
 	allSceneLights.push_back(new Light(Light::POINT, glm::vec3(0, 0, 1), 5, 3.3333f * glm::vec3(20, 30, -20)));
 	allSceneLights.push_back(new Light(Light::DIRECTIONAL, glm::vec3(1, 1, 1), 0.40f, glm::vec3(0, 50, 30)));
 	allSceneLights[3]->setLocalRotation(glm::rotate(glm::mat4(1.0f), glm::pi<float>() / 8.0f, glm::vec3(0, 1, 0)) *  glm::rotate(glm::mat4(1.0f), 3 * glm::pi<float>() / 4.0f, glm::vec3(1, 0, 0)));
+	allSceneLights.push_back(new Light(Light::SPOT, glm::vec3(1, 0.8f, 0.6f), 5, glm::vec3(0, 60, 60)));
+	allSceneLights[4]->setLocalRotation(glm::rotate(glm::mat4(1.0f), 3 * glm::pi<float>() / 4, glm::vec3(1, 0, 0)));
+	allSceneLights[4]->setSpotAngle(glm::pi<float>() / 8.0f);
+
+	//filter quality per light, the dim fill light gets cheap prefiltered shadows
+	allSceneLights[3]->setShadowFilter(ShadowAtlas::EXPONENTIAL_SHADOWS, 4.0f, 1);
+	allSceneLights[4]->setShadowFilter(ShadowAtlas::POISSON_SHADOWS, 3.0f, 16);
 
 	//init camera
 	currActiveCamera = new Camera(glm::vec3(0, 0, 120), glm::pi<float>() / 4);
@@ -45,6 +55,28 @@ void SampleScene::initThisScene() {
 
 	wall = new Model("Models/Wall.obj", basicMaterial);
 	wall->setLocalScale(glm::vec3(0.3, 0.3, 0.3));
+	wall->setOccluder(true);
+
+	//two triangles through the middle of the wall's thickness, inset so they stay inside the render mesh
+	AABB wallBounds = wall->getMeshBounds();
+	glm::vec3 wallExtents = wallBounds.getExtents();
+	int thinAxis = wallExtents.x < wallExtents.y ? (wallExtents.x < wallExtents.z ? 0 : 2) : (wallExtents.y < wallExtents.z ? 1 : 2);
+	int uAxis = (thinAxis + 1) % 3;
+	int vAxis = (thinAxis + 2) % 3;
+	glm::vec3 wallCorners[4];
+	for (int i = 0; i < 4; ++i) {
+		wallCorners[i] = wallBounds.getCenter();
+		wallCorners[i][uAxis] += (i == 1 || i == 2 ? 0.9f : -0.9f) * wallExtents[uAxis];
+		wallCorners[i][vAxis] += (i >= 2 ? 0.9f : -0.9f) * wallExtents[vAxis];
+	}
+	std::vector<glm::vec3> wallOccluder;
+	wallOccluder.push_back(wallCorners[0]);
+	wallOccluder.push_back(wallCorners[1]);
+	wallOccluder.push_back(wallCorners[2]);
+	wallOccluder.push_back(wallCorners[0]);
+	wallOccluder.push_back(wallCorners[2]);
+	wallOccluder.push_back(wallCorners[3]);
+	wall->setOccluderMesh(wallOccluder);
 
 	cylinder = new Model("Models/Cylinder.obj", basicMaterial);
 	cylinder->setLocalPosition(glm::vec3(50, 60, 35));
@@ -62,15 +94,28 @@ void SampleScene::initThisScene() {
 	
 	
 
+	//nothing in the wall's hierarchy moves, keep it in the cached static shadow depth
+	wall->setStaticShadowCaster(true);
+	cylinder->setStaticShadowCaster(true);
+	prism->setStaticShadowCaster(true);
+
 	//scene hierarchy
 	wall->addChild(cylinder);
 	wall->addChild(prism);
 	wall->addChild(allSceneLights[1]);
 	wall->addChild(allSceneLights[2]);
+	wall->addChild(allSceneLights[4]);
 	
 	currActiveCamera->setTargetObject(wall);
 	currActiveCamera->setTargetMode(true);
 
+	//scene graph roots, children are reached through them
+	addRoot(&oceanView);
+	addRoot(currActiveCamera);
+	addRoot(wall);
+	addRoot(allSceneLights[0]);
+	addRoot(allSceneLights[3]);
+
 }
 void SampleScene::disposeThisScene() {
 
@@ -101,14 +146,8 @@ void SampleScene::updateThisScene() {
 
 void SampleScene::drawThisSceneToShadowMap() {
 
-	oceanView.drawToShadowMap();
-	currActiveCamera->drawToShadowMap();
-	wall->drawToShadowMap();
-	
-
-	for (GLuint i = 0; i < allSceneLights.size(); ++i) {
-		allSceneLights[i]->drawToShadowMap();
-	}
+	//the skybox, camera and lights don't cast shadows, every caster hangs off the wall
+	wall->drawToShadowMap(this);
 
 }
 void SampleScene::drawThisScene() {
@@ -133,6 +172,133 @@ void SampleScene::key_event(int key, int scancode, int action, int mods) {
 			// Close the window. This causes the program to also terminate.
 			glfwSetWindowShouldClose(SceneManager::window, GL_TRUE);
 		}
+
+		//toggle view frustum culling to compare frame times
+		if (key == GLFW_KEY_C)
+		{
+			setFrustumCulling(!isFrustumCullingEnabled());
+			CullStats stats = getCullStats();
+			std::cout << "Frustum culling " << (isFrustumCullingEnabled() ? "on" : "off") << ", last frame culled " << stats.objectsCulled << " of " << stats.objectsTested << " tested, saved " << stats.drawsSaved << " draws" << std::endl;
+		}
+		if (key == GLFW_KEY_O)
+		{
+			setOcclusionCulling(!isOcclusionCullingEnabled());
+			CullStats stats = getCullStats();
+			std::cout << "Occlusion culling " << (isOcclusionCullingEnabled() ? "on" : "off") << ", last frame occluded " << stats.objectsOccluded << " models" << std::endl;
+		}
+		if (key == GLFW_KEY_Q)
+		{
+			setOcclusionMethod(getOcclusionMethod() == CPU_DEPTH_BUFFER ? GPU_QUERIES : CPU_DEPTH_BUFFER);
+			OcclusionQueryManager::Stats stats = getOcclusionQueries().getStats();
+			std::cout << "Occlusion method " << (getOcclusionMethod() == GPU_QUERIES ? "GPU queries" : "CPU depth buffer")
+				<< ", last query frame issued " << stats.queriesIssued << " queries, read " << stats.resultsRead
+				<< " results, drew " << stats.proxiesDrawn << " proxies and " << stats.conditionalDraws << " conditional draws" << std::endl;
+		}
+		//switch between forward and deferred shading on the same scene
+		if (key == GLFW_KEY_G)
+		{
+			Material::setDeferred(!Material::isDeferred());
+			std::cout << (Material::isDeferred() ? "Deferred" : "Forward") << " shading" << std::endl;
+		}
+		//report the mode that just ran, then switch so the two can be compared
+		if (key == GLFW_KEY_P)
+		{
+			DepthPrePassStats stats = getDepthPrePassStats();
+			if (stats.available)
+				std::cout << "Depth pre-pass " << (usesDepthPrePass() ? "on" : "off") << ", last measured frame shaded " << stats.mainPassFragments
+					<< " fragments in the main pass and " << stats.prePassFragments << " in the pre-pass" << std::endl;
+			setDepthPrePass(!usesDepthPrePass());
+			std::cout << "Depth pre-pass " << (usesDepthPrePass() ? "on" : "off") << std::endl;
+		}
+		if (key == GLFW_KEY_M)
+		{
+			ShadowStats stats = getShadowStats();
+			std::cout << "Shadow maps last frame: " << stats.passesSkipped << " skipped, " << stats.staticPasses << " static and "
+				<< stats.dynamicPasses << " dynamic passes drawn, " << stats.castersCulled << " casters culled" << std::endl;
+		}
+		if (key == GLFW_KEY_L)
+		{
+			LightBuffer::Stats stats = getLightBufferStats();
+			std::cout << "Light buffer last frame uploaded " << stats.bytesUploaded << " bytes in "
+				<< stats.rangesUploaded << " ranges, waited on " << stats.fenceWaits << " fences for " << stats.waitMilliseconds << " ms" << std::endl;
+		}
+		//report the mode that just ran, then switch so the two can be compared
+		if (key == GLFW_KEY_I)
+		{
+			RenderQueue::Stats stats = getRenderQueueStats();
+			std::cout << "Instancing " << (isInstancingEnabled() ? "on" : "off") << ", last frame drew " << stats.packets << " models in "
+				<< stats.draws << " draws, " << stats.instancedDraws << " instanced, switching " << stats.programSwitches << " programs, "
+				<< stats.materialSwitches << " materials, " << stats.textureSwitches << " textures and " << stats.meshSwitches << " meshes" << std::endl;
+			setInstancing(!isInstancingEnabled());
+			std::cout << "Instancing " << (isInstancingEnabled() ? "on" : "off") << std::endl;
+		}
+		//cycles plain submission, multi draw indirect, and indirect with GPU frustum culling
+		if (key == GLFW_KEY_D)
+		{
+			RenderQueue& queue = getRenderQueue();
+			RenderQueue::Stats stats = queue.getStats();
+			std::cout << "Last frame drew " << stats.packets << " models in " << stats.draws << " draws, " << stats.indirectDraws
+				<< " multi draws of " << stats.indirectCommands << " commands" << std::endl;
+			if (!IndirectDrawer::isSupported()) {
+				std::cout << "Indirect drawing needs OpenGL 4.3" << std::endl;
+			}
+			else if (!queue.usesIndirect()) {
+				queue.setIndirect(true);
+				queue.setGPUCulling(false);
+			}
+			else if (!queue.isGPUCullingEnabled()) {
+				queue.setGPUCulling(true);
+			}
+			else {
+				queue.setIndirect(false);
+				queue.setGPUCulling(false);
+			}
+			std::cout << "Indirect drawing " << (queue.usesIndirect() ? "on" : "off") << ", GPU culling " << (queue.isGPUCullingEnabled() ? "on" : "off") << std::endl;
+		}
+		if (key == GLFW_KEY_R)
+		{
+			FrameRing::Stats stats = FrameRing::getStats();
+			LightBuffer::Stats lightStats = getLightBufferStats();
+			std::cout << "Frame ring " << (FrameRing::isPersistent() ? "persistent" : "unavailable") << ", last frame made " << stats.allocations << " allocations of "
+				<< stats.bytesAllocated << " bytes, " << stats.failedAllocations << " fell back, waited on " << stats.fenceWaits << " fences for "
+				<< stats.waitMilliseconds << " ms, light buffer waited on " << lightStats.fenceWaits << " for " << lightStats.waitMilliseconds << " ms" << std::endl;
+		}
+		if (key == GLFW_KEY_B)
+		{
+			DebugDraw::Stats stats = DebugDraw::getStats();
+			std::cout << "Debug lines last frame: " << stats.lines << " lines in " << stats.draws << " draws" << std::endl;
+			setBoundsDrawing(!isBoundsDrawingEnabled());
+			std::cout << "Bounding boxes " << (isBoundsDrawingEnabled() ? "shown" : "hidden") << std::endl;
+		}
+		if (key == GLFW_KEY_T)
+		{
+			GLState::Stats stats = GLState::getStats();
+			std::cout << "GL state last frame: " << stats.issued << " calls issued, " << stats.elided << " redundant ones dropped" << std::endl;
+		}
+		if (key == GLFW_KEY_Z)
+		{
+			PostProcess::Stats stats = SceneManager::getPostProcess()->getStats();
+			if (stats.available) {
+				std::cout << "Post process last frame: level " << stats.level << ", down " << stats.passNanoseconds[PostProcess::DOWNSAMPLE_PASS] / 1000.0 << "us, blur " << stats.passNanoseconds[PostProcess::BLUR_PASS] / 1000.0 << "us, up " << stats.passNanoseconds[PostProcess::UPSAMPLE_PASS] / 1000.0 << "us" << std::endl;
+			}
+
+			//no blur, then wider each press
+			Camera* camera = getActiveCamera();
+			float blurValue = camera->getBlurValue();
+			camera->setBlurValue(blurValue <= 0 ? 0.5f : (blurValue >= 2 ? 0 : blurValue * 2));
+			std::cout << "Camera blur " << camera->getBlurValue() << std::endl;
+		}
+		if (key == GLFW_KEY_X)
+		{
+			PostProcess* postProcess = SceneManager::getPostProcess();
+			if (postProcess->getMethod() == PostProcess::FRAGMENT_BLUR && postProcess->supportsCompute()) {
+				postProcess->setMethod(PostProcess::COMPUTE_BLUR);
+			}
+			else {
+				postProcess->setMethod(PostProcess::FRAGMENT_BLUR);
+			}
+			std::cout << "Blur passes in " << (postProcess->getMethod() == PostProcess::COMPUTE_BLUR ? "compute" : "fragment") << " shaders" << std::endl;
+		}
 		
 
 	}
@@ -1,29 +1,48 @@
 #include "Scene.h"
 #include "shader.h"
+#include "JobSystem.h"
+#include "GLState.h"
+#include "DebugDraw.h"
+#include "Model.h"
 #include <iostream>
+#include <unordered_set>
+#include <algorithm>
 
 
 void Scene::init() {
 
-	//set up UBO info for all scene lights
-	for (unsigned int i = 0; i < MAX_LIGHTS; ++i) {
-
-			allSceneLightStructs.push_back(LightStruct());
-	}
-	
-	glGenBuffers(1, &UBO_Lights);	//will be deleted in first resize
+	frustumCulling = true;
+	occlusionCulling = true;
+	occlusionMethod = CPU_DEPTH_BUFFER;
+	depthPrePass = false;
+	shadowCasterPass = ALL_CASTERS;
+	shadowDistance = 500.0f;
+	shadowCulling = true;
+	layeredShadowPass = false;
+	boundsDrawing = false;
+
+	//fragment counts to compare with and without the pre-pass
+	prePassFragments.init(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, GLEW_ARB_pipeline_statistics_query ? true : false);
+	mainPassFragments.init(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, GLEW_ARB_pipeline_statistics_query ? true : false);
+
+	//set up UBO for all scene lights, kept for the life of the scene
+	lightBuffer.init(0, MAX_LIGHTS);
+	lightBuffer.bindBlock(Material::getForwardShaderProgram(), "SceneLights");
+	lightBuffer.bindBlock(Material::getDeferredLightingProgram(), "SceneLights");
+	numLightsSent = -1;
+	numLightsProgram = 0;
+	lightClusters.initBuffers();
+	renderQueue.init();
 
 	initThisScene();
 
+	//bring world matrices up to date and index every object before the first frame is drawn
+	updateSceneGraph();
 	
-	//init all shadowMaps
-	GLuint currShadowMap = 0;
+	//init all shadowMaps, the atlas is the only shadow memory however many lights there are
+	shadowAtlas.init(SHADOW_ATLAS_RESOLUTION);
 	for (GLuint i = 0; i < allSceneLights.size(); ++i) {
-		if (allSceneLights[i]->type == Light::DIRECTIONAL) {
-			shadowMaps.push_back(new ShadowMap());
-			shadowMaps[currShadowMap]->initBufferAndTexture();
-			++currShadowMap;
-		}	
+		shadowMaps.push_back(new ShadowMap());
 	}
 	
 }
@@ -32,65 +51,177 @@ void Scene::dispose() {
 
 	disposeThisScene();
 
+	//whatever the scene left in its graph stops reporting to it
+	while (!allSceneRoots.empty()) {
+		removeRoot(allSceneRoots.back());
+	}
+
+	occlusionQueries.dispose();
+	renderQueue.dispose();
+	lightClusters.disposeBuffers();
+	prePassFragments.dispose();
+	mainPassFragments.dispose();
+
 	for (GLuint i = 0; i < shadowMaps.size(); ++i) {
-		shadowMaps[i]->disposeBufferAndTexture();
+		delete shadowMaps[i];
 	}
-	glDeleteBuffers(1, &UBO_Lights);
+	shadowMaps.clear();
+	shadowAtlas.dispose();
+	lightBuffer.dispose();
 }
 
 void Scene::update() {
-	updateThisScene();
 
-	for (unsigned int i = 0; i < allSceneCameras.size(); ++i) {
+	//scene specific logic stays on the main thread, it may touch input or GL state
+	updateThisScene();
 
-		//for cameras in target mode, need to keep View and
-		//toWorld matrices up to date with target
-		allSceneCameras.at(i)->updateViewMatrix();
-	}
+	updateSceneGraph();
 }
 
-/*update shadow map objects for lights, this is done before drawing*/
+/*update shadow map objects for lights, this is done before drawing. A census over
+the casters gathers their signatures and bounds. Every light then asks the atlas
+for tiles, and once they're packed fits its views to them. Per tile the cached
+depth is kept, only dynamic casters are redrawn over the cached static depth,
+or both are redrawn*/
 void Scene::calcShadowMaps() {
 
 
-	glUseProgram(ShadowMap::getShaderProgram());	//set active shader
+	GLState::useProgram(ShadowMap::getShaderProgram());	//set active shader
 
+	shadowStats.passesSkipped = 0;
+	shadowStats.staticPasses = 0;
+	shadowStats.dynamicPasses = 0;
+	shadowStats.castersCulled = 0;
+	shadowStats.lightsOutOfView = 0;
+	shadowStats.layeredPasses = 0;
+
+	//FNV-1a offset basis, casters are visited in the same order every frame
+	staticCasterSignature = 14695981039346656037ULL;
+	dynamicCasterSignature = 14695981039346656037ULL;
+	casterBounds = AABB();
+	casterBoundsKnown = true;
+	shadowCasterPass = CASTER_CENSUS;
+	drawThisSceneToShadowMap();
+
+	Camera* activeCamera = getActiveCamera();
+	Frustum cameraFrustum;
+	cameraFrustum.update(activeCamera->getProjectionMatrix() * activeCamera->getViewMatrix());
+
+	shadowAtlas.beginFrame();
+	for (GLuint i = 0; i < allSceneLights.size(); ++i) {
+		shadowMaps[i]->requestTiles(&shadowAtlas, allSceneLights[i], activeCamera, cameraFrustum);
+		if (allSceneLights[i]->type != Light::DIRECTIONAL && shadowMaps[i]->getNumViews() == 0) {
+			++shadowStats.lightsOutOfView;
+		}
+	}
+	shadowAtlas.pack();
 	
-	
-	GLuint currShadowMap = 0;
 	for (GLuint currLight = 0; currLight < allSceneLights.size(); ++currLight) {
-		if (allSceneLights[currLight]->type == Light::DIRECTIONAL) {
-			shadowMaps[currShadowMap]->applyAttributes(allSceneLights[currLight]); //also sets Light's VP matrix in biased form
-			drawThisSceneToShadowMap();	//draw scene to current shadow map
-			++currShadowMap;
+
+		ShadowMap* shadowMap = shadowMaps[currLight];
+
+		//also sets the light's first view and cascade splits
+		shadowMap->updateViews(&shadowAtlas, allSceneLights[currLight], activeCamera, shadowDistance, casterBoundsKnown ? &casterBounds : NULL);
+
+		if (shadowMap->usesLayeredViews()) {
+			drawLayeredViews(shadowMap, allSceneLights[currLight]);
+			continue;
 		}
-	}
 
+		for (int view = 0; view < shadowMap->getNumViews(); ++view) {
+
+			int tile = shadowMap->getTile(view);
+			if (shadowAtlas.isCacheValid(tile, staticCasterSignature, dynamicCasterSignature)) {
+				++shadowStats.passesSkipped;
+				continue;
+			}
+			shadowMap->getCasterVolume(view, shadowVolume);
+
+			if (!shadowAtlas.isStaticCacheValid(tile, staticCasterSignature)) {
+				shadowAtlas.beginStaticPass(tile);
+				shadowMap->applyViewMatrices(view);
+				shadowCasterPass = STATIC_CASTERS;
+				drawThisSceneToShadowMap();
+				++shadowStats.staticPasses;
+			}
+
+			shadowAtlas.beginDynamicPass(tile);
+			shadowMap->applyViewMatrices(view);
+			shadowCasterPass = DYNAMIC_CASTERS;
+			drawThisSceneToShadowMap();
+			++shadowStats.dynamicPasses;
+
+			shadowAtlas.markCached(tile, staticCasterSignature, dynamicCasterSignature);
+		}
+	}
+	shadowAtlas.endPasses();
+	shadowAtlas.uploadViewData();
+	GLState::disable(GL_DEPTH_CLAMP);
 
-	
+	//anything else drawing shadow geometry, like the depth pre-pass, wants every caster
+	shadowCasterPass = ALL_CASTERS;
 }
 void Scene::draw() {
 
-	//apply shadow map to material shader
-	glUseProgram(Material::getShaderProgram());	
+	//apply shadow map to the shader that evaluates lights
+	GLuint lightingProgram = Material::getLightingProgram();
+	GLState::useProgram(lightingProgram);	
 
-	//send shadow maps to material shader, start at 3, since 0-2 used by material textures
-	
-	
-	for (GLuint i = 0; i < shadowMaps.size(); ++i) {
-		std::string location = "shadowMaps[" + std::to_string(i) + "]";
-		glUniform1i(glGetUniformLocation(Material::getShaderProgram(), location.c_str()), i + 3);
-		glActiveTexture(GL_TEXTURE3 + i);
-		glBindTexture(GL_TEXTURE_2D, shadowMaps[i]->getDepthTexture().getID());
-	}
+	//send shadow atlas to material shader at 3, since 0-2 used by material textures.
+	//The deferred lighting pass has no material textures but reads the G-buffer there
+	GLuint shadowAtlasUnit = Material::isDeferred() ? GBuffer::NUM_TEXTURES : 3;
+	shadowAtlas.applySettings(lightingProgram, shadowAtlasUnit);
 
 
 	//apply lights
 	applyAllLights();
 
-	//draw scene for rendering
+	//cull against what the active camera sees this frame
+	Camera* activeCamera = getActiveCamera();
+	viewFrustum.update(activeCamera->getProjectionMatrix() * activeCamera->getViewMatrix());
+	cullStats.objectsTested = 0;
+	cullStats.objectsCulled = 0;
+	cullStats.objectsOccluded = 0;
+	cullStats.drawsSaved = 0;
+
+	//occluders go into the depth buffer before anything is tested against it
+	if (occlusionCulling && occlusionMethod == GPU_QUERIES) {
+		occlusionQueries.beginFrame();
+	}
+	else if (occlusionCulling) {
+		occlusionBuffer.beginFrame(activeCamera->getProjectionMatrix() * activeCamera->getViewMatrix());
+		for (unsigned int i = 0; i < allSceneRoots.size(); ++i) {
+			allSceneRoots[i]->drawToOcclusionBuffer(&occlusionBuffer);
+		}
+		occlusionBuffer.rasterize();
+	}
+
+	//lay down depth first, models then shade only the fragments that survive
+	if (depthPrePass) {
+		drawDepthPrePass();
+	}
+
+	//draw scene for rendering, queued models go out sorted once everything else has been walked
+	mainPassFragments.begin();
+	renderQueue.beginFrame(activeCamera);
+	queriedModels.clear();
 	drawThisScene();
+	renderQueue.submit(activeCamera, depthPrePass);
+
+	//queries test against the depth the queue just wrote, occluders included
+	for (unsigned int i = 0; i < queriedModels.size(); ++i) {
+		queriedModels[i]->drawQueried(this);
+	}
+	mainPassFragments.end();
+
+	//gizmos and boxes added during the walk go out in one draw
+	if (boundsDrawing) {
+		drawBoundingBoxes();
+	}
+	DebugDraw::flush(activeCamera);
 
+	//the light buffer region read by this frame's draws is not written again until they finish
+	lightBuffer.endFrame();
 }
 
 void Scene::resize_event(int width, int height) {
@@ -103,42 +234,426 @@ void Scene::resize_event(int width, int height) {
 		if (allSceneCameras.at(i) != NULL) 
 			allSceneCameras.at(i)->resize((float)window_width, (float)window_height);
 	}
+}
+
+//objects are created, parented and destroyed on the main thread, between updates
+void Scene::addRoot(SceneObject* root) {
+	allSceneRoots.push_back(root);
+	root->joinScene(this);
+}
+void Scene::removeRoot(SceneObject* root) {
+	allSceneRoots.erase(std::find(allSceneRoots.begin(), allSceneRoots.end(), root));
+	root->leaveScene();
+}
+void Scene::addObject(SceneObject* object) {
+	joiningObjects.push_back(object);
+}
+void Scene::removeObject(SceneObject* object) {
+
+	occlusionQueries.remove(object);
+
+	//not indexed yet, nothing points at it but the joining list
+	std::vector<SceneObject*>::iterator joining = std::find(joiningObjects.begin(), joiningObjects.end(), object);
+	if (joining != joiningObjects.end()) {
+		joiningObjects.erase(joining);
+		return;
+	}
+
+	std::unordered_map<SceneObject*, SceneObjectProxies>::iterator found = objectProxies.find(object);
+	if (found == objectProxies.end()) {
+		return;
+	}
+	if (found->second.bvh != BVH::NULL_NODE) {
+		sceneBVH.remove(found->second.bvh);
+	}
+
+	//the box may already be deleted by its model, only the pointer is compared
+	if (found->second.broadPhase != -1) {
+		broadPhase.remove(found->second.broadPhase);
+		allSceneBoundingBoxes.erase(std::find(allSceneBoundingBoxes.begin(), allSceneBoundingBoxes.end(), found->second.box));
+	}
+	objectProxies.erase(found);
+}
+
+void Scene::setFrustumCulling(bool opt) {
+	frustumCulling = opt;
+}
+bool Scene::isFrustumCullingEnabled() {
+	return frustumCulling;
+}
+const Frustum& Scene::getViewFrustum() {
+	return viewFrustum;
+}
+int Scene::classifyVisibility(const AABB& bounds) {
+	++cullStats.objectsTested;
+	return viewFrustum.classify(bounds);
+}
+void Scene::reportCulled(unsigned int subtree_size) {
+	++cullStats.objectsCulled;
+	cullStats.drawsSaved += subtree_size;
+}
+CullStats Scene::getCullStats() {
+	return cullStats;
+}
+
+void Scene::setOcclusionCulling(bool opt) {
+	occlusionCulling = opt;
+}
+bool Scene::isOcclusionCullingEnabled() {
+	return occlusionCulling;
+}
+void Scene::setOcclusionMethod(int method) {
+	occlusionMethod = method;
+}
+int Scene::getOcclusionMethod() {
+	return occlusionMethod;
+}
+//CPU answer, GPU queries never reject a draw up front
+bool Scene::isOccluded(const AABB& bounds) {
+
+	if (!occlusionCulling || occlusionMethod != CPU_DEPTH_BUFFER || occlusionBuffer.isVisible(bounds))
+		return false;
 
-	recalcUBO_Lights();
+	++cullStats.objectsOccluded;
+	++cullStats.drawsSaved;
+	return true;
+}
+bool Scene::usesOcclusionQueries() {
+	return occlusionCulling && occlusionMethod == GPU_QUERIES;
+}
+const OcclusionBuffer& Scene::getOcclusionBuffer() {
+	return occlusionBuffer;
+}
+OcclusionQueryManager& Scene::getOcclusionQueries() {
+	return occlusionQueries;
+}
+void Scene::deferQueriedDraw(Model* model) {
+	queriedModels.push_back(model);
+}
+
+bool Scene::acceptShadowCaster(SceneObject* object) {
+
+	if (shadowCasterPass == CASTER_CENSUS) {
+		unsigned long long& signature = object->isStaticShadowCaster() ? staticCasterSignature : dynamicCasterSignature;
+		signature = (signature ^ (unsigned long long)(size_t)object) * 1099511628211ULL;
+		signature = (signature ^ object->getTransformVersion()) * 1099511628211ULL;
+
+		//one caster without bounds leaves the cascades' depth range to the receivers
+		AABB bounds;
+		if (object->getWorldBounds(bounds)) {
+			casterBounds.merge(bounds);
+		}
+		else {
+			casterBoundsKnown = false;
+		}
+		return false;
+	}
+	if (shadowCasterPass == STATIC_CASTERS) {
+		return object->isStaticShadowCaster();
+	}
+	if (shadowCasterPass == DYNAMIC_CASTERS) {
+		return !object->isStaticShadowCaster();
+	}
+	return true;
+}
+ShadowStats Scene::getShadowStats() {
+	return shadowStats;
+}
+
+void Scene::setShadowCulling(bool opt) {
+	shadowCulling = opt;
+}
+//only the passes that draw into a shadow view, the census has to see every caster
+bool Scene::isShadowCullingActive() {
+	return shadowCulling && (shadowCasterPass == STATIC_CASTERS || shadowCasterPass == DYNAMIC_CASTERS);
+}
+int Scene::classifyShadowCaster(const AABB& bounds) {
+	return shadowVolume.classify(bounds);
+}
+void Scene::reportShadowCulled(unsigned int subtree_size) {
+	shadowStats.castersCulled += subtree_size;
+}
+bool Scene::isLayeredShadowPass() {
+	return layeredShadowPass;
+}
+//one bit per cube face the bounds reach, every face when culling is off
+int Scene::getShadowFaceMask(const AABB& bounds) {
+	if (!shadowCulling) {
+		return (1 << ShadowMap::MAX_VIEWS) - 1;
+	}
+	int mask = 0;
+	for (int face = 0; face < ShadowMap::MAX_VIEWS; ++face) {
+		if (shadowFaceVolumes[face].classify(bounds) != Frustum::OUTSIDE) {
+			mask |= 1 << face;
+		}
+	}
+	return mask;
+}
+
+void Scene::setShadowDistance(float shadow_distance) {
+	shadowDistance = shadow_distance;
+}
+float Scene::getShadowDistance() {
+	return shadowDistance;
+}
+void Scene::setShadowCascades(int num_cascades, GLuint max_tile_size) {
+	for (GLuint i = 0; i < shadowMaps.size(); ++i) {
+		shadowMaps[i]->setCascadeSettings(num_cascades, max_tile_size);
+	}
+}
+
+void Scene::setDepthPrePass(bool opt) {
+	depthPrePass = opt;
+}
+bool Scene::usesDepthPrePass() {
+	return depthPrePass;
+}
+DepthPrePassStats Scene::getDepthPrePassStats() {
+
+	DepthPrePassStats stats;
+	stats.prePassFragments = 0;
+	stats.mainPassFragments = 0;
+	stats.available = mainPassFragments.getResult(stats.mainPassFragments);
+	if (depthPrePass) {
+		prePassFragments.getResult(stats.prePassFragments);
+	}
+	return stats;
+}
+
+void Scene::setInstancing(bool opt) {
+	renderQueue.setInstancing(opt);
+}
+bool Scene::isInstancingEnabled() {
+	return renderQueue.isInstancingEnabled();
+}
+RenderQueue& Scene::getRenderQueue() {
+	return renderQueue;
+}
+RenderQueue::Stats Scene::getRenderQueueStats() {
+	return renderQueue.getStats();
+}
+
+void Scene::setBoundsDrawing(bool opt) {
+	boundsDrawing = opt;
+}
+bool Scene::isBoundsDrawingEnabled() {
+	return boundsDrawing;
+}
+
+BVH& Scene::getSceneBVH() {
+	return sceneBVH;
+}
+BroadPhase& Scene::getBroadPhase() {
+	return broadPhase;
+}
+const std::vector<Contact>& Scene::getContacts() {
+	return contacts;
+}
+
+LightBuffer::Stats Scene::getLightBufferStats() {
+	return lightBuffer.getStats();
 }
 
 
 //PRIVATE HELPERS
+
+/*all six faces of a point light in one walk of the scene, tiles are cached as a
+group since every caster goes to all of them at once*/
+void Scene::drawLayeredViews(ShadowMap* shadow_map, Light* curr_light) {
+
+	int faceTiles[ShadowMap::MAX_VIEWS];
+	bool cached = true;
+	bool staticCached = true;
+	for (int face = 0; face < ShadowMap::MAX_VIEWS; ++face) {
+		faceTiles[face] = shadow_map->getTile(face);
+		cached = cached && shadowAtlas.isCacheValid(faceTiles[face], staticCasterSignature, dynamicCasterSignature);
+		staticCached = staticCached && shadowAtlas.isStaticCacheValid(faceTiles[face], staticCasterSignature);
+	}
+	if (cached) {
+		shadowStats.passesSkipped += ShadowMap::MAX_VIEWS;
+		return;
+	}
+
+	for (int face = 0; face < ShadowMap::MAX_VIEWS; ++face) {
+		shadow_map->getCasterVolume(face, shadowFaceVolumes[face]);
+	}
+	shadow_map->getRangeVolume(curr_light, shadowVolume);
+	shadow_map->beginLayeredViews();
+	layeredShadowPass = true;
+
+	if (!staticCached) {
+		shadowAtlas.beginLayeredStaticPass(faceTiles, ShadowMap::MAX_VIEWS);
+		shadowCasterPass = STATIC_CASTERS;
+		drawThisSceneToShadowMap();
+		shadowStats.staticPasses += ShadowMap::MAX_VIEWS;
+	}
+
+	shadowAtlas.beginLayeredDynamicPass(faceTiles, ShadowMap::MAX_VIEWS);
+	shadowCasterPass = DYNAMIC_CASTERS;
+	drawThisSceneToShadowMap();
+	shadowStats.dynamicPasses += ShadowMap::MAX_VIEWS;
+	++shadowStats.layeredPasses;
+
+	for (int face = 0; face < ShadowMap::MAX_VIEWS; ++face) {
+		shadowAtlas.markCached(faceTiles[face], staticCasterSignature, dynamicCasterSignature);
+	}
+	layeredShadowPass = false;
+	ShadowMap::endLayeredViews();
+}
+
+/*Runs the per frame update stages on the job system. Transforms must be
+propagated before cameras and bounding boxes read them, cameras and boxes
+are independent of each other and share a stage. The BVH refit reads bounds
+that camera updates may still write, and the broad phase reads the boxes, so
+both wait for stage 2 and then run side by side*/
+void Scene::updateSceneGraph() {
+
+	//stage 1: propagate transforms, one job per scene graph root
+	JobSystem::Counter transformsDone;
+	for (unsigned int i = 0; i < allSceneRoots.size(); ++i) {
+		SceneObject* root = allSceneRoots[i];
+		JobSystem::run([root]() { root->updateWorldTransforms(false); }, &transformsDone);
+	}
+	JobSystem::wait(&transformsDone);
+	indexJoiningObjects();
+
+	//stage 2: cameras and bounding volumes, both depend on stage 1
+	JobSystem::Counter viewsAndBoundsDone;
+	for (unsigned int i = 0; i < allSceneCameras.size(); ++i) {
+
+		//for cameras in target mode, need to keep View and
+		//toWorld matrices up to date with target
+		Camera* camera = allSceneCameras[i];
+		JobSystem::run([camera]() { camera->updateViewMatrix(); }, &viewsAndBoundsDone);
+	}
+	for (unsigned int i = 0; i < allSceneBoundingBoxes.size(); ++i) {
+		BoundingBox* box = allSceneBoundingBoxes[i];
+		JobSystem::run([box]() { box->update(); }, &viewsAndBoundsDone);
+	}
+	JobSystem::wait(&viewsAndBoundsDone);
+
+	//stage 3: refit the spatial index to objects that moved and find colliding models
+	JobSystem::Counter queriesReady;
+	BVH* bvh = &sceneBVH;
+	JobSystem::run([bvh]() { bvh->refit(); }, &queriesReady);
+	broadPhase.update();
+	NarrowPhase::collidePairs(broadPhase.getPairs(), contacts);
+	JobSystem::wait(&queriesReady);
+}
+
+/*objects that joined since the last update have world bounds now. The first update
+builds the index over all of them at once, later arrivals are inserted one by one*/
+void Scene::indexJoiningObjects() {
+
+	if (joiningObjects.empty()) {
+		return;
+	}
+
+	std::vector<int> bvhProxies(joiningObjects.size(), BVH::NULL_NODE);
+	if (objectProxies.empty()) {
+		sceneBVH.build(joiningObjects, &bvhProxies);
+	}
+	else {
+		for (unsigned int i = 0; i < joiningObjects.size(); ++i) {
+			AABB bounds;
+			if (joiningObjects[i]->getWorldBounds(bounds)) {
+				bvhProxies[i] = sceneBVH.insert(joiningObjects[i], bounds);
+			}
+		}
+	}
+
+	//collide every object that brings a box, the broad phase sorts a batch of new boxes at once
+	for (unsigned int i = 0; i < joiningObjects.size(); ++i) {
+		SceneObjectProxies proxies;
+		proxies.bvh = bvhProxies[i];
+		proxies.box = joiningObjects[i]->getBoundingBox();
+		proxies.broadPhase = -1;
+		if (proxies.box != NULL) {
+			allSceneBoundingBoxes.push_back(proxies.box);
+			proxies.broadPhase = broadPhase.add(proxies.box);
+		}
+		objectProxies[joiningObjects[i]] = proxies;
+	}
+	joiningObjects.clear();
+}
+
 void Scene::applyAllLights() {
 
-	//Material shader program is the only one that uses light calculations
-	glUseProgram(Material::getShaderProgram());
+	//Material shader program, or the deferred lighting pass, is the only one that uses light calculations
+	GLuint lightingProgram = Material::getLightingProgram();
+	GLState::useProgram(lightingProgram);
 
-	//update light structs to reflect scene light attributes
-	glUniform1i(glGetUniformLocation(Material::getShaderProgram(), "numLights"), allSceneLights.size());
+	//update light structs to reflect scene light attributes, each finds its shadow
+	//views in the atlas on its own. Only slots whose light changed since the
+	//current buffer region last saw it are uploaded
+	lightBuffer.beginFrame();
+	GLuint numBufferedLights = 0;
+	pointLights.clear();
 	for (unsigned int i = 0; i < allSceneLights.size(); ++i) {
-		allSceneLightStructs[i] = allSceneLights[i]->getLightStruct();
+
+		allSceneLights[i]->updateLightStruct();
+		const LightStruct& lightStruct = allSceneLights[i]->getLightStruct();
+		if (allSceneLights[i]->type != Light::POINT) {
+			if (numBufferedLights < MAX_LIGHTS) {
+				lightBuffer.write(numBufferedLights, lightStruct, allSceneLights[i]->getLightStructVersion());
+				++numBufferedLights;
+			}
+		}
+		else {
+			LightClusters::PointLightData pointLight;
+			pointLight.positionRange = glm::vec4(glm::vec3(lightStruct.position), allSceneLights[i]->range);
+			pointLight.color = glm::vec4(glm::vec3(lightStruct.color) * lightStruct.brightness, (float)lightStruct.firstShadowView);
+			pointLights.push_back(pointLight);
+		}
+	}
+	lightBuffer.commit();
+
+	//program uniforms persist, only resend the count when it or the program changes
+	if ((GLint)numBufferedLights != numLightsSent || lightingProgram != numLightsProgram) {
+		glUniform1i(glGetUniformLocation(lightingProgram, "numLights"), numBufferedLights);
+		numLightsSent = numBufferedLights;
+		numLightsProgram = lightingProgram;
 	}
 
-	//send buffer over to material shader
-	glBindBuffer(GL_UNIFORM_BUFFER, UBO_Lights);
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, MAX_LIGHTS * sizeof(LightStruct), allSceneLightStructs.data());
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	//bin point lights into the active camera's froxels
+	Camera* activeCamera = getActiveCamera();
+	lightClusters.build(activeCamera->getViewMatrix(), activeCamera->getProjectionMatrix(),
+		activeCamera->getCameraNear(), activeCamera->getCameraFar(), pointLights);
+	lightClusters.upload();
+	lightClusters.applySettings(lightingProgram, window_width, window_height);
 	
 }
 
-void Scene::recalcUBO_Lights() {
+//every collided box, red while its model is in contact with another
+void Scene::drawBoundingBoxes() {
 
-	glUseProgram(Material::getShaderProgram());
-	GLuint SceneLightsLocation = glGetUniformBlockIndex(Material::getShaderProgram(), "SceneLights");
-	glUniformBlockBinding(Material::getShaderProgram(), SceneLightsLocation, 0);
+	std::unordered_set<Model*> touching;
+	for (unsigned int i = 0; i < contacts.size(); ++i) {
+		touching.insert(contacts[i].a);
+		touching.insert(contacts[i].b);
+	}
+	for (unsigned int i = 0; i < allSceneBoundingBoxes.size(); ++i) {
+		BoundingBox* box = allSceneBoundingBoxes[i];
+		bool inContact = box->getOwner() != NULL && touching.count(box->getOwner()) != 0;
+		box->draw(inContact ? glm::vec3(1, 0, 0) : glm::vec3(0, 0, 1));
+	}
+}
 
-	glDeleteBuffers(1, &UBO_Lights);
-	glGenBuffers(1, &UBO_Lights);
-	glBindBuffer(GL_UNIFORM_BUFFER, UBO_Lights);
-	glBufferData(GL_UNIFORM_BUFFER, MAX_LIGHTS * sizeof(LightStruct), NULL, GL_DYNAMIC_DRAW);
+/*depth only pass through each scene's shadow geometry, with the shadow program
+taking the camera's matrices in place of the light's. Both vertex shaders declare
+gl_Position invariant so models hit exactly the same depths in the main pass*/
+void Scene::drawDepthPrePass() {
 
-	glBindBufferBase(GL_UNIFORM_BUFFER, SceneLightsLocation, UBO_Lights);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-}
+	Camera* activeCamera = getActiveCamera();
+	glm::mat4 projection = activeCamera->getProjectionMatrix();
+	glm::mat4 view = activeCamera->getViewMatrix();
 
+	GLState::useProgram(ShadowMap::getShaderProgram());
+	ShadowMap::applyMatrices(projection, view);
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	prePassFragments.begin();
+	drawThisSceneToShadowMap();
+	prePassFragments.end();
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include <unordered_map>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/gtc/matrix_transform.hpp>
@@ -7,6 +8,53 @@
 #include "Camera.h"
 #include "Light.h"
 #include "ShadowMap.h"
+#include "BoundingBox.h"
+#include "Frustum.h"
+#include "BVH.h"
+#include "BroadPhase.h"
+#include "NarrowPhase.h"
+#include "OcclusionBuffer.h"
+#include "OcclusionQueryManager.h"
+#include "LightClusters.h"
+#include "LightBuffer.h"
+#include "PipelineQuery.h"
+#include "RenderQueue.h"
+
+class Model;
+
+//an object's entries in the scene's spatial index and broad phase, BVH::NULL_NODE
+//and -1 where it has none
+struct SceneObjectProxies {
+	int bvh;
+	int broadPhase;
+	BoundingBox* box;		//collided box, kept to find it again once the object is gone
+};
+
+//per frame results of view frustum culling
+struct CullStats {
+	unsigned int objectsTested;
+	unsigned int objectsCulled;		//objects rejected by a frustum test
+	unsigned int objectsOccluded;	//models hidden behind occluders
+	unsigned int drawsSaved;		//draws skipped, every scene object issues one
+};
+
+//shadow map work done by the last calcShadowMaps
+struct ShadowStats {
+	unsigned int passesSkipped;		//atlas tiles reused as they were
+	unsigned int staticPasses;		//static casters redrawn
+	unsigned int dynamicPasses;		//static depth copied and dynamic casters redrawn
+	unsigned int castersCulled;		//scene objects skipped for missing a view's volume
+	unsigned int lightsOutOfView;	//spot and point lights whose range missed the camera frustum
+	unsigned int layeredPasses;		//point light passes drawing all six cube faces at once
+};
+
+//fragment shader invocations of the last measured frame, from pipeline statistics queries
+struct DepthPrePassStats {
+	bool available;					//false without ARB_pipeline_statistics_query or before the first result
+	GLuint64 prePassFragments;
+	GLuint64 mainPassFragments;
+};
+
 class Scene {
 
 protected:
@@ -16,16 +64,87 @@ protected:
 
 	std::vector<Camera*> allSceneCameras;
 
-	//Scene Lights
+	//top level objects of the scene graph, subtrees are updated independently
+	std::vector<SceneObject*> allSceneRoots;
+
+	//bounding boxes of every indexed object that has one, refreshed every update after transforms are propagated
+	std::vector<BoundingBox*> allSceneBoundingBoxes;
+
+	//Scene Lights, directional and spot lights go through the UBO and point lights are clustered
 	const static GLuint MAX_LIGHTS = 30;
 	std::vector<Light*> allSceneLights;
-	std::vector<LightStruct> allSceneLightStructs;
-	GLuint UBO_Lights;
+	LightBuffer lightBuffer;
+	GLint numLightsSent;		//numLights uniform as last set, -1 before the first frame
+	GLuint numLightsProgram;	//program it was set on, forward and deferred each have one
+	LightClusters lightClusters;
+	std::vector<LightClusters::PointLightData> pointLights;
 
-	//all shadow maps
+	//one shadow map per light, all drawing into tiles of the shared atlas
+	const static GLuint SHADOW_ATLAS_RESOLUTION = 4096;
 	std::vector<ShadowMap*> shadowMaps;
+	ShadowAtlas shadowAtlas;
+
+	//which casters drawToShadowMap lets through, and caster signatures gathered by a census walk
+	int shadowCasterPass;
+	unsigned long long staticCasterSignature;
+	unsigned long long dynamicCasterSignature;
+	ShadowStats shadowStats;
+
+	//volume of the shadow view being drawn, casters outside it are skipped
+	Frustum shadowVolume;
+	bool shadowCulling;
+
+	//during a layered pass, each cube face's volume picks the faces a caster is sent to
+	Frustum shadowFaceVolumes[ShadowMap::MAX_VIEWS];
+	bool layeredShadowPass;
+
+	//union of caster world bounds from the census, cascades reach toward the light up to it
+	AABB casterBounds;
+	bool casterBoundsKnown;
+
+	//cascades cover the camera frustum up to this view depth
+	float shadowDistance;
+
+	//spatial index over the world bounds of every scene object. Objects that
+	//joined since the last update are indexed once their bounds are known
+	BVH sceneBVH;
+	std::unordered_map<SceneObject*, SceneObjectProxies> objectProxies;
+	std::vector<SceneObject*> joiningObjects;
+
+	//overlapping bounding box pairs and the exact contacts among them, refreshed every update
+	BroadPhase broadPhase;
+	std::vector<Contact> contacts;
+
+	//view frustum culling
+	Frustum viewFrustum;
+	bool frustumCulling;
+	CullStats cullStats;
+
+	//occlusion culling, either a CPU depth buffer of marked occluders refreshed
+	//before each draw or GPU queries resolved over the following frames
+	OcclusionBuffer occlusionBuffer;
+	OcclusionQueryManager occlusionQueries;
+	bool occlusionCulling;
+	int occlusionMethod;
+
+	//depth only pass with the shadow program, so the main pass shades each pixel once
+	bool depthPrePass;
+	PipelineQuery prePassFragments;
+	PipelineQuery mainPassFragments;
+
+	//models are queued during the walk, then sorted by state and drawn after it
+	RenderQueue renderQueue;
+
+	//models under a GPU query, drawn after the queue so its occluders are already in the depth buffer
+	std::vector<Model*> queriedModels;
+
+	//every bounding box as debug lines, flushed with the gizmos
+	bool boundsDrawing;
 
 public:
+
+	enum OcclusionMethod { CPU_DEPTH_BUFFER, GPU_QUERIES };
+	enum ShadowCasterPass { ALL_CASTERS, STATIC_CASTERS, DYNAMIC_CASTERS, CASTER_CENSUS };
 	
 	void init();
 	void dispose();
@@ -35,6 +154,72 @@ public:
 	
 	void resize_event(int width, int height);
 
+	//scene graph roots, children are reached through them
+	void addRoot(SceneObject* root);
+	void removeRoot(SceneObject* root);
+
+	//scene objects report themselves as they join or leave the graph
+	void addObject(SceneObject* object);
+	void removeObject(SceneObject* object);
+
+	//view frustum culling
+	void setFrustumCulling(bool opt);
+	bool isFrustumCullingEnabled();
+	const Frustum& getViewFrustum();
+	int classifyVisibility(const AABB& bounds);
+	void reportCulled(unsigned int subtree_size);
+	CullStats getCullStats();
+
+	//occlusion culling
+	void setOcclusionCulling(bool opt);
+	bool isOcclusionCullingEnabled();
+	void setOcclusionMethod(int method);
+	int getOcclusionMethod();
+	bool isOccluded(const AABB& bounds);
+	bool usesOcclusionQueries();
+	const OcclusionBuffer& getOcclusionBuffer();
+	OcclusionQueryManager& getOcclusionQueries();
+	void deferQueriedDraw(Model* model);
+
+	//shadow map caching
+	bool acceptShadowCaster(SceneObject* object);
+	ShadowStats getShadowStats();
+
+	//shadow caster culling
+	void setShadowCulling(bool opt);
+	bool isShadowCullingActive();
+	int classifyShadowCaster(const AABB& bounds);
+	void reportShadowCulled(unsigned int subtree_size);
+	bool isLayeredShadowPass();
+	int getShadowFaceMask(const AABB& bounds);
+
+	//cascaded shadow maps, tile sizes are at most, the atlas budget may shrink them
+	void setShadowDistance(float shadow_distance);
+	float getShadowDistance();
+	void setShadowCascades(int num_cascades, GLuint max_tile_size);
+
+	//depth pre-pass
+	void setDepthPrePass(bool opt);
+	bool usesDepthPrePass();
+	DepthPrePassStats getDepthPrePassStats();
+
+	//render queue, runs of the same mesh and material are instanced unless switched off
+	void setInstancing(bool opt);
+	bool isInstancingEnabled();
+	RenderQueue& getRenderQueue();
+	RenderQueue::Stats getRenderQueueStats();
+
+	//bounding boxes drawn as debug lines, red while their model is in contact
+	void setBoundsDrawing(bool opt);
+	bool isBoundsDrawingEnabled();
+
+	//for culling, collision and picking queries
+	BVH& getSceneBVH();
+	BroadPhase& getBroadPhase();
+	const std::vector<Contact>& getContacts();
+
+	//light uploads of the last frame
+	LightBuffer::Stats getLightBufferStats();
 	
 	
 	virtual Camera* getActiveCamera() = 0;
@@ -54,8 +239,11 @@ protected:
 
 
 private:
+	void updateSceneGraph();
+	void indexJoiningObjects();
 	void applyAllLights();
-
-	void recalcUBO_Lights();
+	void drawDepthPrePass();
+	void drawBoundingBoxes();
+	void drawLayeredViews(ShadowMap* shadow_map, Light* curr_light);
 
 };
\ No newline at end of file
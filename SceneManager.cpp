@@ -3,6 +3,13 @@
 #include "Scene.h"
 #include "SampleScene.h"
 #include "ShadowMap.h"
+#include "JobSystem.h"
+#include "OcclusionQueryManager.h"
+#include "MeshPool.h"
+#include "FrameRing.h"
+#include "DebugDraw.h"
+#include "IndirectDrawer.h"
+#include "GLState.h"
 
 //Basic Data
 GLFWwindow* SceneManager::window;
@@ -14,8 +21,7 @@ float SceneManager::deltaTime;
 Scene* SceneManager::currScene = NULL;
 
 
-//Gaussian Blur Data
-GLuint SceneManager::blurShaderProgram;
+//Frame Data
 GLuint SceneManager::frameBufferID;
 Texture SceneManager::frameTexture;
 GLuint SceneManager::renderBufferID;
@@ -34,6 +40,12 @@ GLfloat SceneManager::screenQuadVertexPositions[] = {
 GLuint SceneManager::EB0_ScreenQuad;
 GLuint SceneManager::meshIndices[6] = {0,1,2,3,4,5};
 
+//Deferred Shading Data
+GBuffer SceneManager::gBuffer;
+
+//Post Processing
+PostProcess SceneManager::postProcess;
+
 
 
 //don't call any gl functions here, only glfw
@@ -80,12 +92,18 @@ int SceneManager::createWindow(const char* title, int window_width, int window_h
 void SceneManager::initObjects() {
 
 	//init statics for classes which need them
+	JobSystem::init();
 	Material::initStatics();
 	ShadowMap::initStatics();
+	OcclusionQueryManager::initStatics();
+	FrameRing::initStatics();
+	MeshPool::initStatics();
+	IndirectDrawer::initStatics();
+	DebugDraw::initStatics();
 
 	prevTime = (float)glfwGetTime();
 	
-	//Init Gaussian Blur buffers and shader
+	//Init frame buffers and post processing
 	initFrameBufferObjects();
 
 	//create scene
@@ -104,13 +122,20 @@ void SceneManager::dispose() {
 	frameTexture.disposeCurrentTexture();
 	glDeleteBuffers(1, &renderBufferID);
 	glDeleteBuffers(1, &frameBufferID);
+	gBuffer.dispose();
 	glDeleteBuffers(1, &VBO_SceenQuadPositions);
 	glDeleteBuffers(1, &EB0_ScreenQuad);
-	glDeleteVertexArrays(1, &VAO_ScreenQuad);
-	glDeleteProgram(blurShaderProgram);
-
+	GLState::deleteVertexArrays(1, &VAO_ScreenQuad);
+	postProcess.dispose();
+
+	DebugDraw::cleanUpStatics();
+	IndirectDrawer::cleanUpStatics();
+	MeshPool::cleanUpStatics();
+	FrameRing::cleanUpStatics();
+	OcclusionQueryManager::cleanUpStatics();
 	ShadowMap::cleanUpStatics();
 	Material::cleanUpStatics();
+	JobSystem::dispose();
 
 	glfwDestroyWindow(window);
 }
@@ -125,41 +150,37 @@ void SceneManager::update() {
 }
 void SceneManager::draw() {
 
+	//state calls are counted per frame, transient data starts over in the next ring region
+	GLState::beginFrame();
+	FrameRing::beginFrame();
+
 	//calc shadow maps before doing any drawing
 	currScene->calcShadowMaps();
 
 	//set display matrix for window screen
 	glViewport(0, 0, SceneManager::windowWidth, SceneManager::windowHeight);
 
-	//draw scene to frame buffer's screen texture
-	glBindFramebuffer(GL_FRAMEBUFFER, frameBufferID);
+	//draw scene to frame buffer's screen texture, or to the G-buffer to be lit into it
+	if (Material::isDeferred()) {
+		gBuffer.bindForWriting();
+	}
+	else {
+		glBindFramebuffer(GL_FRAMEBUFFER, frameBufferID);
+	}
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	
 	currScene->draw();
 
-	
-	//Draw frame buffer's frame texture to window
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	
-	//use the blur shader program
-	glUseProgram(blurShaderProgram);	
+	if (Material::isDeferred()) {
+		drawDeferredLighting();
+	}
 
-	//send frame buffer's frame texture to blur shader
-	glUniform1i(glGetUniformLocation(blurShaderProgram, "texture"), 0);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, frameTexture.getID());
 	
-	//send current camera's blur radius value to blur shader
-	glUniform1f(glGetUniformLocation(blurShaderProgram, "blurRadius"), currScene->getActiveCamera()->getBlurValue());
+	//blur frame buffer's frame texture into the window, or copy it when the camera has no blur
+	postProcess.apply(frameBufferID, currScene->getActiveCamera()->getBlurValue(), VAO_ScreenQuad);
 
-	//bind and draw screen quad
-	glBindVertexArray(VAO_ScreenQuad);
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-	//unbind screen quad
-	glBindVertexArray(0);
-	
+	//everything written into the ring this frame has been drawn from
+	FrameRing::endFrame();
 
 	// Gets events, including input such as keyboard and mouse or window resizing
 	glfwPollEvents();
@@ -215,10 +236,38 @@ bool SceneManager::isWindowOpen() {
 float SceneManager::getDeltaTime(){
 	return deltaTime;
 }
+PostProcess* SceneManager::getPostProcess() {
+	return &postProcess;
+}
 
 
 //PRIVATE HELPERS
 
+/*one screen pass over the G-buffer, lights were already sent to the lighting
+program while the scene drew*/
+void SceneManager::drawDeferredLighting() {
+
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBufferID);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	GLuint lightingProgram = Material::getDeferredLightingProgram();
+	GLState::useProgram(lightingProgram);
+	gBuffer.applySettings(lightingProgram);
+
+	//camera properties, plus the inverse to rebuild world positions from depth
+	Camera* activeCamera = currScene->getActiveCamera();
+	activeCamera->applySettings(lightingProgram);
+	glm::mat4 inverseViewProjection = glm::inverse(activeCamera->getProjectionMatrix() * activeCamera->getViewMatrix());
+	glUniformMatrix4fv(glGetUniformLocation(lightingProgram, "inverseViewProjection"), 1, GL_FALSE, &inverseViewProjection[0][0]);
+
+	//every pixel is covered once, depth is not needed
+	GLState::disable(GL_DEPTH_TEST);
+	GLState::bindVertexArray(VAO_ScreenQuad);
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+	GLState::bindVertexArray(0);
+	GLState::enable(GL_DEPTH_TEST);
+}
+
 void SceneManager::initFrameBufferObjects() {
 
 	//generate since they will be deleted during resize
@@ -237,7 +286,7 @@ void SceneManager::initFrameBufferObjects() {
 
 	//VAO
 	glGenVertexArrays(1, &VAO_ScreenQuad);
-	glBindVertexArray(VAO_ScreenQuad);
+	GLState::bindVertexArray(VAO_ScreenQuad);
 
 	//VBO
 	glGenBuffers(1, &VBO_SceenQuadPositions);
@@ -253,10 +302,10 @@ void SceneManager::initFrameBufferObjects() {
 
 	// Unbind the currently bound buffer so that we don't accidentally make unwanted changes to it.
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	GLState::bindVertexArray(0);
 
-	//set up blur shader
-	blurShaderProgram = LoadShaders("../shader_blur.vert", "../shader_blur.frag");
+	//set up blur shaders, its levels are made on resize
+	postProcess.init();
 
 }
 
@@ -274,7 +323,7 @@ void SceneManager::resizeFrameBufferObjects() {
 
 	//Frame texture
 	frameTexture.generatePlainTexture();
-	glBindTexture(GL_TEXTURE_2D, frameTexture.getID());
+	GLState::bindTexture(GL_TEXTURE_2D, frameTexture.getID());
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, windowWidth, windowHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -294,4 +343,10 @@ void SceneManager::resizeFrameBufferObjects() {
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
 		exit(1);
 	}
+
+	//G-buffer always follows the window so the deferred path can be switched on at any time
+	gBuffer.resize(windowWidth, windowHeight);
+
+	//blur levels are halvings of the window
+	postProcess.resize(windowWidth, windowHeight);
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <GLFW/glfw3.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include "Texture.h"
+#include "GBuffer.h"
+#include "PostProcess.h"
 class Scene;
 class SceneManager {
 
@@ -19,8 +21,7 @@ class SceneManager {
 	static Scene* currScene;
 
 	
-	//Gaussian Blur Data
-	static GLuint blurShaderProgram;
+	//Frame Data, the scene is drawn into the frame texture then blurred into the window
 	static GLuint frameBufferID;
 	static Texture frameTexture;
 	static GLuint renderBufferID;
@@ -30,6 +31,12 @@ class SceneManager {
 	static GLfloat screenQuadVertexPositions[];
 	static GLuint EB0_ScreenQuad;
 	static GLuint meshIndices[];
+
+	//Deferred Shading Data, lit into the frame texture before the blur
+	static GBuffer gBuffer;
+
+	//Camera blur from the frame texture to the window
+	static PostProcess postProcess;
 	
 	static float testFloat[1];
 
@@ -55,9 +62,11 @@ public:
 
 	//Utilities 
 	static float getDeltaTime();
+	static PostProcess* getPostProcess();
 
 private:
 
 	static void initFrameBufferObjects();
 	static void resizeFrameBufferObjects();
+	static void drawDeferredLighting();
 };
\ No newline at end of file
@@ -1,16 +1,48 @@
 #include "SceneObject.h"
 #include "Scene.h"
+#include "JobSystem.h"
+#include <algorithm>
 
 SceneObject::SceneObject() {
 	local_position = glm::vec3(0, 0, 0);
 	local_rotation = glm::mat4(1.0f);
 	local_scale = glm::vec3(1, 1, 1);
 	parentToWorld = glm::mat4(1.0f);
-	updateAllMatrices();
+	parent = NULL;
+	scene = NULL;
+	subtreeSize = 1;
+	transformVersion = 0;
+	castsShadows = true;
+	staticShadowCaster = false;
+	updateLocalMatrix();
+	toWorld = toParent;
+	hasWorldBounds = false;
+	hasSubtreeBounds = false;
+}
+//takes the subtree out of the scene, the children are left without a parent
+SceneObject::~SceneObject() {
+
+	if (scene != NULL && parent == NULL) {
+		scene->removeRoot(this);
+	}
+	else {
+		leaveScene();
+	}
+
+	if (parent != NULL) {
+		std::vector<SceneObject*>& siblings = parent->children;
+		siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+		for (SceneObject* ancestor = parent; ancestor != NULL; ancestor = ancestor->parent) {
+			ancestor->subtreeSize -= subtreeSize;
+		}
+	}
+	for (unsigned int i = 0; i < children.size(); ++i) {
+		children[i]->parent = NULL;
+	}
 }
 void SceneObject::setLocalPosition(glm::vec3 pos) {
 	local_position = pos;
-	updateAllMatrices();
+	updateLocalMatrix();
 }
 glm::vec3 SceneObject::getPosition(unsigned int coordinate_space) {
 
@@ -20,7 +52,7 @@ glm::vec3 SceneObject::getPosition(unsigned int coordinate_space) {
 	else if (coordinate_space == SceneObject::WORLD) {
 
 		glm::vec3 translation;
-		glm::decompose(toWorld, glm::vec3(0,0,0), glm::quat(), translation, glm::vec3(0, 0, 0), glm::vec4(0, 0, 0,0));
+		glm::decompose(getToWorld(), glm::vec3(0,0,0), glm::quat(), translation, glm::vec3(0, 0, 0), glm::vec4(0, 0, 0,0));
 		return translation;
 	}
 	else {
@@ -30,7 +62,7 @@ glm::vec3 SceneObject::getPosition(unsigned int coordinate_space) {
 }
 void SceneObject::setLocalRotation(glm::mat4 rot) {
 	local_rotation = rot;
-	updateAllMatrices();
+	updateLocalMatrix();
 }
 glm::mat4 SceneObject::getRotation(unsigned int coordinate_space) {
 	if (coordinate_space == SceneObject::OBJECT) {
@@ -39,7 +71,7 @@ glm::mat4 SceneObject::getRotation(unsigned int coordinate_space) {
 	else if (coordinate_space == SceneObject::WORLD) {
 
 		glm::quat rotation;
-		glm::decompose(toWorld, glm::vec3(0, 0, 0), rotation, glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec4(0, 0, 0, 0));
+		glm::decompose(getToWorld(), glm::vec3(0, 0, 0), rotation, glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec4(0, 0, 0, 0));
 		return glm::toMat4(glm::conjugate(rotation));
 	}
 	else {
@@ -49,7 +81,7 @@ glm::mat4 SceneObject::getRotation(unsigned int coordinate_space) {
 }
 void SceneObject::setLocalScale(glm::vec3 sca) {
 	local_scale = sca;
-	updateAllMatrices();
+	updateLocalMatrix();
 }
 glm::vec3 SceneObject::getScale(unsigned int coordinate_space) {
 	if (coordinate_space == SceneObject::OBJECT) {
@@ -58,7 +90,7 @@ glm::vec3 SceneObject::getScale(unsigned int coordinate_space) {
 	else if (coordinate_space == SceneObject::WORLD) {
 
 		glm::vec3 scale;
-		glm::decompose(toWorld, scale, glm::quat(), glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec4(0, 0, 0, 0));
+		glm::decompose(getToWorld(), scale, glm::quat(), glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec4(0, 0, 0, 0));
 		return scale;
 	}
 	else {
@@ -67,49 +99,264 @@ glm::vec3 SceneObject::getScale(unsigned int coordinate_space) {
 	}
 }
 
+//resolves through dirty ancestors so reads between a set and the next scene update are current
 glm::mat4 SceneObject::getToWorld() const {
-	return toWorld;
+
+	if (!isWorldTransformStale()) {
+		return toWorld;
+	}
+	if (parent != NULL) {
+		return parent->getToWorld() * toParent;
+	}
+	return parentToWorld * toParent;
+}
+unsigned int SceneObject::getTransformVersion() const {
+	return transformVersion;
+}
+bool SceneObject::getWorldBounds(AABB& bounds) const {
+	bounds = worldBounds;
+	return hasWorldBounds;
+}
+bool SceneObject::getSubtreeBounds(AABB& bounds) const {
+	bounds = subtreeBounds;
+	return hasSubtreeBounds;
 }
 void SceneObject::addChild(SceneObject* newChild) {
 	children.push_back(newChild);
-	newChild->updateParentToWorldMatrix(toWorld);
+	newChild->parent = this;
+	newChild->parentToWorld = getToWorld();
+	newChild->transformDirty = true;
+
+	//keep subtree sizes of all ancestors current for job splitting
+	for (SceneObject* ancestor = this; ancestor != NULL; ancestor = ancestor->parent) {
+		ancestor->subtreeSize += newChild->subtreeSize;
+	}
+
+	if (scene != NULL) {
+		newChild->joinScene(scene);
+	}
+}
+
+void SceneObject::joinScene(Scene* new_scene) {
+	scene = new_scene;
+	scene->addObject(this);
+	for (unsigned int i = 0; i < children.size(); ++i) {
+		children[i]->joinScene(new_scene);
+	}
+}
+void SceneObject::leaveScene() {
+	if (scene == NULL) {
+		return;
+	}
+	scene->removeObject(this);
+	scene = NULL;
+	for (unsigned int i = 0; i < children.size(); ++i) {
+		children[i]->leaveScene();
+	}
+}
+
+//appends this object and every descendant
+void SceneObject::getSubtreeObjects(std::vector<SceneObject*>& objects) {
+	objects.push_back(this);
+	for (unsigned int i = 0; i < children.size(); ++i) {
+		children[i]->getSubtreeObjects(objects);
+	}
+}
+
+/*recompute toWorld for this object and its descendants if anything on the way changed.
+Children with large subtrees are handed to the job system, the rest are walked inline*/
+void SceneObject::updateWorldTransforms(bool parent_changed) {
+
+	bool changed = transformDirty || parent_changed;
+	if (changed) {
+		toWorld = parentToWorld * toParent;
+		++transformVersion;
+	}
+	transformDirty = false;
+
+	JobSystem::Counter childrenDone;
+	for (unsigned int i = 0; i < children.size(); ++i) {
+
+		SceneObject* child = children[i];
+		if (changed) {
+			child->parentToWorld = toWorld;
+		}
+
+		if (child->subtreeSize >= PARALLEL_SUBTREE_SIZE) {
+			JobSystem::run([child, changed]() { child->updateWorldTransforms(changed); }, &childrenDone);
+		}
+		else {
+			child->updateWorldTransforms(changed);
+		}
+	}
+	JobSystem::wait(&childrenDone);
+
+	//children are done, their subtree bounds can be merged into ours
+	updateBounds(changed);
 }
 
 //Protected, accessible by subclasses
 void SceneObject::setToWorld(glm::mat4 newToWorld) {
 	toWorld = newToWorld;
+	++transformVersion;
+	transformDirty = false;
 	for (unsigned int i = 0; i < children.size(); ++i) {
 		children[i]->updateParentToWorldMatrix(toWorld);
 	}
+	updateBounds(true);
 }
 //Private Helper
+
 void SceneObject::updateParentToWorldMatrix(glm::mat4 parent_to_world) {
 	parentToWorld = parent_to_world;
-	updateAllMatrices();
+	updateWorldTransforms(true);
 }
 
 
-void SceneObject::updateAllMatrices() {
+void SceneObject::updateLocalMatrix() {
 
 	toParent = glm::translate(glm::mat4(1.0f), local_position) * local_rotation * glm::scale(glm::mat4(1.0f), local_scale);
-	toWorld = parentToWorld * toParent;
+	transformDirty = true;
+}
 
-	for (unsigned int i = 0; i < children.size(); ++i) {
-		children[i]->updateParentToWorldMatrix(toWorld);
+bool SceneObject::isWorldTransformStale() const {
+
+	for (const SceneObject* curr = this; curr != NULL; curr = curr->parent) {
+		if (curr->transformDirty) {
+			return true;
+		}
 	}
+	return false;
 }
 
-void SceneObject::drawToShadowMap() {
-	sendThisGeometryToShadowMap();
-	for (unsigned int i = 0; i < children.size(); ++i) {
-		children[i]->drawToShadowMap();
+void SceneObject::updateBounds(bool transform_changed) {
+
+	if (transform_changed) {
+		AABB localBounds;
+		hasWorldBounds = getLocalBounds(localBounds);
+		if (hasWorldBounds) {
+			worldBounds = localBounds.transformed(toWorld);
+		}
 	}
 
+	//an unbounded object anywhere below makes the whole subtree unbounded
+	hasSubtreeBounds = hasWorldBounds;
+	subtreeBounds = worldBounds;
+	for (unsigned int i = 0; i < children.size() && hasSubtreeBounds; ++i) {
+		hasSubtreeBounds = children[i]->hasSubtreeBounds;
+		subtreeBounds.merge(children[i]->subtreeBounds);
+	}
+}
+
+BoundingBox* SceneObject::getBoundingBox() {
+	return NULL;
+}
+
+//objects without geometry of their own are never culled
+bool SceneObject::getLocalBounds(AABB&) const {
+	return false;
+}
+
+//objects that draw nothing into shadow maps opt out so their moves don't invalidate them
+void SceneObject::setCastsShadows(bool opt) {
+	castsShadows = opt;
+}
+bool SceneObject::isShadowCaster() const {
+	return castsShadows;
+}
+
+//static casters only need redrawing when they or the light move
+void SceneObject::setStaticShadowCaster(bool opt) {
+	staticShadowCaster = opt;
+}
+bool SceneObject::isStaticShadowCaster() const {
+	return staticShadowCaster;
+}
+/*only casters that belong to the caster set the scene is currently drawing are
+sent, the scene also uses this walk to track caster changes*/
+void SceneObject::drawToShadowMap(Scene* currScene) {
+	drawShadowCasters(currScene, false);
+}
+
+//only objects that opt in as occluders add geometry
+void SceneObject::drawToOcclusionBuffer(OcclusionBuffer* buffer) {
+	sendThisGeometryToOcclusionBuffer(buffer);
+	for (unsigned int i = 0; i < children.size(); ++i) {
+		children[i]->drawToOcclusionBuffer(buffer);
+	}
 }
+void SceneObject::sendThisGeometryToOcclusionBuffer(OcclusionBuffer*) {}
 
 void SceneObject::draw(Scene* currScene) {
-	drawThisSceneObject(currScene);
+	drawVisible(currScene, false);
+}
+
+/*hierarchical frustum culling: a subtree entirely outside is skipped in one test,
+one entirely inside draws without testing any of its descendants*/
+void SceneObject::drawVisible(Scene* currScene, bool fully_visible) {
+
+	bool testing = !fully_visible && currScene->isFrustumCullingEnabled();
+
+	if (testing && hasSubtreeBounds) {
+		int result = currScene->classifyVisibility(subtreeBounds);
+		if (result == Frustum::OUTSIDE) {
+			currScene->reportCulled(subtreeSize);
+			return;
+		}
+		fully_visible = result == Frustum::INSIDE;
+		testing = !fully_visible;
+	}
+
+	//the subtree is visible, this object's own geometry may still not be
+	if (testing && hasWorldBounds && currScene->classifyVisibility(worldBounds) == Frustum::OUTSIDE) {
+		currScene->reportCulled(1);
+	}
+	else {
+		drawThisSceneObject(currScene);
+	}
+
 	for (unsigned int i = 0; i < children.size(); ++i) {
-		children[i]->draw(currScene);
+		children[i]->drawVisible(currScene, fully_visible);
 	}
-}
\ No newline at end of file
+}
+
+/*same hierarchical test as drawVisible, against the volume of the shadow view
+being drawn. The census walk sees every caster, it isn't culled*/
+void SceneObject::drawShadowCasters(Scene* currScene, bool fully_inside) {
+
+	bool testing = !fully_inside && currScene->isShadowCullingActive();
+
+	if (testing && hasSubtreeBounds) {
+		int result = currScene->classifyShadowCaster(subtreeBounds);
+		if (result == Frustum::OUTSIDE) {
+			currScene->reportShadowCulled(subtreeSize);
+			return;
+		}
+		fully_inside = result == Frustum::INSIDE;
+		testing = !fully_inside;
+	}
+
+	if (castsShadows && currScene->acceptShadowCaster(this)) {
+		if (testing && hasWorldBounds && currScene->classifyShadowCaster(worldBounds) == Frustum::OUTSIDE) {
+			currScene->reportShadowCulled(1);
+		}
+		else if (currScene->isLayeredShadowPass()) {
+			//only the cube faces its bounds reach, the geometry shader culls the triangles within them
+			int faceMask = hasWorldBounds ? currScene->getShadowFaceMask(worldBounds) : (1 << ShadowMap::MAX_VIEWS) - 1;
+			if (faceMask == 0) {
+				currScene->reportShadowCulled(1);
+			}
+			else {
+				ShadowMap::applyFaceMask(faceMask);
+				sendThisGeometryToShadowMap();
+			}
+		}
+		else {
+			sendThisGeometryToShadowMap();
+		}
+	}
+
+	for (unsigned int i = 0; i < children.size(); ++i) {
+		children[i]->drawShadowCasters(currScene, fully_inside);
+	}
+}
@@ -3,7 +3,10 @@
 #include <glm/gtx/matrix_decompose.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <vector>
+#include "AABB.h"
 class Scene;
+class OcclusionBuffer;
+class BoundingBox;
 class SceneObject {
 
 protected:
@@ -15,16 +18,39 @@ protected:
 
 	glm::mat4 toParent;			//local coordinates
 	glm::mat4 parentToWorld;	//parent's toWorld
+	SceneObject* parent;
 	std::vector<SceneObject*> children;
+	Scene* scene;				//scene whose graph this object is in, NULL until it is under one of its roots
 
 	glm::mat4 toWorld;			//global coordinates
 
+	//world matrices are propagated once per frame by the scene, not on every set
+	bool transformDirty;
+	unsigned int subtreeSize;	//this object plus all descendants
+	unsigned int transformVersion;	//bumped whenever toWorld changes, for caches built from it
+
+	//objects without shadow geometry opt out, shadow passes skip them without a virtual call
+	bool castsShadows;
+
+	//static casters are kept in each shadow map's cached static depth
+	bool staticShadowCaster;
+
+	//subtrees at least this big are propagated on their own job
+	const static unsigned int PARALLEL_SUBTREE_SIZE = 256;
+
+	//world space bounds of this object and of everything below it, for culling
+	AABB worldBounds;
+	bool hasWorldBounds;		//false for objects that are visible from anywhere
+	AABB subtreeBounds;
+	bool hasSubtreeBounds;
 
 public:
 
 	enum CoordMode {OBJECT, WORLD};
 
 	SceneObject();
+	SceneObject(const SceneObject& other) = delete;
+	virtual ~SceneObject();
 	void setLocalPosition(glm::vec3 pos);
 	glm::vec3 getPosition(unsigned int coordinate_space);
 	void setLocalRotation(glm::mat4 rot);
@@ -32,10 +58,29 @@ public:
 	void setLocalScale(glm::vec3 sca);
 	glm::vec3 getScale(unsigned int coordinate_space);
 	glm::mat4 getToWorld() const;
+	unsigned int getTransformVersion() const;
+	bool getWorldBounds(AABB& bounds) const;
+	bool getSubtreeBounds(AABB& bounds) const;
+
+	//box the scene collides this object with, NULL for objects that don't collide
+	virtual BoundingBox* getBoundingBox();
 
 	void addChild(SceneObject* newChild);
-	
-	void drawToShadowMap();
+
+	//called by the scene as its roots come and go, children follow their parent
+	void joinScene(Scene* new_scene);
+	void leaveScene();
+	void getSubtreeObjects(std::vector<SceneObject*>& objects);
+
+	void updateWorldTransforms(bool parent_changed);
+
+	void setCastsShadows(bool opt);
+	bool isShadowCaster() const;
+	void setStaticShadowCaster(bool opt);
+	bool isStaticShadowCaster() const;
+
+	void drawToShadowMap(Scene* currScene);
+	void drawToOcclusionBuffer(OcclusionBuffer* buffer);
 	void draw(Scene* currScene);
 
 protected:
@@ -43,8 +88,16 @@ protected:
 
 private:
 	void updateParentToWorldMatrix(glm::mat4 parent_to_world);
-	void updateAllMatrices();
+	void updateLocalMatrix();
+	bool isWorldTransformStale() const;
+	void updateBounds(bool transform_changed);
+	void drawVisible(Scene* currScene, bool fully_visible);
+	void drawShadowCasters(Scene* currScene, bool fully_inside);
+
+	//object space bounds of this object's own geometry, false if it has none
+	virtual bool getLocalBounds(AABB& bounds) const;
 	virtual void sendThisGeometryToShadowMap() = 0;
+	virtual void sendThisGeometryToOcclusionBuffer(OcclusionBuffer* buffer);
 	virtual void drawThisSceneObject(Scene* currScene) = 0;
-		
+
 };
\ No newline at end of file
@@ -0,0 +1,497 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include "ShadowAtlas.h"
+#include "shader.h"
+#include "GLState.h"
+using namespace std;
+
+//matrix to put coords range 0-1 to sample shadow map
+glm::mat4 ShadowAtlas::biasMatrix = glm::mat4(
+	0.5, 0.0, 0.0, 0.0,
+	0.0, 0.5, 0.0, 0.0,
+	0.0, 0.0, 0.5, 0.0,
+	0.5, 0.5, 0.5, 1.0
+);
+
+ShadowAtlas::ShadowAtlas() {
+	resolution = 4096;
+	frameBuffer = 0;
+	staticFrameBuffer = 0;
+	viewDataBuffer = 0;
+	viewDataTexture = 0;
+	slopeBias = 2.0f;
+	constantBias = 4.0f;
+	exponential = false;
+	exponentialProgram = 0;
+	exponentialFrameBuffer = 0;
+	quadVAO = quadVBO = 0;
+}
+
+void ShadowAtlas::init(GLuint atlas_resolution) {
+
+	resolution = atlas_resolution;
+	initFrameBuffer(frameBuffer, depthTexture);
+	initFrameBuffer(staticFrameBuffer, staticDepthTexture);
+
+	glGenBuffers(1, &viewDataBuffer);
+	glGenTextures(1, &viewDataTexture);
+
+	//buffer needs storage before the texture can point at it
+	uploadViewData();
+	GLState::bindTexture(GL_TEXTURE_BUFFER, viewDataTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, viewDataBuffer);
+	GLState::bindTexture(GL_TEXTURE_BUFFER, 0);
+
+	invalidate();
+}
+
+void ShadowAtlas::dispose() {
+
+	depthTexture.disposeCurrentTexture();
+	staticDepthTexture.disposeCurrentTexture();
+	if (frameBuffer != 0) {
+		glDeleteFramebuffers(1, &frameBuffer);
+		frameBuffer = 0;
+	}
+	if (staticFrameBuffer != 0) {
+		glDeleteFramebuffers(1, &staticFrameBuffer);
+		staticFrameBuffer = 0;
+	}
+	GLState::deleteTextures(1, &viewDataTexture);
+	glDeleteBuffers(1, &viewDataBuffer);
+	viewDataTexture = viewDataBuffer = 0;
+	cache.clear();
+
+	if (exponential) {
+		exponentialTexture.disposeCurrentTexture();
+		glDeleteFramebuffers(1, &exponentialFrameBuffer);
+		GLState::deleteProgram(exponentialProgram);
+		GLState::deleteVertexArrays(1, &quadVAO);
+		glDeleteBuffers(1, &quadVBO);
+		exponentialFrameBuffer = 0;
+		exponential = false;
+	}
+}
+
+GLuint ShadowAtlas::getResolution() {
+	return resolution;
+}
+
+void ShadowAtlas::beginFrame() {
+	requests.clear();
+	drawnTiles.clear();
+}
+
+//sizes are rounded down to a power of two the atlas can hold
+int ShadowAtlas::request(GLuint tile_size, float importance) {
+
+	GLuint size = MIN_TILE_SIZE;
+	while (size * 2 <= tile_size && size * 2 <= resolution) {
+		size *= 2;
+	}
+
+	Request r;
+	r.size = size;
+	r.importance = importance;
+	requests.push_back(r);
+	return requests.size() - 1;
+}
+
+/*shrink until the requests fit, then place them. Sorted largest first, each
+tile's Z order offset is a multiple of its own area, which puts it on a corner
+aligned to its size*/
+void ShadowAtlas::pack() {
+
+	GLuint cellsPerSide = resolution / MIN_TILE_SIZE;
+	GLuint capacity = cellsPerSide * cellsPerSide;
+
+	std::vector<GLuint> sizes(requests.size());
+	GLuint used = 0;
+	for (unsigned int i = 0; i < requests.size(); ++i) {
+		sizes[i] = requests[i].size;
+		used += (sizes[i] / MIN_TILE_SIZE) * (sizes[i] / MIN_TILE_SIZE);
+	}
+
+	while (used > capacity) {
+
+		//largest tile gives up half its side first, the least important among equals
+		int shrink = -1;
+		for (unsigned int i = 0; i < sizes.size(); ++i) {
+			if (sizes[i] == 0) {
+				continue;
+			}
+			if (shrink == -1 || sizes[i] > sizes[shrink] || (sizes[i] == sizes[shrink] && requests[i].importance < requests[shrink].importance)) {
+				shrink = i;
+			}
+		}
+		GLuint cells = sizes[shrink] / MIN_TILE_SIZE;
+		used -= cells * cells;
+		sizes[shrink] = sizes[shrink] > MIN_TILE_SIZE ? sizes[shrink] / 2 : 0;
+		cells = sizes[shrink] / MIN_TILE_SIZE;
+		used += cells * cells;
+	}
+
+	std::vector<int> order(requests.size());
+	for (unsigned int i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&sizes](int a, int b) { return sizes[a] > sizes[b]; });
+
+	tiles.assign(requests.size(), Tile());
+	GLuint offset = 0;
+	for (unsigned int i = 0; i < order.size(); ++i) {
+		Tile& tile = tiles[order[i]];
+		tile.size = sizes[order[i]];
+		tile.x = tile.y = 0;
+		if (tile.size == 0) {
+			continue;
+		}
+		tile.x = compactBits(offset) * MIN_TILE_SIZE;
+		tile.y = compactBits(offset >> 1) * MIN_TILE_SIZE;
+		offset += (tile.size / MIN_TILE_SIZE) * (tile.size / MIN_TILE_SIZE);
+	}
+
+	viewProjections.assign(requests.size(), glm::mat4(1.0f));
+	viewData.assign(requests.size() * VIEW_TEXELS, glm::vec4(0, 0, 0, 0));
+	tileFilters.assign(requests.size(), HARD_SHADOWS);
+	if (cache.size() < requests.size()) {
+		CacheEntry entry = CacheEntry();
+		cache.resize(requests.size(), entry);
+	}
+
+	//others may draw over where a dropped tile was
+	for (unsigned int i = 0; i < tiles.size(); ++i) {
+		if (tiles[i].size == 0) {
+			cache[i].staticValid = false;
+			cache[i].valid = false;
+		}
+	}
+
+	//entries are kept by request number, ones past this frame's requests may be reused by another view later
+	for (unsigned int i = requests.size(); i < cache.size(); ++i) {
+		cache[i].staticValid = false;
+		cache[i].valid = false;
+	}
+}
+
+ShadowAtlas::Tile ShadowAtlas::getTile(int tile) {
+	return tiles[tile];
+}
+unsigned int ShadowAtlas::getNumTiles() {
+	return tiles.size();
+}
+
+void ShadowAtlas::setViewProjection(int tile, const glm::mat4& view_projection) {
+
+	viewProjections[tile] = view_projection;
+
+	//0-1 light space squeezed into the tile's part of the atlas
+	float scale = (float)tiles[tile].size / resolution;
+	glm::mat4 tileMatrix = glm::translate(glm::mat4(1.0f), glm::vec3((float)tiles[tile].x / resolution, (float)tiles[tile].y / resolution, 0));
+	tileMatrix = glm::scale(tileMatrix, glm::vec3(scale, scale, 1));
+	glm::mat4 atlasMatrix = tileMatrix * biasMatrix * view_projection;
+
+	for (int i = 0; i < 4; ++i) {
+		viewData[tile * VIEW_TEXELS + i] = atlasMatrix[i];
+	}
+
+	//half a texel in, so lookups near the edge never read the neighbouring tile
+	viewData[tile * VIEW_TEXELS + 4] = glm::vec4(
+		(tiles[tile].x + 0.5f) / resolution, (tiles[tile].y + 0.5f) / resolution,
+		(tiles[tile].x + tiles[tile].size - 0.5f) / resolution, (tiles[tile].y + tiles[tile].size - 0.5f) / resolution);
+}
+
+/*radius is in atlas texels. Poisson kernels take that many samples, up to
+MAX_POISSON_SAMPLES, and exponential maps read the mip level whose texels span it*/
+void ShadowAtlas::setViewFilter(int tile, int filter, float radius_texels, int samples) {
+
+	if (filter == EXPONENTIAL_SHADOWS && !exponential) {
+		initExponential();
+	}
+	tileFilters[tile] = filter;
+
+	float detail = 0;
+	if (filter == POISSON_SHADOWS) {
+		detail = (float)glm::clamp(samples, 1, (int)MAX_POISSON_SAMPLES);
+	}
+	else if (filter == EXPONENTIAL_SHADOWS) {
+		detail = std::log2(glm::max(radius_texels, 1.0f));
+	}
+	viewData[tile * VIEW_TEXELS + 5] = glm::vec4((float)filter, radius_texels / resolution, detail, 0);
+}
+
+//polygon offset in units of the depth's slope and of its smallest step
+void ShadowAtlas::setDepthBias(float slope_bias, float constant_bias) {
+	slopeBias = slope_bias;
+	constantBias = constant_bias;
+}
+
+void ShadowAtlas::uploadViewData() {
+
+	size_t size = viewData.size() * sizeof(glm::vec4);
+	glBindBuffer(GL_TEXTURE_BUFFER, viewDataBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max(size, (size_t)16), NULL, GL_STREAM_DRAW);
+	if (size > 0) {
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, size, viewData.data());
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ShadowAtlas::applySettings(GLuint shader_program, int atlas_unit) {
+
+	glUniform1i(glGetUniformLocation(shader_program, "shadowAtlas"), atlas_unit);
+	glUniform1i(glGetUniformLocation(shader_program, "shadowExpAtlas"), atlas_unit + 1);
+	glUniform1i(glGetUniformLocation(shader_program, "shadowViews"), VIEW_DATA_UNIT);
+
+	GLState::activeTexture(GL_TEXTURE0 + atlas_unit);
+	GLState::bindTexture(GL_TEXTURE_2D, depthTexture.getID());
+	GLState::activeTexture(GL_TEXTURE0 + atlas_unit + 1);
+	GLState::bindTexture(GL_TEXTURE_2D, exponential ? exponentialTexture.getID() : 0);
+	GLState::activeTexture(GL_TEXTURE0 + VIEW_DATA_UNIT);
+	GLState::bindTexture(GL_TEXTURE_BUFFER, viewDataTexture);
+	GLState::activeTexture(GL_TEXTURE0);
+}
+
+/*a tile's contents are fixed by where it sits, its matrices and signatures over
+the casters' transforms. Tiles keep their place while the budget doesn't change*/
+bool ShadowAtlas::isCacheValid(int tile, unsigned long long static_signature, unsigned long long dynamic_signature) {
+	return cache[tile].valid && isStaticCacheValid(tile, static_signature) && cache[tile].dynamicSignature == dynamic_signature;
+}
+bool ShadowAtlas::isStaticCacheValid(int tile, unsigned long long static_signature) {
+	const CacheEntry& entry = cache[tile];
+	return entry.staticValid && entry.staticSignature == static_signature
+		&& entry.tile.x == tiles[tile].x && entry.tile.y == tiles[tile].y && entry.tile.size == tiles[tile].size
+		&& memcmp(&entry.viewProjection, &viewProjections[tile], sizeof(glm::mat4)) == 0;
+}
+
+void ShadowAtlas::beginStaticPass(int tile) {
+
+	glBindFramebuffer(GL_FRAMEBUFFER, staticFrameBuffer);
+	applyTileViewport(tile);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	GLState::enable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(slopeBias, constantBias);
+}
+
+//start from the cached static depth, dynamic casters are drawn on top
+void ShadowAtlas::beginDynamicPass(int tile) {
+
+	const Tile& t = tiles[tile];
+	applyTileViewport(tile);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFrameBuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffer);
+	glBlitFramebuffer(t.x, t.y, t.x + t.size, t.y + t.size, t.x, t.y, t.x + t.size, t.y + t.size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+
+	GLState::enable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(slopeBias, constantBias);
+}
+
+bool ShadowAtlas::supportsLayeredPasses() {
+	return GLEW_ARB_viewport_array ? true : false;
+}
+
+//clears only see the first scissor box, so tiles are cleared one at a time first
+void ShadowAtlas::beginLayeredStaticPass(const int* tile_list, int count) {
+
+	glBindFramebuffer(GL_FRAMEBUFFER, staticFrameBuffer);
+	for (int i = 0; i < count; ++i) {
+		applyTileViewport(tile_list[i]);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+	applyLayeredViewports(tile_list, count);
+
+	GLState::enable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(slopeBias, constantBias);
+}
+
+void ShadowAtlas::beginLayeredDynamicPass(const int* tile_list, int count) {
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFrameBuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffer);
+	for (int i = 0; i < count; ++i) {
+		const Tile& t = tiles[tile_list[i]];
+		applyTileViewport(tile_list[i]);
+		glBlitFramebuffer(t.x, t.y, t.x + t.size, t.y + t.size, t.x, t.y, t.x + t.size, t.y + t.size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+	applyLayeredViewports(tile_list, count);
+
+	GLState::enable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(slopeBias, constantBias);
+}
+
+void ShadowAtlas::markCached(int tile, unsigned long long static_signature, unsigned long long dynamic_signature) {
+	CacheEntry& entry = cache[tile];
+	entry.staticValid = true;
+	entry.valid = true;
+	entry.tile = tiles[tile];
+	entry.viewProjection = viewProjections[tile];
+	entry.staticSignature = static_signature;
+	entry.dynamicSignature = dynamic_signature;
+	drawnTiles.push_back(tile);
+}
+
+void ShadowAtlas::endPasses() {
+	GLState::disable(GL_SCISSOR_TEST);
+	GLState::disable(GL_POLYGON_OFFSET_FILL);
+	if (exponential) {
+		convertToExponential();
+	}
+}
+
+void ShadowAtlas::invalidate() {
+	for (unsigned int i = 0; i < cache.size(); ++i) {
+		cache[i].staticValid = false;
+		cache[i].valid = false;
+	}
+}
+
+Texture ShadowAtlas::getDepthTexture() {
+	return depthTexture;
+}
+
+//PRIVATE HELPERS
+
+void ShadowAtlas::initFrameBuffer(GLuint& frame_buffer, Texture& depth_texture) {
+
+	glGenFramebuffers(1, &frame_buffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+
+	depth_texture.generatePlainTexture();
+	GLState::bindTexture(GL_TEXTURE_2D, depth_texture.getID());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, resolution, resolution, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+
+	//sampler2DShadow lookups compare in hardware, linear filtering blends four results
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	//attach texture to frame buffer
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_texture.getID(), 0);
+
+	glDrawBuffer(GL_NONE); // No color buffer is drawn to.
+	glReadBuffer(GL_NONE);
+
+	// Always check that our framebuffer is ok
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		cerr << "Frame buffer's status reported incomplete\n" << endl;
+		exit(1);
+	}
+}
+
+void ShadowAtlas::initExponential() {
+
+	exponentialProgram = LoadShaders("../shader_blur.vert", "../shader_exponential_shadow.frag");
+
+	//mip levels of an aligned tile stay inside it down to a single texel
+	exponentialTexture.generatePlainTexture();
+	GLState::bindTexture(GL_TEXTURE_2D, exponentialTexture.getID());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, resolution, resolution, 0, GL_RED, GL_FLOAT, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	glGenFramebuffers(1, &exponentialFrameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, exponentialFrameBuffer);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, exponentialTexture.getID(), 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		cerr << "Frame buffer's status reported incomplete\n" << endl;
+		exit(1);
+	}
+
+	//quad covering whatever tile the viewport is set to
+	GLfloat quadPositions[] = {
+		-1.0f, -1.0f, 0.0f,
+		1.0f, -1.0f, 0.0f,
+		-1.0f,  1.0f, 0.0f,
+		1.0f,  1.0f, 0.0f
+	};
+	glGenVertexArrays(1, &quadVAO);
+	GLState::bindVertexArray(quadVAO);
+	glGenBuffers(1, &quadVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quadPositions), quadPositions, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::bindVertexArray(0);
+
+	exponential = true;
+}
+
+/*exp(c * depth) for every exponentially filtered tile redrawn this frame, then
+mips so wider filters read a prefiltered level instead of more samples*/
+void ShadowAtlas::convertToExponential() {
+
+	bool converted = false;
+	for (unsigned int i = 0; i < drawnTiles.size(); ++i) {
+
+		int tile = drawnTiles[i];
+		if (tileFilters[tile] != EXPONENTIAL_SHADOWS) {
+			continue;
+		}
+		if (!converted) {
+			GLState::useProgram(exponentialProgram);
+			glBindFramebuffer(GL_FRAMEBUFFER, exponentialFrameBuffer);
+			glUniform1i(glGetUniformLocation(exponentialProgram, "depthAtlas"), 0);
+			GLState::activeTexture(GL_TEXTURE0);
+			GLState::bindTexture(GL_TEXTURE_2D, depthTexture.getID());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);	//raw depth for texelFetch
+			GLState::disable(GL_DEPTH_TEST);
+			GLState::bindVertexArray(quadVAO);
+			converted = true;
+		}
+		glViewport(tiles[tile].x, tiles[tile].y, tiles[tile].size, tiles[tile].size);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+	if (!converted) {
+		return;
+	}
+
+	GLState::bindVertexArray(0);
+	GLState::enable(GL_DEPTH_TEST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+
+	GLState::bindTexture(GL_TEXTURE_2D, exponentialTexture.getID());
+	glGenerateMipmap(GL_TEXTURE_2D);
+	GLState::bindTexture(GL_TEXTURE_2D, 0);
+}
+
+//clears and blits stay inside the tile too
+void ShadowAtlas::applyTileViewport(int tile) {
+
+	const Tile& t = tiles[tile];
+	glViewport(t.x, t.y, t.size, t.size);
+	glScissor(t.x, t.y, t.size, t.size);
+	GLState::enable(GL_SCISSOR_TEST);
+}
+
+void ShadowAtlas::applyLayeredViewports(const int* tile_list, int count) {
+
+	for (int i = 0; i < count; ++i) {
+		const Tile& t = tiles[tile_list[i]];
+		glViewportIndexedf(i, (GLfloat)t.x, (GLfloat)t.y, (GLfloat)t.size, (GLfloat)t.size);
+		glScissorIndexed(i, t.x, t.y, t.size, t.size);
+	}
+	GLState::enable(GL_SCISSOR_TEST);
+}
+
+//every other bit of a Z order index, gives one coordinate of the cell
+GLuint ShadowAtlas::compactBits(GLuint bits) {
+	bits &= 0x55555555;
+	bits = (bits ^ (bits >> 1)) & 0x33333333;
+	bits = (bits ^ (bits >> 2)) & 0x0f0f0f0f;
+	bits = (bits ^ (bits >> 4)) & 0x00ff00ff;
+	bits = (bits ^ (bits >> 8)) & 0x0000ffff;
+	return bits;
+}
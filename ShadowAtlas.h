@@ -0,0 +1,133 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "Texture.h"
+
+/*One depth texture shared by every shadowed light. Each frame lights request
+square tiles, power of two sized from how much of the screen they cover, and
+the packer places them largest first in Z order so every tile lands aligned to
+its own size without gaps. When the requests don't fit, the largest tiles are
+halved, least important first, so memory stays fixed however many lights the
+scene has. A texture buffer holds, per tile, the matrix from world space
+straight to atlas coordinates, the tile's rectangle to clamp lookups to and how
+the owning light filters its shadows. Depth is compared in hardware with
+bilinear PCF. Lights filtering exponentially read a second, mipmapped atlas
+of exp(c * depth) converted from the depth tiles redrawn each frame*/
+class ShadowAtlas {
+
+public:
+	const static GLuint MIN_TILE_SIZE = 128;
+
+	//texture unit for the view data, after the shadow atlas and before the light clusters
+	const static int VIEW_DATA_UNIT = 12;
+
+	//six texels per tile, see setViewProjection and setViewFilter
+	const static int VIEW_TEXELS = 6;
+
+	//per light shadow filtering, cheapest first
+	enum Filter { HARD_SHADOWS, PCF_SHADOWS, POISSON_SHADOWS, EXPONENTIAL_SHADOWS };
+	const static int MAX_POISSON_SAMPLES = 16;
+
+	struct Tile {
+		GLuint x, y, size;		//size 0 when the tile didn't fit at all
+	};
+
+private:
+
+	struct Request {
+		GLuint size;
+		float importance;
+	};
+
+	static glm::mat4 biasMatrix;
+
+	GLuint resolution;
+
+	GLuint frameBuffer;
+	Texture depthTexture;
+
+	//static casters only, a tile is copied into depthTexture before dynamic casters are drawn
+	GLuint staticFrameBuffer;
+	Texture staticDepthTexture;
+
+	std::vector<Request> requests;
+	std::vector<Tile> tiles;
+	std::vector<glm::mat4> viewProjections;
+
+	//per tile: world to atlas matrix columns, the clamp rectangle, then the filter
+	std::vector<glm::vec4> viewData;
+	GLuint viewDataBuffer, viewDataTexture;
+	std::vector<int> tileFilters;
+
+	//slope scaled and constant depth offset while drawing casters
+	float slopeBias, constantBias;
+
+	//exponential shadow maps, created once a light asks for them
+	bool exponential;
+	GLuint exponentialProgram;
+	GLuint exponentialFrameBuffer;
+	Texture exponentialTexture;
+	GLuint quadVAO, quadVBO;
+	std::vector<int> drawnTiles;		//converted and mipmapped in endPasses
+
+	//what each tile was last drawn from
+	struct CacheEntry {
+		bool staticValid;
+		bool valid;
+		Tile tile;
+		glm::mat4 viewProjection;
+		unsigned long long staticSignature;
+		unsigned long long dynamicSignature;
+	};
+	std::vector<CacheEntry> cache;
+
+public:
+
+	ShadowAtlas();
+
+	void init(GLuint atlas_resolution);
+	void dispose();
+	GLuint getResolution();
+
+	//requests are numbered in the order they were made, pack assigns their tiles
+	void beginFrame();
+	int request(GLuint tile_size, float importance);
+	void pack();
+	Tile getTile(int tile);
+	unsigned int getNumTiles();
+
+	//light space matrix a tile was fitted with, stored in atlas coordinates for the shaders
+	void setViewProjection(int tile, const glm::mat4& view_projection);
+	void setViewFilter(int tile, int filter, float radius_texels, int samples);
+	void setDepthBias(float slope_bias, float constant_bias);
+	void uploadViewData();
+	//binds the exponential atlas at the unit after atlas_unit
+	void applySettings(GLuint shader_program, int atlas_unit);
+
+	//caching: skip a tile, or just its static part, when nothing it depends on changed
+	bool isCacheValid(int tile, unsigned long long static_signature, unsigned long long dynamic_signature);
+	bool isStaticCacheValid(int tile, unsigned long long static_signature);
+	void beginStaticPass(int tile);
+	void beginDynamicPass(int tile);
+
+	//several tiles drawn in one pass, each through its own viewport index
+	static bool supportsLayeredPasses();
+	void beginLayeredStaticPass(const int* tile_list, int count);
+	void beginLayeredDynamicPass(const int* tile_list, int count);
+	void markCached(int tile, unsigned long long static_signature, unsigned long long dynamic_signature);
+	void endPasses();
+	void invalidate();
+
+	Texture getDepthTexture();
+
+private:
+	void initFrameBuffer(GLuint& frame_buffer, Texture& depth_texture);
+	void initExponential();
+	void convertToExponential();
+	void applyTileViewport(int tile);
+	void applyLayeredViewports(const int* tile_list, int count);
+	static GLuint compactBits(GLuint bits);
+};
@@ -1,91 +1,317 @@
 #include <iostream>
 #include "ShadowMap.h"
 #include "shader.h"
+#include "Camera.h"
+#include <cmath>
+#include "GLState.h"
 using namespace std;
 
 GLuint ShadowMap::shaderProgram = -1;
+GLint ShadowMap::toWorldLocation = -1;
+GLint ShadowMap::lightProjectionLocation = -1;
+GLint ShadowMap::lightViewLocation = -1;
+GLuint ShadowMap::cubeShaderProgram = 0;
+GLint ShadowMap::cubeToWorldLocation = -1;
+GLint ShadowMap::faceViewProjectionsLocation = -1;
+GLint ShadowMap::faceMaskLocation = -1;
+bool ShadowMap::layeredViews = false;
 
-//matrix to put coords range 0-1 to sample shadow map
-glm::mat4 ShadowMap::biasMatrix;
+//spot and point views start this far out from the light
+static const float SHADOW_NEAR = 1.0f;
 
 //manage statics
 void ShadowMap::initStatics() {
 	shaderProgram = LoadShaders("../shader_shadow.vert", "../shader_shadow.frag");
-	biasMatrix = glm::mat4(
-		0.5, 0.0, 0.0, 0.0,
-		0.0, 0.5, 0.0, 0.0,
-		0.0, 0.0, 0.5, 0.0,
-		0.5, 0.5, 0.5, 1.0
-	);
+	toWorldLocation = glGetUniformLocation(shaderProgram, "toWorld");
+	lightProjectionLocation = glGetUniformLocation(shaderProgram, "lightProjection");
+	lightViewLocation = glGetUniformLocation(shaderProgram, "lightView");
+
+	if (ShadowAtlas::supportsLayeredPasses()) {
+		cubeShaderProgram = LoadShaders("../shader_shadow_cube.vert", "../shader_shadow_cube.geom", "../shader_shadow.frag");
+		cubeToWorldLocation = glGetUniformLocation(cubeShaderProgram, "toWorld");
+		faceViewProjectionsLocation = glGetUniformLocation(cubeShaderProgram, "faceViewProjections");
+		faceMaskLocation = glGetUniformLocation(cubeShaderProgram, "faceMask");
+	}
 }
 void ShadowMap::cleanUpStatics() {
-	glDeleteProgram(shaderProgram);
+	GLState::deleteProgram(shaderProgram);
 	shaderProgram = -1;
+	if (cubeShaderProgram != 0) {
+		GLState::deleteProgram(cubeShaderProgram);
+		cubeShaderProgram = 0;
+	}
 }
 
 GLuint ShadowMap::getShaderProgram() {
 	return shaderProgram;
 }
 
+//the shadow program has to be in use
+void ShadowMap::applyMatrices(const glm::mat4& projection, const glm::mat4& view) {
+	glUniformMatrix4fv(lightProjectionLocation, 1, GL_FALSE, &projection[0][0]);
+	glUniformMatrix4fv(lightViewLocation, 1, GL_FALSE, &view[0][0]);
+}
+void ShadowMap::applyToWorld(const glm::mat4& to_world) {
+	glUniformMatrix4fv(layeredViews ? cubeToWorldLocation : toWorldLocation, 1, GL_FALSE, &to_world[0][0]);
+}
+void ShadowMap::applyFaceMask(int face_mask) {
+	glUniform1i(faceMaskLocation, face_mask);
+}
+void ShadowMap::endLayeredViews() {
+	GLState::useProgram(shaderProgram);
+	layeredViews = false;
+}
+
 ShadowMap::ShadowMap() {
-	frameBuffer = -1;
-	resolution = 4096;
-	projectionMatrix = glm::ortho<float>(-100, 100, -100, 100, -200, 200);
+	numCascades = 3;
+	maxTileSize = 2048;
+	numViews = 0;
+	directional = false;
+	for (int i = 0; i < MAX_VIEWS; ++i) {
+		tiles[i] = -1;
+	}
+	for (int i = 0; i < MAX_CASCADES; ++i) {
+		cascadeSplits[i] = 0.0f;
+	}
+}
+
+void ShadowMap::setCascadeSettings(int num_cascades, GLuint max_tile_size) {
+	numCascades = glm::clamp(num_cascades, 1, (int)MAX_CASCADES);
+	maxTileSize = max_tile_size;
+}
+int ShadowMap::getNumCascades() {
+	return numCascades;
 }
-ShadowMap::~ShadowMap() {
-	disposeBufferAndTexture();
+GLuint ShadowMap::getMaxTileSize() {
+	return maxTileSize;
 }
-void ShadowMap::initBufferAndTexture() {
 
-	glGenFramebuffers(1, &frameBuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+/*directional cascades always cover the view and ask for full size tiles. Spot
+and point lights scale with the screen height their range covers, and a cube
+face only sees a quarter of what a spot cone of the same range would*/
+void ShadowMap::requestTiles(ShadowAtlas* atlas, Light* curr_light, Camera* camera, const Frustum& camera_frustum) {
+
+	directional = curr_light->type == Light::DIRECTIONAL;
+	if (curr_light->type == Light::DIRECTIONAL) {
+		numViews = numCascades;
+		for (int i = 0; i < numViews; ++i) {
+			tiles[i] = atlas->request(maxTileSize, 1.0f);
+		}
+		return;
+	}
+
+	//nothing the camera sees is lit by it, so its shadows can't be seen either
+	glm::vec3 position = curr_light->getPosition(SceneObject::WORLD);
+	glm::vec3 reach = glm::vec3(curr_light->range, curr_light->range, curr_light->range);
+	if (camera_frustum.classify(AABB(position - reach, position + reach)) == Frustum::OUTSIDE) {
+		numViews = 0;
+		return;
+	}
+
+	float coverage = getScreenCoverage(curr_light, camera);
+	if (curr_light->type == Light::SPOT) {
+		numViews = 1;
+		tiles[0] = atlas->request((GLuint)(maxTileSize * coverage), coverage);
+	}
+	else {
+		numViews = 6;
+		for (int i = 0; i < numViews; ++i) {
+			tiles[i] = atlas->request((GLuint)(maxTileSize * coverage / 2), coverage);
+		}
+	}
+}
 
-	depthTexture.generatePlainTexture();
-	glBindTexture(GL_TEXTURE_2D, depthTexture.getID());
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT16, resolution, resolution, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+//a light with any view left out of the atlas goes without shadows this frame
+void ShadowMap::updateViews(ShadowAtlas* atlas, Light* curr_light, Camera* camera, float shadow_distance, const AABB* caster_bounds) {
 
-	//attach texture to frame buffer
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture.getID(), 0);
+	if (numViews == 0) {
+		curr_light->setShadowViews(-1, 0, cascadeSplits);
+		return;
+	}
+	for (int i = 0; i < numViews; ++i) {
+		if (atlas->getTile(tiles[i]).size == 0) {
+			numViews = 0;
+			curr_light->setShadowViews(-1, 0, cascadeSplits);
+			return;
+		}
+	}
 
-	glDrawBuffer(GL_NONE); // No color buffer is drawn to.
+	if (curr_light->type == Light::DIRECTIONAL) {
+		fitCascades(atlas, curr_light, camera, shadow_distance, caster_bounds);
+	}
+	else if (curr_light->type == Light::SPOT) {
+		fitSpotView(curr_light);
+	}
+	else {
+		fitCubeViews(curr_light);
+	}
 
-	// Always check that our framebuffer is ok
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-		cerr << "Frame buffer's status reported incomplete\n" << endl;
-		exit(1);
+	for (int i = 0; i < numViews; ++i) {
+		atlas->setViewProjection(tiles[i], projections[i] * viewMatrices[i]);
+		atlas->setViewFilter(tiles[i], curr_light->getShadowFilter(), curr_light->getShadowFilterRadius(), curr_light->getShadowFilterSamples());
 	}
+
+	//tiles are requested back to back, so a light's views follow its first one
+	curr_light->setShadowViews(tiles[0], curr_light->type == Light::DIRECTIONAL ? numCascades : 0, cascadeSplits);
+}
+int ShadowMap::getNumViews() {
+	return numViews;
+}
+int ShadowMap::getTile(int view) {
+	return tiles[view];
 }
 
-void ShadowMap::disposeBufferAndTexture() {
+/*casters between a cascade and its light still shadow it, depth clamping flattens
+them onto the near plane instead of clipping them away*/
+void ShadowMap::applyViewMatrices(int view) {
 
-	depthTexture.disposeCurrentTexture();
-	if (frameBuffer != -1) {
-		glDeleteBuffers(1, &frameBuffer);
-		frameBuffer = -1;
+	//send matrices to shadow shader
+	applyMatrices(projections[view], viewMatrices[view]);
+	if (directional) {
+		GLState::enable(GL_DEPTH_CLAMP);
+	}
+	else {
+		GLState::disable(GL_DEPTH_CLAMP);
 	}
 }
-void ShadowMap::applyAttributes(Light* curr_light) {
 
-	//set display matrix for shadowmap texture
-	glViewport(0, 0, resolution, resolution);
+void ShadowMap::getCasterVolume(int view, Frustum& volume) {
 
-	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	volume.update(projections[view] * viewMatrices[view]);
+	if (directional) {
+		volume.dropPlane(Frustum::NEAR_PLANE);
+	}
+}
 
-	//send matrices to shadow shader
-	glm::vec3 lightDir = curr_light->getToWorld() * glm::vec4(0, 0, 1, 0);	//4th component 0 to avoid translations 
-	glm::mat4 lightViewMatrix = glm::lookAt(glm::vec3(0, 0, 0), lightDir, glm::vec3(0, 1, 0));
-	curr_light->setViewProjectionMatrix(biasMatrix * projectionMatrix * lightViewMatrix);
-	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "lightProjection"), 1, GL_FALSE, &projectionMatrix[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "lightView"), 1, GL_FALSE, &lightViewMatrix[0][0]);
+bool ShadowMap::usesLayeredViews() {
+	return cubeShaderProgram != 0 && !directional && numViews == 6;
+}
+
+void ShadowMap::beginLayeredViews() {
+
+	glm::mat4 faceViewProjections[6];
+	for (int i = 0; i < 6; ++i) {
+		faceViewProjections[i] = projections[i] * viewMatrices[i];
+	}
+
+	GLState::useProgram(cubeShaderProgram);
+	glUniformMatrix4fv(faceViewProjectionsLocation, 6, GL_FALSE, &faceViewProjections[0][0][0]);
+	GLState::disable(GL_DEPTH_CLAMP);
+	layeredViews = true;
+}
+
+//the box around the light's range, which every face's casters lie in
+void ShadowMap::getRangeVolume(Light* curr_light, Frustum& volume) {
+
+	float range = curr_light->range;
+	glm::vec3 position = curr_light->getPosition(SceneObject::WORLD);
+	volume.update(glm::ortho(-range, range, -range, range, -range, range) * glm::translate(glm::mat4(1.0f), -position));
+}
+
+//PRIVATE HELPERS
+
+/*splits blend logarithmic and uniform spacing. Each cascade's sphere only depends
+on the slice's depths and the camera's field of view, so its size is the same
+however the camera turns, and snapping its center to the texel grid keeps
+texels from crawling over the scene while it moves. Toward the light the box
+reaches the highest caster, away from it the far side of the sphere*/
+void ShadowMap::fitCascades(ShadowAtlas* atlas, Light* curr_light, Camera* camera, float shadow_distance, const AABB* caster_bounds) {
+
+	const float SPLIT_BLEND = 0.75f;
+
+	//light looks down its own z axis, any up vector not parallel to it works
+	glm::vec3 lightDir = glm::normalize(glm::vec3(curr_light->getToWorld() * glm::vec4(0, 0, 1, 0)));	//4th component 0 to avoid translations 
+	glm::vec3 up = glm::abs(lightDir.y) > 0.99f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0, 0, 0), lightDir, up);
+
+	AABB casterLightBounds;
+	if (caster_bounds != NULL && !caster_bounds->isEmpty()) {
+		casterLightBounds = caster_bounds->transformed(lightView);
+	}
+
+	glm::mat4 cameraProjection = camera->getProjectionMatrix();
+	glm::mat4 cameraToWorld = glm::inverse(camera->getViewMatrix());
+	float tanHalfX = 1.0f / cameraProjection[0][0];
+	float tanHalfY = 1.0f / cameraProjection[1][1];
+	float cameraNear = camera->getCameraNear();
+	float shadowFar = glm::min(camera->getCameraFar(), shadow_distance);
+
+	float splitNear = cameraNear;
+	for (int c = 0; c < numCascades; ++c) {
 
+		float fraction = (float)(c + 1) / numCascades;
+		float logSplit = cameraNear * std::pow(shadowFar / cameraNear, fraction);
+		float uniformSplit = cameraNear + (shadowFar - cameraNear) * fraction;
+		float splitFar = SPLIT_BLEND * logSplit + (1.0f - SPLIT_BLEND) * uniformSplit;
+
+		//sphere around the slice, its center sits on the view axis
+		float nearHalfDiagonal2 = splitNear * splitNear * (tanHalfX * tanHalfX + tanHalfY * tanHalfY);
+		float farHalfDiagonal2 = splitFar * splitFar * (tanHalfX * tanHalfX + tanHalfY * tanHalfY);
+		float centerDepth = glm::clamp((splitNear + splitFar) * 0.5f + (farHalfDiagonal2 - nearHalfDiagonal2) / (2.0f * (splitFar - splitNear)), splitNear, splitFar);
+		float radius = std::sqrt(glm::max((centerDepth - splitNear) * (centerDepth - splitNear) + nearHalfDiagonal2,
+			(splitFar - centerDepth) * (splitFar - centerDepth) + farHalfDiagonal2));
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		glm::vec3 center = glm::vec3(lightView * cameraToWorld * glm::vec4(0, 0, -centerDepth, 1));
+
+		//move in whole texels only
+		float texelSize = 2.0f * radius / atlas->getTile(tiles[c]).size;
+		center.x = std::floor(center.x / texelSize) * texelSize;
+		center.y = std::floor(center.y / texelSize) * texelSize;
+
+		//casters decide how far toward the light the box has to reach
+		float closestZ = center.z + radius;
+		if (!casterLightBounds.isEmpty()) {
+			closestZ = glm::max(casterLightBounds.highest.z, center.z - radius);
+		}
+		float farthestZ = center.z - radius;
+
+		viewMatrices[c] = lightView;
+		projections[c] = glm::ortho(center.x - radius, center.x + radius, center.y - radius, center.y + radius, -closestZ - 1.0f, -farthestZ + 1.0f);
+		cascadeSplits[c] = splitFar;
+
+		splitNear = splitFar;
+	}
 }
 
+void ShadowMap::fitSpotView(Light* curr_light) {
 
-Texture ShadowMap::getDepthTexture() {
-	return depthTexture;
+	glm::vec3 position = curr_light->getPosition(SceneObject::WORLD);
+	glm::vec3 lightDir = glm::normalize(glm::vec3(curr_light->getToWorld() * glm::vec4(0, 0, 1, 0)));
+	glm::vec3 up = glm::abs(lightDir.y) > 0.99f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+
+	viewMatrices[0] = glm::lookAt(position, position + lightDir, up);
+	projections[0] = glm::perspective(2.0f * curr_light->getSpotAngle(), 1.0f, SHADOW_NEAR, curr_light->range);
+}
+
+//faces in +X, -X, +Y, -Y, +Z, -Z order, the shaders pick one by the major axis
+void ShadowMap::fitCubeViews(Light* curr_light) {
+
+	const glm::vec3 faceDirections[6] = {
+		glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+		glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+	};
+	const glm::vec3 faceUps[6] = {
+		glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1),
+		glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0)
+	};
+
+	glm::vec3 position = curr_light->getPosition(SceneObject::WORLD);
+	glm::mat4 faceProjection = glm::perspective(glm::pi<float>() / 2.0f, 1.0f, SHADOW_NEAR, curr_light->range);
+	for (int i = 0; i < 6; ++i) {
+		viewMatrices[i] = glm::lookAt(position, position + faceDirections[i], faceUps[i]);
+		projections[i] = faceProjection;
+	}
+}
+
+//fraction of the screen height the light's range sphere spans, 1 from inside it
+float ShadowMap::getScreenCoverage(Light* curr_light, Camera* camera) {
+
+	glm::vec3 toLight = curr_light->getPosition(SceneObject::WORLD) - camera->getPosition(SceneObject::WORLD);
+	float distance = glm::length(toLight);
+	if (distance <= curr_light->range) {
+		return 1.0f;
+	}
+	float tanHalfY = 1.0f / camera->getProjectionMatrix()[1][1];
+	return glm::clamp(curr_light->range / (distance * tanHalfY), 0.0f, 1.0f);
 }
@@ -3,35 +3,96 @@
 #include <GLFW/glfw3.h>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include "Texture.h"
 #include "Light.h"
+#include "AABB.h"
+#include "ShadowAtlas.h"
+#include "Frustum.h"
 
+class Camera;
 
+/*The shadow views of one light, each drawn into its own tile of the shadow
+atlas. A directional light splits the camera frustum, up to the shadow
+distance, into cascades: orthographic boxes around the bounding sphere of each
+slice, snapped to whole texels so they don't shimmer as the camera moves, with
+their depth range fitted to the shadow casters. A spot light gets one
+perspective view down its cone, a point light six, one per cube face. Where
+viewport arrays are supported, the six faces are drawn in a single pass with a
+geometry shader sending each triangle to the faces it touches*/
 class ShadowMap {
 
+public:
+	const static int MAX_CASCADES = LightStruct::MAX_CASCADES;
+	const static int MAX_VIEWS = 6;
+
+private:
+
 	static GLuint shaderProgram;
-	static glm::mat4 biasMatrix;
 
-	GLuint frameBuffer;
-	Texture depthTexture;
+	//looked up once, every caster sends its toWorld
+	static GLint toWorldLocation;
+	static GLint lightProjectionLocation;
+	static GLint lightViewLocation;
+
+	//single pass cube faces, 0 without viewport arrays
+	static GLuint cubeShaderProgram;
+	static GLint cubeToWorldLocation;
+	static GLint faceViewProjectionsLocation;
+	static GLint faceMaskLocation;
+	static bool layeredViews;		//casters go to the cube program while set
+
+	int numCascades;
+	GLuint maxTileSize;
+
+	//views from the last updateViews, each with its atlas tile
+	int numViews;
+	int tiles[MAX_VIEWS];
+	glm::mat4 viewMatrices[MAX_VIEWS];
+	glm::mat4 projections[MAX_VIEWS];
+	float cascadeSplits[MAX_CASCADES];
+	bool directional;
 
-	GLuint resolution;
-	glm::mat4 projectionMatrix;
-	
 public:
 
 	//manage statics
 	static void initStatics();
 	static void cleanUpStatics();
 	static GLuint getShaderProgram();
+	static void applyMatrices(const glm::mat4& projection, const glm::mat4& view);
+	static void applyToWorld(const glm::mat4& to_world);
+	static void applyFaceMask(int face_mask);
+	static void endLayeredViews();
 
 
 	ShadowMap();
-	~ShadowMap();
-	void initBufferAndTexture();
-	void disposeBufferAndTexture();
-	void applyAttributes(Light* curr_light);
 
-	Texture getDepthTexture();
+	//more cascades spread the same tile size over more of the view
+	void setCascadeSettings(int num_cascades, GLuint max_tile_size);
+	int getNumCascades();
+	GLuint getMaxTileSize();
+
+	//ask the atlas for one tile per view, sized by how much of the screen the light reaches.
+	//Lights whose range misses the camera frustum ask for none and cast no shadows this frame
+	void requestTiles(ShadowAtlas* atlas, Light* curr_light, Camera* camera, const Frustum& camera_frustum);
+
+	//once packed, fit the views to their tiles and hand them to the light
+	void updateViews(ShadowAtlas* atlas, Light* curr_light, Camera* camera, float shadow_distance, const AABB* caster_bounds);
+	int getNumViews();
+	int getTile(int view);
+
+	//send a view's matrices to the shadow shader
+	void applyViewMatrices(int view);
+
+	//what a view's casters have to touch, cascades reach all the way back toward the light
+	void getCasterVolume(int view, Frustum& volume);
+
+	//all six cube faces at once, casters then pick their faces with applyFaceMask
+	bool usesLayeredViews();
+	void beginLayeredViews();
+	void getRangeVolume(Light* curr_light, Frustum& volume);
 
-};
\ No newline at end of file
+private:
+	void fitCascades(ShadowAtlas* atlas, Light* curr_light, Camera* camera, float shadow_distance, const AABB* caster_bounds);
+	void fitSpotView(Light* curr_light);
+	void fitCubeViews(Light* curr_light);
+	static float getScreenCoverage(Light* curr_light, Camera* camera);
+};
@@ -1,9 +1,11 @@
 #include "SkyBox.h"
 #include "Scene.h"
+#include "GLState.h"
 
 SkyBox::SkyBox()
 {
 	setLocalScale(glm::vec3(1000,1000,1000));
+	setCastsShadows(false);
 	shaderProgram = LoadShaders("../shader.vert", "../shader_skybox.frag");
 	
 	// Create array object and buffers. Remember to delete your buffers when the object is destroyed!
@@ -12,7 +14,7 @@ SkyBox::SkyBox()
 	glGenBuffers(1, &EBO);
 	
 	//set VAO to current one
-	glBindVertexArray(VAO);
+	GLState::bindVertexArray(VAO);
 
 	//Vertex Position
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -33,7 +35,7 @@ SkyBox::SkyBox()
 
 	//Unbind current VBO and VAO, but not EBO
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	GLState::bindVertexArray(0);
 	
 }
 
@@ -41,18 +43,18 @@ SkyBox::~SkyBox()
 {
 	// Delete previously generated buffers. Note that forgetting to do this can waste GPU memory in a 
 	// large project! This could crash the graphics driver due to memory leaks, or slow down application performance!
-	glDeleteVertexArrays(1, &VAO);
+	GLState::deleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
 
-	glDeleteProgram(shaderProgram);
+	GLState::deleteProgram(shaderProgram);
 }
 void SkyBox::sendThisGeometryToShadowMap() {
 	//leave empty
 }
 void SkyBox::drawThisSceneObject(Scene* currScene) {
 
-	glUseProgram(shaderProgram);
+	GLState::useProgram(shaderProgram);
 
 	Camera* activeCamera = currScene->getActiveCamera();
 	
@@ -63,16 +65,16 @@ void SkyBox::drawThisSceneObject(Scene* currScene) {
 	activeCamera->applySettings(shaderProgram);
 
 	// Now draw the cube. We simply need to bind the VAO associated with it.
-	glBindVertexArray(VAO);
+	GLState::bindVertexArray(VAO);
 
-	glDepthMask(GL_FALSE);
+	GLState::depthMask(GL_FALSE);
 
 	// Tell OpenGL to draw with triangles, using 36 indices, the type of the indices, and the offset to start from
 	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
 
-	glDepthMask(GL_TRUE);
+	GLState::depthMask(GL_TRUE);
 	// Unbind the VAO when we're done so we don't accidentally draw extra stuff or tamper with its bound buffers
-	glBindVertexArray(0);
+	GLState::bindVertexArray(0);
 
 }
 
@@ -92,6 +94,6 @@ void SkyBox::applySettings() {
 
 	//send cubemap textureID to shader
 	glUniform1i(glGetUniformLocation(shaderProgram, "skybox"), 0);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMapTexture.getID());
+	GLState::activeTexture(GL_TEXTURE0);
+	GLState::bindTexture(GL_TEXTURE_CUBE_MAP, cubeMapTexture.getID());
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "Texture.h"
+#include "GLState.h"
 
 
 Texture::Texture() {
@@ -20,7 +21,7 @@ void Texture::loadCubeMap(std::vector<std::string> faces) {
 }
 void Texture::disposeCurrentTexture() {
 	if (id != 0) {
-		glDeleteTextures(1, &id);
+		GLState::deleteTextures(1, &id);
 		type = Texture::INVALID;
 		id = 0;
 	}
@@ -48,7 +49,7 @@ void Texture::loadImage(const char* filename) {
 	glGenTextures(1, &id);
 
 	// Set this texture to be the one we are working with
-	glBindTexture(GL_TEXTURE_2D, id);
+	GLState::bindTexture(GL_TEXTURE_2D, id);
 
 	// Generate the texture
 	glTexImage2D(GL_TEXTURE_2D, 0, 3, twidth, theight, 0, GL_RGB, GL_UNSIGNED_BYTE, tdata);
@@ -61,7 +62,7 @@ void Texture::loadImage(const char* filename) {
 void Texture::loadCubeMapTexture(std::vector<std::string> faces) {
 
 	glGenTextures(1, &id);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, id);
+	GLState::bindTexture(GL_TEXTURE_CUBE_MAP, id);
 
 	int width, height;
 	for (unsigned int i = 0; i < faces.size(); i++)
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <iostream>
 #include "SceneManager.h"
+#include "GLState.h"
 using namespace std;
 
 
@@ -39,15 +40,19 @@ void setup_opengl_settings()
 {
 
 	setup_glew();
+
+	//nothing has been set through the state cache yet, its first calls all reach GL
+	GLState::reset();
+
 	// Enable depth buffering
-	glEnable(GL_DEPTH_TEST);
+	GLState::enable(GL_DEPTH_TEST);
 	// Related to shaders and z value comparisons for the depth buffer
-	glDepthFunc(GL_LEQUAL);
+	GLState::depthFunc(GL_LEQUAL);
 	// Set polygon drawing mode to fill front and back of each polygon
 	// You can also use the paramter of GL_LINE instead of GL_FILL to see wireframes
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	// Disable backface culling to render both sides of polygons
-	glDisable(GL_CULL_FACE);
+	GLState::disable(GL_CULL_FACE);
 	// Set clear color
 	glClearColor(0.05f, 0.8f, 0.85f, 1.0f);
 }
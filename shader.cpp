@@ -14,6 +14,13 @@ using namespace std;
 #include "shader.h"
 
 GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+	return LoadShaders(vertex_file_path, std::vector<const char *>(1, fragment_file_path));
+}
+
+//the fragment source is the files one after another, the first holds the #version line
+GLuint LoadShaders(const char * vertex_file_path,const std::vector<const char *>& fragment_file_paths){
+
+	const char * fragment_file_path = fragment_file_paths.back();
 
 	// Create the shaders
 	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
@@ -41,14 +48,16 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 		return 0;
 	}
 
-	// Read the Fragment Shader code from the file
+	// Read the Fragment Shader code from the files
 	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
+	for (unsigned int i = 0; i < fragment_file_paths.size(); ++i) {
+		std::ifstream FragmentShaderStream(fragment_file_paths[i], std::ios::in);
+		if(FragmentShaderStream.is_open()){
+			std::string Line = "";
+			while(getline(FragmentShaderStream, Line))
+				FragmentShaderCode += "\n" + Line;
+			FragmentShaderStream.close();
+		}
 	}
 
 	GLint Result = GL_FALSE;
@@ -118,3 +127,129 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 
 	return ProgramID;
 }
+
+//same as above with a geometry shader between the two stages
+GLuint LoadShaders(const char * vertex_file_path,const char * geometry_file_path,const char * fragment_file_path){
+
+	const char * paths[3] = { vertex_file_path, geometry_file_path, fragment_file_path };
+	GLenum types[3] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+	GLuint ShaderIDs[3];
+
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
+
+	for (int i = 0; i < 3; ++i) {
+
+		// Read the shader code from the file
+		std::string ShaderCode;
+		std::ifstream ShaderStream(paths[i], std::ios::in);
+		if(ShaderStream.is_open()){
+			std::string Line = "";
+			while(getline(ShaderStream, Line))
+				ShaderCode += "\n" + Line;
+			ShaderStream.close();
+		}else{
+			printf("Impossible to open %s. Check to make sure the file exists and you passed in the right filepath!\n", paths[i]);
+			for (int j = 0; j < i; ++j) {
+				glDeleteShader(ShaderIDs[j]);
+			}
+			return 0;
+		}
+
+		// Compile the shader
+		printf("Compiling shader : %s\n", paths[i]);
+		ShaderIDs[i] = glCreateShader(types[i]);
+		char const * SourcePointer = ShaderCode.c_str();
+		glShaderSource(ShaderIDs[i], 1, &SourcePointer , NULL);
+		glCompileShader(ShaderIDs[i]);
+
+		// Check the shader
+		glGetShaderiv(ShaderIDs[i], GL_COMPILE_STATUS, &Result);
+		glGetShaderiv(ShaderIDs[i], GL_INFO_LOG_LENGTH, &InfoLogLength);
+		if ( InfoLogLength > 0 ){
+			std::vector<char> ShaderErrorMessage(InfoLogLength+1);
+			glGetShaderInfoLog(ShaderIDs[i], InfoLogLength, NULL, &ShaderErrorMessage[0]);
+			printf("%s\n", &ShaderErrorMessage[0]);
+		}
+	}
+
+	// Link the program
+	printf("Linking program\n");
+	GLuint ProgramID = glCreateProgram();
+	for (int i = 0; i < 3; ++i) {
+		glAttachShader(ProgramID, ShaderIDs[i]);
+	}
+	glLinkProgram(ProgramID);
+
+	// Check the program
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if ( InfoLogLength > 0 ){
+		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
+		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+		printf("%s\n", &ProgramErrorMessage[0]);
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		glDetachShader(ProgramID, ShaderIDs[i]);
+		glDeleteShader(ShaderIDs[i]);
+	}
+
+	return ProgramID;
+}
+
+//a program of just a compute shader, for dispatching work outside the draw pipeline
+GLuint LoadComputeShader(const char * compute_file_path){
+
+	// Read the Compute Shader code from the file
+	std::string ComputeShaderCode;
+	std::ifstream ComputeShaderStream(compute_file_path, std::ios::in);
+	if(ComputeShaderStream.is_open()){
+		std::string Line = "";
+		while(getline(ComputeShaderStream, Line))
+			ComputeShaderCode += "\n" + Line;
+		ComputeShaderStream.close();
+	}else{
+		printf("Impossible to open %s. Check to make sure the file exists and you passed in the right filepath!\n", compute_file_path);
+		return 0;
+	}
+
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
+
+	// Compile Compute Shader
+	printf("Compiling shader : %s\n", compute_file_path);
+	GLuint ComputeShaderID = glCreateShader(GL_COMPUTE_SHADER);
+	char const * ComputeSourcePointer = ComputeShaderCode.c_str();
+	glShaderSource(ComputeShaderID, 1, &ComputeSourcePointer , NULL);
+	glCompileShader(ComputeShaderID);
+
+	// Check Compute Shader
+	glGetShaderiv(ComputeShaderID, GL_COMPILE_STATUS, &Result);
+	glGetShaderiv(ComputeShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if ( InfoLogLength > 0 ){
+		std::vector<char> ComputeShaderErrorMessage(InfoLogLength+1);
+		glGetShaderInfoLog(ComputeShaderID, InfoLogLength, NULL, &ComputeShaderErrorMessage[0]);
+		printf("%s\n", &ComputeShaderErrorMessage[0]);
+	}
+
+	// Link the program
+	printf("Linking program\n");
+	GLuint ProgramID = glCreateProgram();
+	glAttachShader(ProgramID, ComputeShaderID);
+	glLinkProgram(ProgramID);
+
+	// Check the program
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if ( InfoLogLength > 0 ){
+		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
+		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+		printf("%s\n", &ProgramErrorMessage[0]);
+	}
+
+	glDetachShader(ProgramID, ComputeShaderID);
+	glDeleteShader(ComputeShaderID);
+
+	return ProgramID;
+}
@@ -1,7 +1,12 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
+#include <vector>
+
 GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+GLuint LoadShaders(const char * vertex_file_path,const std::vector<const char *>& fragment_file_paths);
+GLuint LoadShaders(const char * vertex_file_path,const char * geometry_file_path,const char * fragment_file_path);
+GLuint LoadComputeShader(const char * compute_file_path);
 
 
 #endif
@@ -7,11 +7,18 @@ layout (location = 2) in vec2 uv;
 layout (location = 3) in vec3 tangent;
 layout (location = 4) in vec3 bitangent;
 
+//per instance toWorld, takes locations 5 to 8, one per column
+layout (location = 5) in mat4 instanceToWorld;
+
 //MVP matrices
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 toWorld;
+uniform bool instanced;		//toWorld comes from instanceToWorld instead
+
 
+//depth pre-pass and main pass must produce identical depths
+invariant gl_Position;
 
 //Output ports for vertex attributes
 out vec3 objectSpacePosition;
@@ -26,8 +33,10 @@ out mat4 toWorldMatrix;
 
 void main()
 {
+	mat4 model = instanced ? instanceToWorld : toWorld;
+
     // OpenGL maintains the D matrix so you only need to multiply by P, V and M
-    gl_Position = projection * view * toWorld * vec4(position, 1.0);
+    gl_Position = projection * view * model * vec4(position, 1.0);
 	
 	objectSpacePosition = position;
 	objectSpaceNormal = normal;
@@ -35,5 +44,5 @@ void main()
 	objectSpaceTangent = tangent;
 	objectSpaceBitangent = bitangent;
 
-	toWorldMatrix = toWorld;
+	toWorldMatrix = model;
 }
@@ -1,32 +1,29 @@
 #version 330 core
-#define PI 3.1415926535897932384626433832795
 
-//this is the fragment shader to blur the current camera
+//one direction of the separable Gaussian blur, run across then down by PostProcess
 
-uniform sampler2D texture;
-uniform float blurRadius;
+#define MAX_RADIUS 12
+
+uniform sampler2D source;
+uniform vec2 texelStep;		//one texel along the blur direction, in texture coordinates
+uniform float sigma;		//in texels
+uniform int radius;			//taps either side of the center, at most MAX_RADIUS
 in vec3 pos;
 
 out vec4 finalColor;
 void main()
 {
 	vec2 pixelPosition = vec2( (pos.x / 2.0) + 0.5 , (pos.y /2.0) + 0.5);
-	vec4 sumOfColors =	texture2D(texture, pixelPosition)  * 8;
-
-	
-	
-	for(int iter = 0; iter < 16; ++iter){
-		sumOfColors += texture2D(texture, pixelPosition + (blurRadius / 100.0) * vec2(cos(iter * (2 * PI) / 16), sin(iter * (2 * PI) / 16))) * 4;
-	}
-	for(int iter = 0; iter < 16; ++iter){
-		sumOfColors += texture2D(texture, pixelPosition + 2 * (blurRadius / 100.0) * vec2(cos(iter * (2 * PI) / 16), sin(iter * (2 * PI) / 16))) * 2;
-	}
-	for(int iter = 0; iter < 16; ++iter){
-		sumOfColors += texture2D(texture, pixelPosition + 3 * (blurRadius / 100.0) * vec2(cos(iter * (2 * PI) / 16), sin(iter * (2 * PI) / 16))) * 1;
-	}
 
-    finalColor =  sumOfColors / 120;
+	float falloff = -0.5 / (sigma * sigma);
+	vec4 sumOfColors = texture(source, pixelPosition);
+	float sumOfWeights = 1.0;
 
-	
+	for(int iter = 1; iter <= radius; ++iter){
+		float weight = exp(iter * iter * falloff);
+		sumOfColors += (texture(source, pixelPosition + iter * texelStep) + texture(source, pixelPosition - iter * texelStep)) * weight;
+		sumOfWeights += 2.0 * weight;
+	}
 
+	finalColor = sumOfColors / sumOfWeights;
 }
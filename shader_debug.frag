@@ -0,0 +1,18 @@
+#version 330 core
+// Debug lines are flat colored, no lighting or textures.
+
+in vec3 lineColor;
+
+//with the G-buffer bound the lines are marked unlit and lose the surface's other targets,
+//the forward frame buffer only has the first one
+layout (location = 0) out vec4 color;
+layout (location = 1) out vec4 outNormal;
+layout (location = 2) out vec4 outSpecular;
+layout (location = 3) out vec4 outAmbient;
+
+void main(){
+	color = vec4(lineColor, 1);
+	outNormal = vec4(0, 0, 0, 1);
+	outSpecular = vec4(0);
+	outAmbient = vec4(0);
+}
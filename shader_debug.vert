@@ -0,0 +1,15 @@
+#version 330 core
+// Debug lines, already in world space, each vertex carrying its own color.
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 vertexColor;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+out vec3 lineColor;
+
+void main(){
+	gl_Position = projection * view * vec4(position, 1.0);
+	lineColor = vertexColor;
+}
@@ -0,0 +1,70 @@
+// This is the deferred lighting fragment shader, it lights the G-buffer on a screen quad.
+// Compiled after shader_lighting.glsl.
+
+
+//G-buffer, see GBuffer.h for the layout
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gSpecular;
+uniform sampler2D gAmbient;
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+
+//from screen quad vertex shader
+in vec3 pos;
+
+layout (location = 0) out vec4 outColor;
+
+
+//surface properties
+vec3 world_position;
+vec3 world_normal;
+
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	vec4 albedo = texelFetch(gAlbedo, pixel, 0);
+	vec4 normal = texelFetch(gNormal, pixel, 0);
+	vec4 specular = texelFetch(gSpecular, pixel, 0);
+	vec4 ambient = texelFetch(gAmbient, pixel, 0);
+	float depth = texelFetch(gDepth, pixel, 0).r;
+
+	//nothing drawn here but the clear color or the skybox, which keeps depth writes off
+	if(depth == 1.0){
+		outColor = vec4(albedo.rgb, 1);
+		return;
+	}
+
+	//REBUILD WORLD POSITION FROM DEPTH
+	vec4 clipPosition = vec4(pos.xy, depth * 2.0 - 1.0, 1.0);
+	vec4 worldPosition = inverseViewProjection * clipPosition;
+	world_position = worldPosition.xyz / worldPosition.w;
+	world_normal = normal.xyz / max(length(normal.xyz), 0.0001);	//line gizmos carry no normal
+
+	addAllLights(world_position);
+
+	//Combine, like the forward shader's lighting modes
+	outColor = vec4(albedo.rgb, 1);
+	if(normal.a < 0.5){
+		outColor *= diffuseSum;
+	}
+	outColor += vec4(specular.rgb, 0) * specularSum;
+	outColor += vec4(ambient.rgb, 0) * ambientSum;
+	outColor.a = 1;
+	
+}//END MAIN
+
+
+//accumulate one light using the current L and C_l, material colors are applied by the caller
+void addLight(vec4 color, float visibility){
+
+	diffuseSum += visibility * max( dot(world_normal, L), 0) * color * C_l;
+
+	vec3 R = 2 * dot(world_normal, L) * world_normal - L;	//reflect(-L, world_normal);
+	vec3 e = normalize(camPosition - world_position);
+	specularSum += pow( max(dot(R, e),0) , 20) * color * C_l;
+
+	ambientSum += color * C_l;
+}
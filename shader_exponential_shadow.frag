@@ -0,0 +1,16 @@
+#version 330 core
+// This is the exponential shadow map fragment shader, it converts a shadow atlas tile on a screen quad.
+
+//has to match the material and deferred shaders
+#define EXPONENTIAL_SCALE	80.0
+
+uniform sampler2D depthAtlas;
+
+layout (location = 0) out float exponentialDepth;
+
+void main(){
+
+	//the viewport is the tile, so window coordinates are atlas texels
+	float depth = texelFetch(depthAtlas, ivec2(gl_FragCoord.xy), 0).r;
+	exponentialDepth = exp(EXPONENTIAL_SCALE * depth);
+}
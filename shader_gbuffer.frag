@@ -0,0 +1,117 @@
+#version 330 core
+// This is the G-buffer fragment shader, it writes the material's surface for the deferred lighting pass.
+
+
+//Material struct definition
+struct Material{
+
+	//DIFFUSE
+	int useDiffuse;
+	vec3 diffuse;
+
+	//SPECULAR
+	int useSpecular;
+	vec3 specular;
+
+	//AMBIENT
+	int useAmbient;
+	vec3 ambient;
+
+	//SURFACE COLOR
+	int useSurfaceColor;
+	vec3 surfaceColor;
+
+	//SURFACE TEXTURE
+	int useSurfaceTexture;
+	sampler2D surfaceTexture;
+	float surfaceTextureStrength;
+
+	//NORMAL MAP
+	int useNormalMap;
+	sampler2D normalMap;
+	float normalMapStrength;
+
+	//REFLECTION TEXTURE
+	int useReflectionTexture;
+	samplerCube reflectionTexture;
+	float reflectiveness;
+	
+};
+
+uniform Material material;
+uniform vec3 camPosition;
+
+//from vertex shader
+in vec3 objectSpacePosition;
+in vec3 objectSpaceNormal;
+in vec2 uvTexCoord;
+in vec3 objectSpaceTangent;
+in vec3 objectSpaceBitangent;
+in mat4 toWorldMatrix;
+
+//G-buffer targets, see GBuffer.h for the layout
+layout (location = 0) out vec4 outAlbedo;
+layout (location = 1) out vec4 outNormal;
+layout (location = 2) out vec4 outSpecular;
+layout (location = 3) out vec4 outAmbient;
+
+
+void main()
+{
+	
+	//FIND POSITION AND NORMAL IN WORLD COORDINATES
+	vec3 world_position = vec3(toWorldMatrix * vec4(objectSpacePosition,1));
+
+	mat3 refinedToWorld = mat3(transpose(inverse(toWorldMatrix)));	
+	vec3 world_normal = normalize(refinedToWorld * objectSpaceNormal);				
+	
+
+	//Starting Color: white, each material property will cut away at it
+	vec4 surface = vec4(1,1,1,1);
+
+	//define variables out here for ambient lighting to use
+	vec4 surfaceTextureColor = vec4(1,1,1,1);
+	vec4 reflectionTextureColor = vec4(1,1,1,1);
+
+	//Textures
+	if(material.useSurfaceColor == 1){
+		surface *= vec4(material.surfaceColor,1);
+	}
+	if(material.useSurfaceTexture == 1){
+		surfaceTextureColor = (1 -  material.surfaceTextureStrength * (1 - texture2D(material.surfaceTexture, uvTexCoord)));
+		surface *= surfaceTextureColor;
+	}
+	
+	if(material.useNormalMap == 1){
+		vec3 normalOffset = normalize(texture2D( material.normalMap, uvTexCoord ).rgb * 2.0 - 1.0);
+		world_normal = normalize(world_normal + normalOffset * material.normalMapStrength);
+	}	
+	
+	if(material.useReflectionTexture == 1){
+		vec3 I = normalize(world_position - camPosition);
+		vec3 R = reflect(I, normalize(world_normal));
+		reflectionTextureColor =  1 - (material.reflectiveness * (1 - vec4(texture(material.reflectionTexture, R).rgb, 1.0)));
+		surface *= reflectionTextureColor;
+	}
+
+	//the forward shader multiplies the surface by the diffuse lighting, without
+	//a diffuse term the surface passes straight through
+	if(material.useDiffuse == 1){
+		outAlbedo = vec4(surface.rgb * material.diffuse, 1);
+		outNormal = vec4(world_normal, 0);
+	}else{
+		outAlbedo = vec4(surface.rgb, 1);
+		outNormal = vec4(world_normal, 1);
+	}
+
+	outSpecular = vec4(0,0,0,0);
+	if(material.useSpecular == 1){
+		outSpecular = vec4(material.specular, 0);
+	}
+
+	outAmbient = vec4(0,0,0,0);
+	if(material.useAmbient == 1){
+		outAmbient = vec4(material.ambient, 0) * surfaceTextureColor * reflectionTextureColor;
+	}
+	
+}//END MAIN
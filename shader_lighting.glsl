@@ -0,0 +1,210 @@
+#version 330 core
+// Lights and shadows shared by the material and deferred lighting fragment shaders.
+// LoadShaders puts this in front of either one, which then defines addLight.
+
+
+#define DIRECTIONAL_LIGHT	0
+#define POINT_LIGHT			1
+#define SPOT_LIGHT			2
+#define MAX_LIGHTS			30
+#define MAX_CASCADES		4
+
+//shadow filters, match ShadowAtlas::Filter
+#define HARD_SHADOWS		0
+#define PCF_SHADOWS			1
+#define POISSON_SHADOWS		2
+#define EXPONENTIAL_SHADOWS	3
+#define EXPONENTIAL_SCALE	80.0
+
+//Light struct definition
+struct Light{
+		 
+	vec4 color;					
+	vec4 position;		 
+	vec4 direction;	
+	
+	int type; 
+	float brightness;
+	int numCascades;
+	float spotCosine;			//cosine of the cone's half angle
+
+	vec4 cascadeSplits;			//far view depth of each cascade
+
+	float range;
+	int firstShadowView;		//-1 without shadows
+	float padding;
+	float padding2;
+};
+
+//directional and spot lights, point lights are clustered
+layout (std140) uniform SceneLights {
+	Light allLights[MAX_LIGHTS];
+};
+
+//every light's shadow views share one atlas, six texels per view in shadowViews:
+//world to atlas matrix columns, the tile rectangle lookups are clamped to, then
+//the filter with its radius in atlas coordinates and its sample count or mip level
+uniform sampler2DShadow shadowAtlas;
+uniform sampler2D shadowExpAtlas;
+uniform samplerBuffer shadowViews;
+
+const vec2 poissonDisk[16] = vec2[](
+	vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725), vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+	vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464), vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+	vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420), vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+	vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590), vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
+//clustered point lights: two texels per light (position and range, color and first shadow view),
+//offset and count per froxel, then the packed light indices
+uniform samplerBuffer pointLightData;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterLightIndices;
+uniform ivec3 clusterGrid;
+uniform vec2 clusterTileSize;
+uniform float clusterDepthScale;
+uniform float clusterDepthBias;
+
+uniform vec3 camPosition;
+uniform mat4 view;
+uniform int numLights;
+
+
+//current light properties
+vec3 L = vec3(0,0,0);
+float C_l = 0;
+
+//lighting sums, filled by addLight
+vec4 diffuseSum = vec4(0,0,0,1);
+vec4 specularSum = vec4(0,0,0,0);
+vec4 ambientSum = vec4(0,0,0,0);
+
+
+//prototype
+void addLight(vec4 color, float visibility);
+float shadowVisibility(int shadowView, vec3 position);
+int cubeFace(vec3 direction);
+
+
+//calls addLight for every light reaching position, with L and C_l set for it
+void addAllLights(vec3 position){
+
+	float viewDepth = max(-(view * vec4(position,1)).z, 0.0001);
+
+	//DIRECTIONAL AND SPOT LIGHTS
+	for(int i = 0; i < numLights; ++i){
+		int shadowView = allLights[i].firstShadowView;
+
+		if(allLights[i].type == SPOT_LIGHT){
+
+			//falls off like a point light, and softly toward the cone's edge
+			vec3 toLight = allLights[i].position.xyz - position;
+			float d = max(length(toLight), 0.0001);
+			float cone = smoothstep(allLights[i].spotCosine, mix(allLights[i].spotCosine, 1.0, 0.1), dot(-toLight / d, normalize(allLights[i].direction.xyz)));
+			L = toLight / d;
+			C_l = d < allLights[i].range ? allLights[i].brightness * cone / d : 0;
+		}
+		else{
+			L = -normalize(allLights[i].direction.xyz);
+			C_l = allLights[i].brightness;
+
+			//first cascade reaching past this fragment, none past the last split
+			int cascade = 0;
+			while(cascade < allLights[i].numCascades && viewDepth > allLights[i].cascadeSplits[cascade]){
+				++cascade;
+			}
+			shadowView = cascade < allLights[i].numCascades ? shadowView + cascade : -1;
+		}
+
+		float visibility = 1.0f;
+		if(shadowView >= 0){
+			visibility = shadowVisibility(shadowView, position);
+		}
+		addLight(allLights[i].color, visibility);
+	}
+
+	//POINT LIGHTS, only the ones binned into this fragment's froxel
+	ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy / clusterTileSize), int(log(viewDepth) * clusterDepthScale + clusterDepthBias));
+	cluster = clamp(cluster, ivec3(0), clusterGrid - 1);
+	int clusterIndex = (cluster.z * clusterGrid.y + cluster.y) * clusterGrid.x + cluster.x;
+
+	uvec2 range = texelFetch(clusterRanges, clusterIndex).xy;
+	for(uint i = 0u; i < range.y; ++i){
+		int lightIndex = int(texelFetch(clusterLightIndices, int(range.x + i)).x);
+		vec4 positionRange = texelFetch(pointLightData, lightIndex * 2);
+		vec4 color = texelFetch(pointLightData, lightIndex * 2 + 1);
+
+		//brightness / distance as before clustering, cut off at the light's range where it is below one color step
+		vec3 toLight = positionRange.xyz - position;
+		float d = max(length(toLight), 0.0001);
+		L = toLight / d;
+		C_l = d < positionRange.w ? 1 / d : 0;
+
+		float visibility = 1.0f;
+		if(color.w >= 0){
+			visibility = shadowVisibility(int(color.w) + cubeFace(-toLight), position);
+		}
+		addLight(vec4(color.rgb, 1), visibility);
+	}
+}
+
+/*how much of the light reaches position in a shadow view, 0 where something
+nearer covers it. Casters were drawn with a slope scaled depth offset, so the
+comparisons need no bias of their own*/
+float shadowVisibility(int shadowView, vec3 position){
+
+	int base = shadowView * 6;
+	mat4 atlasMatrix = mat4(texelFetch(shadowViews, base), texelFetch(shadowViews, base + 1),
+		texelFetch(shadowViews, base + 2), texelFetch(shadowViews, base + 3));
+	vec4 tileRect = texelFetch(shadowViews, base + 4);
+	vec4 filtering = texelFetch(shadowViews, base + 5);
+
+	vec4 lightSpacePosition = atlasMatrix * vec4(position, 1);
+	vec3 atlasPosition = lightSpacePosition.xyz / lightSpacePosition.w;
+	if(atlasPosition.z > 1.0){
+		return 1.0;
+	}
+	int mode = int(filtering.x);
+
+	//prefiltered mips, the occluders' exp(c * d) against this fragment's
+	if(mode == EXPONENTIAL_SHADOWS){
+		vec2 uv = clamp(atlasPosition.xy, tileRect.xy, tileRect.zw);
+		float occluders = textureLod(shadowExpAtlas, uv, filtering.z).r;
+		return clamp(occluders * exp(-EXPONENTIAL_SCALE * atlasPosition.z), 0.0, 1.0);
+	}
+
+	//each tap is a hardware 2x2 PCF, the kernel is turned per pixel to trade banding for noise
+	if(mode == POISSON_SHADOWS){
+		float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+		mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+		int samples = int(filtering.z);
+		float lit = 0.0;
+		for(int i = 0; i < samples; ++i){
+			vec2 uv = clamp(atlasPosition.xy + rotation * poissonDisk[i] * filtering.y, tileRect.xy, tileRect.zw);
+			lit += texture(shadowAtlas, vec3(uv, atlasPosition.z));
+		}
+		return lit / samples;
+	}
+
+	vec2 uv = clamp(atlasPosition.xy, tileRect.xy, tileRect.zw);
+
+	//a texel's center compares against that texel alone
+	if(mode == HARD_SHADOWS){
+		vec2 atlasSize = vec2(textureSize(shadowAtlas, 0));
+		uv = (floor(uv * atlasSize) + 0.5) / atlasSize;
+	}
+	return texture(shadowAtlas, vec3(uv, atlasPosition.z));
+}
+
+//point light views are +X, -X, +Y, -Y, +Z, -Z, picked by the major axis
+int cubeFace(vec3 direction){
+
+	vec3 a = abs(direction);
+	if(a.x >= a.y && a.x >= a.z){
+		return direction.x > 0 ? 0 : 1;
+	}
+	if(a.y >= a.z){
+		return direction.y > 0 ? 2 : 3;
+	}
+	return direction.z > 0 ? 4 : 5;
+}
@@ -1,26 +1,6 @@
-#version 330 core
-// This is the material fragment shader.
+// This is the material fragment shader, compiled after shader_lighting.glsl.
 
 
-#define DIRECTIONAL_LIGHT	0
-#define POINT_LIGHT			1
-#define MAX_LIGHTS			30
-
-//Light struct definition
-struct Light{
-		 
-	vec4 color;					
-	vec4 position;		 
-	vec4 direction;	
-	
-	int type; 
-	float brightness;
-	float padding;
-	float padding2;
-
-	mat4 VP;
-};
-
 //Material struct definition
 struct Material{
 
@@ -57,16 +37,7 @@ struct Material{
 	
 };
 
-layout (std140) uniform SceneLights {
-	Light allLights[MAX_LIGHTS];
-};
-
-uniform sampler2D shadowMaps[MAX_LIGHTS];
-
-
 uniform Material material;
-uniform vec3 camPosition;
-uniform int numLights;
 
 //from vertex shader
 in vec3 objectSpacePosition;
@@ -79,10 +50,6 @@ in mat4 toWorldMatrix;
 layout (location = 0) out vec4 outColor;
 
 
-//current light properties
-vec3 L = vec3(0,0,0);
-float C_l = 0;
-
 //model properties
 vec3 world_position;
 mat3 refinedToWorld;
@@ -91,10 +58,6 @@ vec3 world_tangent;
 vec3 world_bitangent;
 
 
-//prototype
-void calc_LandC_L(int i);
-
-
 void main()
 {
 	
@@ -136,60 +99,32 @@ void main()
 	}
 	
 	
-	vec4 multiplier = vec4(0,0,0,1);
-	float visibility = 1.0f;
+	//sum every light reaching this fragment
+	addAllLights(world_position);
 
 	//Lighting Modes
 	if(material.useDiffuse == 1){
-
-		int currShadowMap = 0;
-		for(int i = 0; i < numLights; ++i){
-			calc_LandC_L(i);
-			
-			visibility = 1.0f;
-			if(allLights[i].type == DIRECTIONAL_LIGHT){
-				vec4 lightSpaceposition = allLights[i].VP * vec4(world_position,1);
-				if (texture(shadowMaps[currShadowMap], lightSpaceposition.xy ).z  <  lightSpaceposition.z - 0.005){
-					visibility = 0;
-				}
-				++currShadowMap;
-			}
-
-			multiplier += visibility * vec4(material.diffuse,0) * max( dot(world_normal, L), 0) * allLights[i].color * C_l;
-		}
-
-		outColor *= multiplier;
+		outColor *= diffuseSum;
 	}
 	if(material.useSpecular == 1){
-		for(int i = 0; i < numLights; ++i){
-			calc_LandC_L(i);
-			vec3 R = 2 * dot(world_normal, L) * world_normal - L;	//reflect(-L, world_normal);
-			vec3 e = normalize(camPosition - world_position);
-			outColor += vec4(material.specular,0) * pow( max(dot(R, e),0) , 20) * allLights[i].color * C_l;
-		}
-	}		
-	
+		outColor += specularSum;
+	}
 	if(material.useAmbient == 1){
-		for(int i = 0; i < numLights; ++i){
-			calc_LandC_L(i);
-			outColor += vec4(material.ambient, 0) * surfaceTextureColor * reflectionTextureColor * allLights[i].color * C_l;
-		}
+		outColor += ambientSum * surfaceTextureColor * reflectionTextureColor;
 	}
 
 	
 }//END MAIN
 
 
-void calc_LandC_L(int i){
+//accumulate one light using the current L and C_l
+void addLight(vec4 color, float visibility){
 
-	if(allLights[i].type == DIRECTIONAL_LIGHT){
+	diffuseSum += visibility * vec4(material.diffuse,0) * max( dot(world_normal, L), 0) * color * C_l;
 
-		L = -normalize(allLights[i].direction.xyz);
-		C_l = allLights[i].brightness;
-	}else if(allLights[i].type == POINT_LIGHT){
+	vec3 R = 2 * dot(world_normal, L) * world_normal - L;	//reflect(-L, world_normal);
+	vec3 e = normalize(camPosition - world_position);
+	specularSum += vec4(material.specular,0) * pow( max(dot(R, e),0) , 20) * color * C_l;
 
-		L = normalize(allLights[i].position.xyz - world_position);
-		C_l = allLights[i].brightness / length(allLights[i].position.xyz - world_position);
-
-	}
-}
\ No newline at end of file
+	ambientSum += vec4(material.ambient, 0) * color * C_l;
+}
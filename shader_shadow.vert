@@ -7,6 +7,9 @@ uniform mat4 lightProjection;
 uniform mat4 lightView;
 uniform mat4 toWorld;
 
+//depth pre-pass and main pass must produce identical depths
+invariant gl_Position;
+
 void main(){
 	gl_Position = lightProjection * lightView * toWorld * vec4(position, 1.0);
 }
\ No newline at end of file
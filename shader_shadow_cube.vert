@@ -0,0 +1,11 @@
+#version 330 core
+
+// Input vertex data, different for all executions of this shader.
+layout(location = 0) in vec3 position;
+
+uniform mat4 toWorld;
+
+//faces are projected in the geometry shader
+void main(){
+	gl_Position = toWorld * vec4(position, 1.0);
+}